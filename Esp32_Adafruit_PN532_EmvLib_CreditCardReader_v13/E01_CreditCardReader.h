@@ -1,4 +1,110 @@
 
+#ifdef E01_CAPTURE_RECORDS
+// the records of a read, parsed when all commands to the card are done
+EMV_RecordCapture recordCapture;
+uint32_t recordCaptureMicros = 0;
+// the data of every application after its GPO (AID, PDOL, track 2), printed when the read is done
+EMV_CardData capturedApplications[EMV_CARD_MAX_AIDS];
+#endif
+
+// prints PAN and expiration date found in the records of the application
+void printRecordResults() {
+  if (emv.card.panLen > 0) {
+    Serial.printf("PAN found length %d\n", emv.card.panLen);
+    emv.printHex(emv.card.pan, emv.card.panLen);
+    Serial.println();
+  }
+  if (emv.card.expDateLen > 0) {
+    Serial.printf("Exp.Date found length %d\n", emv.card.expDateLen);
+    emv.printHex(emv.card.expDate, emv.card.expDateLen);
+    Serial.println();
+  }
+}
+
+#ifdef E01_CAPTURE_RECORDS
+// reads the records of an AFL entry into the capture area
+void captureAflEntry(byte* aflEntry, uint8_t aidIndex) {
+  uint32_t start = micros();
+  for (; aflEntry[1] != 0 && aflEntry[1] <= aflEntry[2]; aflEntry[1]++) {
+    if (emv.CaptureRecord(aflEntry, aidIndex, &recordCapture) == ESP32_EMV::EMV_STATUS_NO_RESPONSE) break;
+  }
+  recordCaptureMicros += micros() - start;
+}
+
+// all commands of the tap with the output off, returns the status of the Select PPSE
+ESP32_EMV::EMV_StatusCode captureTap() {
+  bool commDebugPrint = emv.COMM_DEBUG_PRINT;
+  bool methodDebugPrint = emv.METHOD_DEBUG_PRINT;
+  bool tlvDebugPrint = emv.TLV_DEBUG_PRINT;
+  bool pdolDebugPrint = emv.PDOL_DEBUG_PRINT;
+  emv.setDebugPrint(false);
+
+  // static: not on the stack of the loop task and no heap allocation per tap
+  static byte appData[255];
+  uint16_t appLen = sizeof(appData);
+  ESP32_EMV::EMV_StatusCode ppseStatusCode = emv.SelectPpse(appData, &appLen);
+  for (uint8_t aidIndex = 0; ppseStatusCode == ESP32_EMV::EMV_STATUS_OK && aidIndex < emv.card.numberOfAids; aidIndex++) {
+    appLen = sizeof(appData);
+    if (emv.SelectApdu(emv.card.aids[aidIndex], emv.card.aidsLen[aidIndex], 0x02, appData, &appLen) == ESP32_EMV::EMV_STATUS_OK) {
+      appLen = sizeof(appData);
+      emv.SendPdol(appData, &appLen);
+    }
+    capturedApplications[aidIndex] = emv.card;
+    byte aflEntry[4];
+    for (uint8_t j = 0; j < emv.card.aflLen / 4; j++) {
+      memcpy(aflEntry, &emv.card.afl[4 * j], 4);
+      captureAflEntry(aflEntry, aidIndex);
+    }
+  }
+
+  emv.COMM_DEBUG_PRINT = commDebugPrint;
+  emv.METHOD_DEBUG_PRINT = methodDebugPrint;
+  emv.TLV_DEBUG_PRINT = tlvDebugPrint;
+  emv.PDOL_DEBUG_PRINT = pdolDebugPrint;
+  return ppseStatusCode;
+}
+
+// prints the AID, the PDOL and PAN and expiration date of the track 2 of every application
+void printCapturedApplications() {
+  Serial.printf("Found %d AIDs\n", emv.card.numberOfAids);
+  for (uint8_t aidIndex = 0; aidIndex < emv.card.numberOfAids; aidIndex++) {
+    const EMV_CardData* application = &capturedApplications[aidIndex];
+    Serial.printf("AID %d:", aidIndex + 1);
+    emv.printHex((byte*)application->aids[aidIndex], application->aidsLen[aidIndex]);
+    Serial.println();
+    if (application->pdolLen == 0) {
+      Serial.println("No PDOL found in response, using a nulled PDOL");
+    } else {
+      Serial.printf("Found PDOLs (len %d):", application->pdolLen);
+      emv.printHex((byte*)application->pdol, application->pdolLen);
+      Serial.println();
+    }
+    if (application->panCharLen > 0) {
+      Serial.printf("PAN %.4s ****\n", application->panChar);
+      Serial.printf("ExpDate %s\n", application->expDateChar);
+    }
+    if (application->aflLen == 0) Serial.println("No AFL found");
+  }
+  Serial.println(DIVIDER);
+}
+
+// decodes and prints the captured records
+void parseCapturedRecords() {
+  Serial.println(DIVIDER);
+  Serial.printf("Captured %d records (%d bytes) in %lu us\n", recordCapture.count(), recordCapture.used(),
+                (unsigned long)recordCaptureMicros);
+  if (recordCapture.overflow()) Serial.println("The capture area is full, records are missing");
+  for (uint8_t i = 0; i < recordCapture.count(); i++) {
+    const EMV_CapturedRecord* entry = recordCapture.entry(i);
+    Serial.println(DIVIDER);
+    Serial.printf("AID %d SFI %02x record %02x\n", entry->aidIndex + 1, entry->sfi, entry->record);
+    emv.ParseRecord(recordCapture.data(i), entry->length);
+  }
+  Serial.println(DIVIDER);
+  printRecordResults();
+}
+#endif
+
 void run_E01_Credit_Card_Handling() {
   Serial.println();
   Serial.println(DIVIDER);
@@ -7,9 +113,22 @@ void run_E01_Credit_Card_Handling() {
   delay(100);
   Serial.println(DIVIDER);
 
+#ifdef E01_CAPTURE_RECORDS
+  // the card is read without any output, the results are printed when the card is done
+  recordCapture.clear();
+  recordCaptureMicros = 0;
+  if (captureTap() != ESP32_EMV::EMV_STATUS_OK) {
+    Serial.println("Error Select PPSE, aborting");
+    apduRing.dump();
+    return;
+  }
+  parseCapturedRecords();
+  printCapturedApplications();
+#else
   Serial.println(DIVIDER);
   Serial.println("Select PPSE");
-  byte* appData = new byte[255];
+  // static: not on the stack of the loop task and no heap allocation per tap
+  static byte appData[255];
   uint16_t appLenExt = 255;
   ESP32_EMV::EMV_StatusCode emvStatusCode;
   emvStatusCode = emv.SelectPpse(appData, &appLenExt);
@@ -17,6 +136,7 @@ void run_E01_Credit_Card_Handling() {
 
   if (emvStatusCode != ESP32_EMV::EMV_STATUS_OK) {
     Serial.println("Error Select PPSE, aborting");
+    apduRing.dump();
     return;
   }
 
@@ -24,23 +144,23 @@ void run_E01_Credit_Card_Handling() {
   Serial.println("Get AIDs from response");
   // 10 aids of max 16 bytes length
 
-  Serial.printf("Found %d AIDs\n", emv.numberOfAids);
-  for (uint8_t i = 0; i < emv.numberOfAids; i++) {
+  Serial.printf("Found %d AIDs\n", emv.card.numberOfAids);
+  for (uint8_t i = 0; i < emv.card.numberOfAids; i++) {
     Serial.printf("AID %d: ", i + 1);
-    emv.printHex(emv.aids[i], emv.aidsLen[i]);
+    emv.printHex(emv.card.aids[i], emv.card.aidsLen[i]);
     Serial.println();
   }
 
   // iterate through AIDs to get the PDOL for each AID
-  for (uint8_t aidIndex = 0; aidIndex - emv.numberOfAids; aidIndex++) {
+  for (uint8_t aidIndex = 0; aidIndex - emv.card.numberOfAids; aidIndex++) {
     Serial.println(DIVIDER);
     Serial.printf("AID %d:", aidIndex + 1);
-    emv.printHex(emv.aids[aidIndex], emv.aidsLen[aidIndex]);
+    emv.printHex(emv.card.aids[aidIndex], emv.card.aidsLen[aidIndex]);
     Serial.println();
     // aidLookUp is a very simplyfied table for my most used AIDs
 
     uint8_t aidNameIndex;
-    emvStatusCode = emv.LookUpAid(emv.aids[aidIndex], emv.aidsLen[aidIndex], &aidNameIndex);
+    emvStatusCode = emv.LookUpAid(emv.card.aids[aidIndex], emv.card.aidsLen[aidIndex], &aidNameIndex);
     if (emvStatusCode == ESP32_EMV::EMV_STATUS_OK) {
       if (aidNameIndex == 1) {
         Serial.println("VisaCard");
@@ -60,17 +180,17 @@ void run_E01_Credit_Card_Handling() {
     Serial.println("Select AID");
     appLenExt = 255;
     memset(appData, 0, appLenExt);
-    emvStatusCode = emv.SelectApdu(emv.aids[aidIndex], emv.aidsLen[aidIndex], 0x02, appData, &appLenExt);
+    emvStatusCode = emv.SelectApdu(emv.card.aids[aidIndex], emv.card.aidsLen[aidIndex], 0x02, appData, &appLenExt);
     // for the next step we need to know if the card requested a PDOL (tag 9F38 in response
-    if (emv.pdolLen > 254) {
+    if (emv.card.pdolLen == 0) {
       Serial.println("No PDOL found in response, using a nulled PDOL");
       // now contruct a pdol
       appLenExt = 255;
       memset(appData, 0, appLenExt);
       emvStatusCode = emv.SendPdol(appData, &appLenExt);
     } else {
-      Serial.printf("Found PDOLs (len %d):", emv.pdolLen);
-      emv.printHex(emv.pdol, emv.pdolLen);
+      Serial.printf("Found PDOLs (len %d):", emv.card.pdolLen);
+      emv.printHex(emv.card.pdol, emv.card.pdolLen);
       Serial.println();
       // now contruct a pdol
       appLenExt = 255;
@@ -79,19 +199,20 @@ void run_E01_Credit_Card_Handling() {
 
       if (emvStatusCode != ESP32_EMV::EMV_STATUS_OK) {
         Serial.println("Error Send PDOL, aborting");
+        apduRing.dump();
         return;
       }
 
-      if (emv.panCharLen > 0) {
+      if (emv.card.panCharLen > 0) {
         char panCharMask[5];
         memset(panCharMask, 0, 5);
         for (uint8_t i = 0; i < 4; i++) {
-          panCharMask[i] = emv.panChar[i];
+          panCharMask[i] = emv.card.panChar[i];
         }
         Serial.printf("PAN %s", panCharMask);
         Serial.println(" ****");
         Serial.print("ExpDate ");
-        Serial.printf("%s\n", emv.expDateChar);
+        Serial.printf("%s\n", emv.card.expDateChar);
       }
     }  // selectApdu if (desfire.pdolLen > 254)
 
@@ -100,12 +221,12 @@ void run_E01_Credit_Card_Handling() {
 
     Serial.println(DIVIDER);
     Serial.println("AFL Handling");
-    if (emv.t94AflLen == 0) {
+    if (emv.card.aflLen == 0) {
       Serial.println("No AFL found");
     } else {
-      Serial.printf("AFL length %d\n", emv.t94AflLen);
+      Serial.printf("AFL length %d\n", emv.card.aflLen);
 
-      uint8_t numberOfAfl = emv.t94AflLen / 4;
+      uint8_t numberOfAfl = emv.card.aflLen / 4;
       Serial.printf("Number of AFL entries %d\n", numberOfAfl);
 
       // chunk in 4 byte chunks
@@ -118,7 +239,7 @@ void run_E01_Credit_Card_Handling() {
         // 10 02 04 00
         // Openbank 18 01 03 00 20 01 01 01
         for (uint8_t i = 0; i < 4; i++) {
-          aflEntry[i] = emv.t94Afl[i + (4 * j)];
+          aflEntry[i] = emv.card.afl[i + (4 * j)];
         }
         // more than 1 file ?
         uint8_t fileIndex = aflEntry[2] - aflEntry[1] + 1;
@@ -126,33 +247,26 @@ void run_E01_Credit_Card_Handling() {
         Serial.println(DIVIDER);
         for (uint8_t i = 0; i < fileIndex; i++) {
           Serial.printf("AFL for SFI %02x file %02x\n", aflEntry[0], aflEntry[1]);
+          appLenExt = 255;
           emvStatusCode = emv.ReadRecord(aflEntry, appData, &appLenExt);
           if (emvStatusCode != ESP32_EMV::EMV_STATUS_OK) {
             Serial.println("Error Read Record, skipping");
           }
           Serial.println(DIVIDER);
-          if (emv.t5aPanLen > 0) {
-            Serial.printf("PAN found length %d\n", emv.t5aPanLen);
-            emv.printHex(emv.t5aPan, emv.t5aPanLen);
-            Serial.println();
-            emv.t5aPanLen = 0;
-          }
-          if (emv.t5f24ExpDateLen > 0) {
-            Serial.printf("Exp.Date found length %d\n", emv.t5f24ExpDateLen);
-            emv.printHex(emv.t5f24ExpDate, emv.t5f24ExpDateLen);
-            Serial.println();
-            emv.t5f24ExpDateLen = 0;
-          }
           //}
           aflEntry[1]++;
         }
       }
+      printRecordResults();
     }
+#ifndef RUN_EMV08_PRESENCE_MONITOR
     // delay for next entry
-    if (emv.numberOfAids > 1) {
+    if (emv.card.numberOfAids > 1) {
       delay(2000);
     }
+#endif
   }
+#endif
 
   delay(100);
   Serial.println(DIVIDER);
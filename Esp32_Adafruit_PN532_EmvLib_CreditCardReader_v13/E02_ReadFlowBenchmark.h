@@ -0,0 +1,212 @@
+// Measures the read flow against simulated cards, no card on the reader is needed.
+// The debug output of the library is switched off during the benchmark.
+
+#include "EMV_Benchmark.h"
+#include "EMV_SimCard.h"
+#include "EMV_Session.h"
+#include "EMV_CardCache.h"
+#include "EMV_Log.h"
+
+const uint16_t BENCHMARK_TAPS = 1000;
+
+EMV_SimCard benchmarkCard(&EMV_SIM_PROFILE_VISA);
+EMV_BenchmarkTransport benchmark(&benchmarkCard);
+ESP32_EMV benchmarkEmv(&benchmark);
+
+void run_E02_Read_Flow_Benchmark_Profile(const EMV_SimCardProfile* profile) {
+  benchmarkCard.setProfile(profile);
+  benchmark.reset();
+  benchmarkEmv.lePolicy = EMV_LePolicy();  // start without learned Le values
+  benchmarkEmv.pdolPlans.clear();           // ... and without compiled PDOLs
+  benchmarkEmv.metrics.reset();
+  benchmarkEmv.setDebugPrint(false);
+
+  for (uint16_t i = 0; i < BENCHMARK_TAPS; i++) {
+    benchmarkCard.reset();
+    EMV_RunReadFlow(&benchmarkEmv, &benchmark);
+  }
+  Serial.println(DIVIDER);
+  Serial.printf("Card profile %s\n", profile->name);
+  EMV_PrintBenchmark(&benchmark);
+  Serial.printf("Le fallbacks %lu avoided %lu mispredicted %lu\n", (unsigned long)benchmarkEmv.lePolicy.fallbacks,
+                (unsigned long)benchmarkEmv.lePolicy.fallbacksAvoided, (unsigned long)benchmarkEmv.lePolicy.mispredictions);
+  Serial.printf("PDOL plan cache hits %lu misses %lu\n", (unsigned long)benchmarkEmv.pdolPlans.hits,
+                (unsigned long)benchmarkEmv.pdolPlans.misses);
+  EMV_MetricsSnapshot metrics;
+  benchmarkEmv.metrics.snapshot(&metrics);
+  EMV_PrintMetrics(&metrics);
+}
+
+// the cost of the metrics that every exchange pays
+const uint32_t BENCHMARK_METRICS_EXCHANGES = 100000;
+
+void run_E02_Metrics_Cost() {
+  static EMV_Metrics metrics;
+  static const byte AID_VISA[] = { 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10 };
+  byte readRecord[5] = { 0x00, 0xB2, 0x01, 0x0C, 0x00 };
+  metrics.setAid(AID_VISA, sizeof(AID_VISA));
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < BENCHMARK_METRICS_EXCHANGES; i++) {
+    metrics.recordExchange(readRecord, sizeof(readRecord), 100, i & 0xFFFF, true, false);
+  }
+  uint32_t elapsed = micros() - start;
+  Serial.println(DIVIDER);
+  Serial.printf("Metrics: %lu exchanges recorded in %lu us, %lu ns per exchange, %d bytes\n", (unsigned long)BENCHMARK_METRICS_EXCHANGES,
+                (unsigned long)elapsed, (unsigned long)((uint64_t)elapsed * 1000 / BENCHMARK_METRICS_EXCHANGES), (int)sizeof(EMV_Metrics));
+}
+
+// the cost of the debug output: taps with all run time switches on. Compare the tap time (and the
+// sketch size) of a build with the default EMV_LOG_LEVEL and a build with EMV_LOG_LEVEL 0, see EMV_Log.h
+const uint16_t BENCHMARK_LOGGING_TAPS = 10;
+
+void run_E02_Logging_Cost() {
+  benchmarkCard.setProfile(&EMV_SIM_PROFILE_VISA);
+  benchmark.reset();
+  benchmarkEmv.setDebugPrint(true);
+  for (uint16_t i = 0; i < BENCHMARK_LOGGING_TAPS; i++) {
+    benchmarkCard.reset();
+    EMV_RunReadFlow(&benchmarkEmv, &benchmark);
+  }
+  benchmarkEmv.setDebugPrint(false);
+  Serial.println(DIVIDER);
+  Serial.printf("Debug output on, EMV_LOG_LEVEL %d categories 0x%02x: tap avg %lu us max %lu us\n", EMV_LOG_LEVEL, EMV_LOG_CATEGORIES,
+                (unsigned long)(benchmark.tapStats.wallMicros / benchmark.tapStats.taps), (unsigned long)benchmark.tapStats.maxWallMicros);
+}
+
+// the cost of the always-on APDU ring: the same taps without and with emv.apduRing, see EMV_ApduRing.h
+EMV_ApduRing benchmarkRing;
+
+uint32_t run_E02_Apdu_Ring_Taps(EMV_ApduRing* ring) {
+  benchmarkCard.setProfile(&EMV_SIM_PROFILE_VISA);
+  benchmark.reset();
+  benchmarkEmv.apduRing = ring;
+  for (uint16_t i = 0; i < BENCHMARK_TAPS; i++) {
+    benchmarkCard.reset();
+    EMV_RunReadFlow(&benchmarkEmv, &benchmark);
+  }
+  benchmarkEmv.apduRing = NULL;
+  return benchmark.tapStats.wallMicros;
+}
+
+void run_E02_Apdu_Ring_Cost() {
+  uint32_t withoutRing = run_E02_Apdu_Ring_Taps(NULL);
+  benchmarkRing.clear();
+  uint32_t withRing = run_E02_Apdu_Ring_Taps(&benchmarkRing);
+  uint32_t exchanges = 0;
+  for (uint8_t phase = 0; phase < EMV_PHASE_COUNT; phase++) exchanges += benchmark.phaseStats[phase].roundTrips;
+  Serial.println(DIVIDER);
+  Serial.printf("APDU ring: %d taps without %lu us, with %lu us, %ld ns per exchange\n", BENCHMARK_TAPS, (unsigned long)withoutRing,
+                (unsigned long)withRing, (long)(((int64_t)withRing - withoutRing) * 1000 / exchanges));
+  Serial.printf("APDU ring holds %d entries in %lu of %d bytes, %lu dropped\n", benchmarkRing.entryCount(), (unsigned long)benchmarkRing.used(),
+                EMV_APDU_RING_SIZE, (unsigned long)benchmarkRing.droppedEntries);
+#ifndef ARDUINO
+  // decode the ring as it would be done with a dump on a PC
+  static byte snapshot[EMV_APDU_RING_SNAPSHOT_HEADER_LEN + EMV_APDU_RING_SIZE];
+  static byte trace[EMV_APDU_RING_SIZE * 2];
+  EMV_TraceWriter writer;
+  writer.begin(trace, sizeof(trace));
+  uint32_t traceExchanges = EMV_ApduRingToTrace(snapshot, benchmarkRing.snapshot(snapshot, sizeof(snapshot)), &writer);
+  writer.finish();
+  Serial.printf("APDU ring decoded: %lu taps, %lu exchanges\n", (unsigned long)writer.sessionCount(), (unsigned long)traceExchanges);
+#endif
+}
+
+// the same card tapped again: complete reads against reads taken from the card cache
+EMV_Session benchmarkSession(&benchmarkEmv);
+EMV_CardCache benchmarkCache;
+
+uint32_t run_E02_Card_Cache_Taps(EMV_CardCache* cache, uint32_t* exchanges) {
+  benchmarkSession.setCache(cache);
+  *exchanges = 0;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_TAPS; i++) {
+    benchmarkSession.begin();
+    while (!benchmarkSession.isFinished()) benchmarkSession.step();
+    *exchanges += benchmarkCard.exchangeCount;
+  }
+  benchmarkSession.setCache(NULL);
+  return micros() - start;
+}
+
+void run_E02_Card_Cache() {
+  static const byte BENCHMARK_UID[] = { 0x04, 0x5A, 0x2B, 0x7C, 0x11, 0x80, 0x90 };
+  benchmarkCard.setProfile(&EMV_SIM_PROFILE_VISA);
+  benchmarkCard.setUid(BENCHMARK_UID, sizeof(BENCHMARK_UID));
+  benchmarkCache.clear();
+  uint32_t fullExchanges, cachedExchanges;
+  uint32_t fullMicros = run_E02_Card_Cache_Taps(NULL, &fullExchanges);
+  uint32_t cachedMicros = run_E02_Card_Cache_Taps(&benchmarkCache, &cachedExchanges);
+  benchmarkCard.setUid(NULL, 0);
+  Serial.println(DIVIDER);
+  Serial.printf("Card cache: %d taps of the same card, complete reads %lu exchanges %lu us, with the cache %lu exchanges %lu us\n",
+                BENCHMARK_TAPS, (unsigned long)fullExchanges, (unsigned long)fullMicros, (unsigned long)cachedExchanges, (unsigned long)cachedMicros);
+  Serial.printf("Card cache hits %lu misses %lu\n", (unsigned long)benchmarkCache.hits, (unsigned long)benchmarkCache.misses);
+}
+
+// the read behind the packet buffer of the Adafruit_PN532 library, stock (64) and modified (255)
+EMV_SimCard frameCard(&EMV_SIM_PROFILE_VISA);
+EMV_SimReaderFrame readerFrame(&frameCard, EMV_PN532_PACKBUFFSIZ_MODIFIED);
+ESP32_EMV frameEmv(&readerFrame);
+EMV_Session frameSession(&frameEmv);
+
+bool run_E02_Reader_Frame_Read(const EMV_SimCardProfile* profile, uint16_t packetBufferSize, bool isReadable) {
+  frameCard.setProfile(profile);
+  readerFrame.packetBufferSize = packetBufferSize;
+  frameEmv.setDebugPrint(false);
+  frameEmv.metrics.reset();
+  frameSession.begin();
+  while (!frameSession.isFinished()) frameSession.step();
+  bool isRead = frameSession.getState() == EMV_SESSION_DONE && frameSession.panLen > 0;
+  const EMV_CommandMetrics* getResponse = &frameEmv.metrics.get()->commands[EMV_METRICS_GET_RESPONSE];
+  Serial.printf("Frame %3d bytes %-28s %-5s PAN %-3s %lu GET RESPONSE %s\n", packetBufferSize, profile->name,
+                EMV_Session::stateText(frameSession.getState()), frameSession.panLen > 0 ? "yes" : "no",
+                (unsigned long)getResponse->exchanges, isRead == isReadable ? "ok" : "WRONG");
+  return isRead == isReadable;
+}
+
+void run_E02_Reader_Frames() {
+  Serial.println(DIVIDER);
+  bool isPassed = run_E02_Reader_Frame_Read(&EMV_SIM_PROFILE_VISA, EMV_PN532_PACKBUFFSIZ_MODIFIED, true);
+  // the PPSE response of 68 bytes does not fit the frame of the stock library
+  isPassed &= run_E02_Reader_Frame_Read(&EMV_SIM_PROFILE_VISA, EMV_PN532_PACKBUFFSIZ_STOCK, false);
+  isPassed &= run_E02_Reader_Frame_Read(&EMV_SIM_PROFILE_VISA_CHUNKED, EMV_PN532_PACKBUFFSIZ_STOCK, true);
+  isPassed &= run_E02_Reader_Frame_Read(&EMV_SIM_PROFILE_MASTERCARD, EMV_PN532_PACKBUFFSIZ_STOCK, true);
+  isPassed &= run_E02_Reader_Frame_Read(&EMV_SIM_PROFILE_MASTERCARD_EXACT_LE, EMV_PN532_PACKBUFFSIZ_STOCK, true);
+
+  // a response that fills the 56 bytes of the stock frame is complete if its TLV ends with the frame
+  byte response[EMV_PN532_PACKBUFFSIZ_STOCK - EMV_PN532_FRAME_HEADER];
+  memset(response, 0, sizeof(response));
+  response[0] = 0x6F;
+  response[1] = sizeof(response) - 4;
+  response[sizeof(response) - 2] = 0x90;
+  bool isComplete = EMV_PN532ResponseStatus(response, sizeof(response), sizeof(response)) == EMV_TRANSCEIVE_OK;
+  response[1] = sizeof(response);  // the TLV goes on behind the frame
+  bool isCut = EMV_PN532ResponseStatus(response, sizeof(response), sizeof(response)) == EMV_TRANSCEIVE_TOO_LONG;
+  Serial.printf("Full frame of %d bytes: complete TLV %s, cut TLV %s\n", (int)sizeof(response), isComplete ? "ok" : "WRONG", isCut ? "ok" : "WRONG");
+  if (!isPassed || !isComplete || !isCut) {
+    Serial.println("Reader frame check FAILED");
+#ifndef ARDUINO
+    exit(1);
+#endif
+  }
+}
+
+void run_E02_Read_Flow_Benchmark() {
+  Serial.println();
+  Serial.println(DIVIDER);
+  Serial.println(" E02 Read Flow Benchmark");
+  Serial.println(DIVIDER);
+  run_E02_Read_Flow_Benchmark_Profile(&EMV_SIM_PROFILE_VISA);
+  run_E02_Read_Flow_Benchmark_Profile(&EMV_SIM_PROFILE_MASTERCARD);
+  run_E02_Read_Flow_Benchmark_Profile(&EMV_SIM_PROFILE_VISA_CHUNKED);
+  run_E02_Read_Flow_Benchmark_Profile(&EMV_SIM_PROFILE_MASTERCARD_EXACT_LE);
+  run_E02_Logging_Cost();
+  run_E02_Apdu_Ring_Cost();
+  run_E02_Metrics_Cost();
+  run_E02_Card_Cache();
+  run_E02_Reader_Frames();
+  Serial.println(DIVIDER);
+  Serial.println(" E02 Read Flow Benchmark END");
+  Serial.println(DIVIDER);
+  Serial.println();
+}
@@ -0,0 +1,76 @@
+// Compares the tlv.h decoder (as used by the library up to V13: the response is copied into
+// a 255 bytes buffer and the complete buffer is decoded) with the in place parser of EMV_Tlv.h.
+// The test data is the GPO response and the records of the simulated Visa card.
+
+#include "EMV_Tlv.h"
+#include "EMV_SimCard.h"
+#include "tlv.h" // https://github.com/jmwanderer/tlv.arduino Arduino Library Manager Version 0.2.1
+
+const uint16_t TLV_BENCHMARK_ROUNDS = 2000;
+
+TLVS benchmarkTlvs;  // global, the tlv.h decoder is too large for the stack of the loop task
+
+// searches PAN, expiration date, track 2 and AFL the way the library did up to V13
+uint16_t decodeWithTlvLibrary(const byte* response, uint16_t responseLen) {
+  uint8_t buffer[255];
+  memset(buffer, 0, sizeof(buffer));
+  memcpy(buffer, response, responseLen);
+  benchmarkTlvs.decodeTLVs(buffer, sizeof(buffer));
+  uint16_t found = 0;
+  if (benchmarkTlvs.findTLV(0x5A) != NULL) found++;
+  if (benchmarkTlvs.findTLV(0x5F24) != NULL) found++;
+  if (benchmarkTlvs.findTLV(0x57) != NULL) found++;
+  if (benchmarkTlvs.findTLV(0x94) != NULL) found++;
+  return found;
+}
+
+uint16_t decodeWithTlvParser(const byte* response, uint16_t responseLen) {
+  EMV_Tlv tlv;
+  uint16_t found = 0;
+  if (EMV_TlvFind(response, responseLen, 0x5A, &tlv)) found++;
+  if (EMV_TlvFind(response, responseLen, 0x5F24, &tlv)) found++;
+  if (EMV_TlvFind(response, responseLen, 0x57, &tlv)) found++;
+  if (EMV_TlvFind(response, responseLen, 0x94, &tlv)) found++;
+  return found;
+}
+
+void run_E03_Tlv_Parser_Benchmark() {
+  Serial.println();
+  Serial.println(DIVIDER);
+  Serial.println(" E03 TLV Parser Benchmark");
+  Serial.println(DIVIDER);
+
+  const EMV_SimApplication* application = &EMV_SIM_PROFILE_VISA.applications[0];
+  uint32_t bytes = application->gpoResponseLen;
+  for (uint8_t i = 0; i < application->numberOfRecords; i++) bytes += application->records[i].dataLen;
+
+  uint32_t foundLibrary = 0;
+  uint32_t start = micros();
+  for (uint16_t round = 0; round < TLV_BENCHMARK_ROUNDS; round++) {
+    foundLibrary += decodeWithTlvLibrary(application->gpoResponse, application->gpoResponseLen);
+    for (uint8_t i = 0; i < application->numberOfRecords; i++) {
+      foundLibrary += decodeWithTlvLibrary(application->records[i].data, application->records[i].dataLen);
+    }
+  }
+  uint32_t libraryMicros = micros() - start;
+
+  uint32_t foundParser = 0;
+  start = micros();
+  for (uint16_t round = 0; round < TLV_BENCHMARK_ROUNDS; round++) {
+    foundParser += decodeWithTlvParser(application->gpoResponse, application->gpoResponseLen);
+    for (uint8_t i = 0; i < application->numberOfRecords; i++) {
+      foundParser += decodeWithTlvParser(application->records[i].data, application->records[i].dataLen);
+    }
+  }
+  uint32_t parserMicros = micros() - start;
+
+  Serial.printf("%u rounds over %lu bytes of responses\n", TLV_BENCHMARK_ROUNDS, (unsigned long)bytes);
+  Serial.printf("tlv.h   %8lu us, %lu ns/byte, found %lu tags\n", (unsigned long)libraryMicros,
+                (unsigned long)((uint64_t)libraryMicros * 1000 / ((uint64_t)bytes * TLV_BENCHMARK_ROUNDS)), (unsigned long)foundLibrary);
+  Serial.printf("EMV_Tlv %8lu us, %lu ns/byte, found %lu tags\n", (unsigned long)parserMicros,
+                (unsigned long)((uint64_t)parserMicros * 1000 / ((uint64_t)bytes * TLV_BENCHMARK_ROUNDS)), (unsigned long)foundParser);
+  Serial.println(DIVIDER);
+  Serial.println(" E03 TLV Parser Benchmark END");
+  Serial.println(DIVIDER);
+  Serial.println();
+}
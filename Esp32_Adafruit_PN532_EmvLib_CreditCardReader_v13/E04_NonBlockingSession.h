@@ -0,0 +1,108 @@
+// Reads a card with the non-blocking EMV_Session: every call of run_E04_Non_Blocking_Session()
+// does one step and returns, the loop() keeps running during the read.
+// After a read the next poll starts after E04_NEXT_READ_MILLIS, without a delay().
+// With USE_SIMULATED_CARD the setup first removes the simulated card after the GPO: the session
+// has to end with an error instead of sending the READ RECORD commands; on Linux it exits with code 1.
+
+#include "EMV_Session.h"
+#include "EMV_CardCache.h"
+
+const uint32_t E04_NEXT_READ_MILLIS = 2000;
+// the session stops as soon as PAN and expiration date are found, 0 reads all AIDs and records
+const byte E04_READ_TARGETS = EMV_TARGET_PAN | EMV_TARGET_EXPIRATION_DATE;
+// prints the stack every phase of the read needed
+const bool E04_MEASURE_STACK = true;
+// a card that stays on the reader or is tapped again within the window of the cache is not read again
+const bool E04_USE_CARD_CACHE = true;
+
+EMV_Session session(&emv);
+EMV_CardCache cardCache;
+uint32_t sessionStartMillis = 0;
+uint32_t sessionFinishedMillis = 0;
+uint32_t longestStepMicros = 0;  // the longest time the loop() was blocked during the read
+
+#ifdef USE_SIMULATED_CARD
+void setup_E04_Non_Blocking_Session() {
+  simCard.reset();
+  session.begin();
+  while (!session.isFinished() && session.getState() != EMV_SESSION_READ_RECORD) session.step();
+  uint8_t stepsBeforeRemoval = session.steps;
+  simCard.present = false;
+  while (!session.isFinished()) session.step();
+  simCard.present = true;
+  bool isOk = session.getState() == EMV_SESSION_ERROR && session.steps == stepsBeforeRemoval + 1;
+  Serial.println(DIVIDER);
+  Serial.printf(" E04 card removed after the GPO: session %s after %d more steps %s\n", EMV_Session::stateText(session.getState()),
+                session.steps - stepsBeforeRemoval, isOk ? "PASSED" : "FAILED");
+  Serial.println(DIVIDER);
+  session.begin();
+#ifndef ARDUINO
+  if (!isOk) exit(1);
+#endif
+}
+#endif
+
+void run_E04_Non_Blocking_Session() {
+  EMV_SessionState state = session.getState();
+  if (state == EMV_SESSION_IDLE || (session.isFinished() && millis() - sessionFinishedMillis >= E04_NEXT_READ_MILLIS)) {
+    session.setTargets(E04_READ_TARGETS);
+    session.measureStack = E04_MEASURE_STACK;
+    session.setCache(E04_USE_CARD_CACHE ? &cardCache : NULL);
+    session.begin();
+    return;
+  }
+  if (session.isFinished()) return;
+
+  if (state == EMV_SESSION_POLL) {
+    if (session.step() == EMV_SESSION_SELECT_PPSE) {
+      Serial.println(DIVIDER);
+      Serial.println(" E04 Non Blocking Session: found a card");
+      sessionStartMillis = millis();
+      longestStepMicros = 0;
+    }
+    return;
+  }
+
+  uint32_t stepStart = micros();
+  state = session.step();
+  uint32_t stepMicros = micros() - stepStart;
+  if (stepMicros > longestStepMicros) longestStepMicros = stepMicros;
+  if (!session.isFinished()) return;
+
+  sessionFinishedMillis = millis();
+  Serial.printf("Session %s after %d steps in %lu ms, the longest step took %lu us\n", EMV_Session::stateText(state), session.steps,
+                (unsigned long)(sessionFinishedMillis - sessionStartMillis), (unsigned long)longestStepMicros);
+  // the commands and responses of the failed read
+  if (state == EMV_SESSION_ERROR) apduRing.dump();
+  if (session.fromCache) {
+    Serial.printf("Read within %lu s, taken from the card cache after the SELECT PPSE\n", (unsigned long)(EMV_CARD_CACHE_WINDOW_MILLIS / 1000));
+  }
+  if (session.finishedEarly) {
+    Serial.printf("All targets found, skipped %d READ RECORD and %d AIDs\n", session.skippedRecords, session.skippedAids);
+  }
+  if (session.panLen > 0) {
+    Serial.print("PAN");
+    emv.printHex(session.pan, session.panLen);
+    Serial.println();
+  }
+  if (session.expDateLen > 0) {
+    Serial.print("ExpDate");
+    emv.printHex(session.expDate, session.expDateLen);
+    Serial.println();
+  }
+  if (session.measureStack) {
+    Serial.print("Stack high water per phase (bytes):");
+    for (uint8_t state = EMV_SESSION_POLL; state <= EMV_SESSION_READ_RECORD; state++) {
+      Serial.printf(" %s %d", EMV_Session::stateText((EMV_SessionState)state), session.stackHighWater[state]);
+    }
+    Serial.println();
+    Serial.printf("Scratch arena high water %d of %d bytes\n", emv.scratch.highWater, EMV_SCRATCH_SIZE);
+  }
+#ifdef ARDUINO
+  // the stack probe paints the FreeRTOS fill byte, with measureStack the minimum would be too large
+  if (!session.measureStack) {
+    Serial.printf("Free stack of the loop task (minimum) %lu bytes\n", (unsigned long)uxTaskGetStackHighWaterMark(NULL));
+  }
+#endif
+  Serial.println(DIVIDER);
+}
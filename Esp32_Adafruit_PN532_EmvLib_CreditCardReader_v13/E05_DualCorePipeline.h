@@ -0,0 +1,158 @@
+// Runs the read flow as a two stage pipeline: the loop() (core 1) exchanges the APDUs and decodes
+// only what the next command needs (ESP32_EMV::captureOnly), the parse stage on core 0 decodes
+// the responses and prints PAN and expiration date.
+// With USE_SIMULATED_CARD the setup first runs E05_BENCHMARK_TAPS taps against the simulated
+// card with the parse stage inline (with and without captureOnly) and pipelined. The pipelined
+// taps run with every card profile, the chunked and the exact Le profiles directly and behind a
+// 64 byte reader frame as well, and every tap has to give the PAN; on Linux a missing PAN exits
+// with code 1. The simulated card answers at once, so the pipelined time shows the cost of the
+// handoff between the cores, the gain needs the air time of a real card.
+
+#include "EMV_Pipeline.h"
+#include "EMV_Session.h"
+
+const uint16_t E05_BENCHMARK_TAPS = 1000;
+const uint32_t E05_NEXT_READ_MILLIS = 2000;
+
+EMV_ResponseRing pipelineRing;
+#ifdef USE_SIMULATED_CARD
+EMV_PipelineTransport pipelineTransport(&simCard, &pipelineRing);
+#else
+EMV_PN532Transport pipelineReader(&nfc);
+EMV_PipelineTransport pipelineTransport(&pipelineReader, &pipelineRing);
+#endif
+ESP32_EMV pipelineEmv(&pipelineTransport);
+EMV_Session pipelineSession(&pipelineEmv);
+#ifdef USE_SIMULATED_CARD
+EMV_SimReaderFrame pipelineFrame(&simCard, EMV_PN532_PACKBUFFSIZ_STOCK);
+EMV_PipelineTransport pipelineFrameTransport(&pipelineFrame, &pipelineRing);
+ESP32_EMV pipelineFrameEmv(&pipelineFrameTransport);
+EMV_Session pipelineFrameSession(&pipelineFrameEmv);
+#endif
+
+bool pipelinePrintResults = true;
+uint32_t pipelineTapsWithPan = 0;
+uint32_t pipelineFinishedMillis = 0;
+
+// runs on the parse stage
+void printPipelineResult(const EMV_PipelineResult* result) {
+  if (result->pan[0] != 0) pipelineTapsWithPan++;
+  if (!pipelinePrintResults) return;
+  Serial.println(DIVIDER);
+  Serial.printf("Tap %lu: %s, %d responses\n", (unsigned long)result->tap, result->label, result->responses);
+  Serial.printf("PAN %.4s ****\n", result->pan);
+  Serial.printf("ExpDate %s\n", result->expDate);
+  Serial.println(DIVIDER);
+}
+
+EMV_ParseStage parseStage(&pipelineRing, printPipelineResult);
+
+// one complete read, with inlineParse the responses are parsed after every step
+void runPipelineTap(EMV_Session* session, EMV_PipelineTransport* transport, bool inlineParse) {
+  session->begin();
+  while (!session->isFinished()) {
+    session->step();
+    if (inlineParse) parseStage.poll();
+  }
+  transport->endTap();
+  if (inlineParse) parseStage.poll();
+}
+
+#ifdef USE_SIMULATED_CARD
+struct E05_Read {
+  const EMV_SimCardProfile* profile;
+  EMV_Session* session;
+  EMV_PipelineTransport* transport;
+  const char* reader;
+};
+
+// the taps with the parse stage inline, returns the time
+uint32_t run_E05_Inline_Taps() {
+  pipelineTapsWithPan = 0;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < E05_BENCHMARK_TAPS; i++) runPipelineTap(&pipelineSession, &pipelineTransport, true);
+  return micros() - start;
+}
+
+void run_E05_Pipeline_Benchmark() {
+  pipelinePrintResults = false;
+
+  // inline: the same task does the I/O and the parsing, first with the I/O stage decoding the
+  // track 2 and the records as well
+  pipelineEmv.captureOnly = false;
+  uint32_t decodingMicros = run_E05_Inline_Taps();
+  pipelineEmv.captureOnly = true;
+  uint32_t inlineMicros = run_E05_Inline_Taps();
+  uint32_t inlineTapsWithPan = pipelineTapsWithPan;
+  bool isEveryPanRead = inlineTapsWithPan == E05_BENCHMARK_TAPS;
+
+  Serial.println(DIVIDER);
+  Serial.printf("E05 %d taps inline, I/O stage decoding %8lu us\n", E05_BENCHMARK_TAPS, (unsigned long)decodingMicros);
+  Serial.printf("E05 %d taps inline, capture only       %8lu us, %lu taps with PAN\n", E05_BENCHMARK_TAPS, (unsigned long)inlineMicros,
+                (unsigned long)inlineTapsWithPan);
+
+  // pipelined: the parse stage runs on core 0
+  const E05_Read reads[] = {
+    { &EMV_SIM_PROFILE_VISA, &pipelineSession, &pipelineTransport, "" },
+    { &EMV_SIM_PROFILE_MASTERCARD, &pipelineSession, &pipelineTransport, "" },
+    { &EMV_SIM_PROFILE_VISA_CHUNKED, &pipelineSession, &pipelineTransport, "" },
+    { &EMV_SIM_PROFILE_MASTERCARD_EXACT_LE, &pipelineSession, &pipelineTransport, "" },
+    { &EMV_SIM_PROFILE_VISA_CHUNKED, &pipelineFrameSession, &pipelineFrameTransport, ", 64 byte frame" },
+    { &EMV_SIM_PROFILE_MASTERCARD_EXACT_LE, &pipelineFrameSession, &pipelineFrameTransport, ", 64 byte frame" }
+  };
+  for (uint8_t r = 0; r < sizeof(reads) / sizeof(reads[0]); r++) {
+    simCard.setProfile(reads[r].profile);
+    pipelineTapsWithPan = 0;
+    uint32_t ringFull = pipelineRing.fullCount;
+    uint32_t start = micros();
+    parseStage.start(0);
+    for (uint16_t i = 0; i < E05_BENCHMARK_TAPS; i++) runPipelineTap(reads[r].session, reads[r].transport, false);
+    parseStage.stop();
+    uint32_t pipelineMicros = micros() - start;
+    Serial.printf("E05 %d taps pipelined %8lu us, %lu taps with PAN, ring full %lu times, card profile %s%s\n", E05_BENCHMARK_TAPS,
+                  (unsigned long)pipelineMicros, (unsigned long)pipelineTapsWithPan, (unsigned long)(pipelineRing.fullCount - ringFull),
+                  reads[r].profile->name, reads[r].reader);
+    if (pipelineTapsWithPan != E05_BENCHMARK_TAPS) isEveryPanRead = false;
+  }
+  simCard.setProfile(&EMV_SIM_PROFILE_VISA);
+  Serial.printf("E05 the simulated card has no air time, the pipelined time is the handoff between the stages\n");
+  Serial.println(DIVIDER);
+  if (isEveryPanRead) {
+    Serial.println(" E05 Dual Core Pipeline PASSED, every tap gave the PAN");
+  } else {
+    Serial.println(" E05 Dual Core Pipeline FAILED, a tap did not give the PAN");
+#ifndef ARDUINO
+    exit(1);
+#endif
+  }
+  Serial.println(DIVIDER);
+  pipelinePrintResults = true;
+}
+#endif
+
+void setup_E05_Dual_Core_Pipeline() {
+  // the I/O stage prints and decodes nothing, the track 2 and the records are decoded by the parse stage
+  pipelineEmv.captureOnly = true;
+  pipelineEmv.setDebugPrint(false);
+#ifdef USE_SIMULATED_CARD
+  pipelineFrameEmv.captureOnly = true;
+  pipelineFrameEmv.setDebugPrint(false);
+  run_E05_Pipeline_Benchmark();
+#endif
+  parseStage.start(0);
+}
+
+// called from loop(), one step of the I/O stage per call
+void run_E05_Dual_Core_Pipeline() {
+  EMV_SessionState state = pipelineSession.getState();
+  if (state == EMV_SESSION_IDLE || (pipelineSession.isFinished() && millis() - pipelineFinishedMillis >= E05_NEXT_READ_MILLIS)) {
+    pipelineSession.begin();
+    return;
+  }
+  if (pipelineSession.isFinished()) return;
+  if (pipelineSession.step() == EMV_SESSION_POLL) return;
+  if (pipelineSession.isFinished()) {
+    pipelineTransport.endTap();
+    pipelineFinishedMillis = millis();
+  }
+}
@@ -0,0 +1,157 @@
+// Checks that a complete card read does not allocate heap memory after the init.
+// The global operator new is replaced by a counting version, on Linux (glibc, no ARDUINO)
+// malloc, calloc and realloc are counted as well. On the ESP32 the allocated heap blocks are
+// compared before and after the reads, so a malloc that is never freed is found there too.
+// E06_TRANSACTIONS complete reads (all AIDs and records, debug output off) run against the
+// simulated cards after one read per card to warm up. The cards answer with 90 00, in parts
+// (61xx) and with the exact Le (6Cxx), the last two also behind the 64 byte packet buffer of the
+// stock Adafruit_PN532 library. Any allocation or a read without a PAN fails the check, on Linux
+// the program exits with code 1 so the check can run in a script.
+
+#include "EMV_Session.h"
+#include "EMV_SimCard.h"
+#ifdef ARDUINO
+#include "esp_heap_caps.h"
+#endif
+
+const uint16_t E06_TRANSACTIONS = 1000;
+
+volatile bool heapCounting = false;    // allocations are counted while true
+volatile uint32_t heapAllocations = 0;
+
+#if !defined(ARDUINO) && defined(__GLIBC__)
+#define E06_COUNT_MALLOC
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t number, size_t size);
+extern "C" void* __libc_realloc(void* block, size_t size);
+
+extern "C" void* malloc(size_t size) {
+  if (heapCounting) heapAllocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t number, size_t size) {
+  if (heapCounting) heapAllocations++;
+  return __libc_calloc(number, size);
+}
+
+extern "C" void* realloc(void* block, size_t size) {
+  if (heapCounting) heapAllocations++;
+  return __libc_realloc(block, size);
+}
+#endif
+
+void* operator new(size_t size) {
+#ifndef E06_COUNT_MALLOC
+  if (heapCounting) heapAllocations++;  // else counted by malloc()
+#endif
+  void* block = malloc(size);
+  if (block == NULL) abort();
+  return block;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+  free(block);
+}
+
+void operator delete[](void* block) noexcept {
+  free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+  free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+  free(block);
+}
+
+EMV_SimCard allocationCard(&EMV_SIM_PROFILE_VISA);
+ESP32_EMV allocationEmv(&allocationCard);
+EMV_Session allocationSession(&allocationEmv);
+EMV_SimReaderFrame allocationFrame(&allocationCard, EMV_PN532_PACKBUFFSIZ_STOCK);
+ESP32_EMV allocationFrameEmv(&allocationFrame);
+EMV_Session allocationFrameSession(&allocationFrameEmv);
+
+struct E06_Read {
+  const EMV_SimCardProfile* profile;
+  EMV_Session* session;
+  const char* reader;
+};
+
+// one complete read, returns true if the PAN was found
+bool runAllocationCheckRead(EMV_Session* session) {
+  allocationCard.reset();
+  session->begin();
+  while (!session->isFinished()) session->step();
+  return session->panLen > 0;
+}
+
+void run_E06_Allocation_Check() {
+  Serial.println();
+  Serial.println(DIVIDER);
+  Serial.println(" E06 Allocation Check");
+  Serial.println(DIVIDER);
+
+  allocationEmv.setDebugPrint(false);
+  allocationFrameEmv.setDebugPrint(false);
+
+  const E06_Read reads[] = {
+    { &EMV_SIM_PROFILE_VISA, &allocationSession, "" },
+    { &EMV_SIM_PROFILE_MASTERCARD, &allocationSession, "" },
+    { &EMV_SIM_PROFILE_VISA_CHUNKED, &allocationSession, "" },
+    { &EMV_SIM_PROFILE_MASTERCARD_EXACT_LE, &allocationSession, "" },
+    { &EMV_SIM_PROFILE_VISA_CHUNKED, &allocationFrameSession, ", 64 byte frame" },
+    { &EMV_SIM_PROFILE_MASTERCARD_EXACT_LE, &allocationFrameSession, ", 64 byte frame" }
+  };
+  uint32_t totalAllocations = 0;
+  bool isEveryPanRead = true;
+  for (uint8_t r = 0; r < sizeof(reads) / sizeof(reads[0]); r++) {
+    allocationCard.setProfile(reads[r].profile);
+    runAllocationCheckRead(reads[r].session);  // warm up
+
+#ifdef ARDUINO
+    multi_heap_info_t heapBefore;
+    heap_caps_get_info(&heapBefore, MALLOC_CAP_DEFAULT);
+#endif
+    uint16_t readsWithPan = 0;
+    heapAllocations = 0;
+    heapCounting = true;
+    for (uint16_t i = 0; i < E06_TRANSACTIONS; i++) {
+      if (runAllocationCheckRead(reads[r].session)) readsWithPan++;
+    }
+    heapCounting = false;
+    uint32_t allocations = heapAllocations;
+#ifdef ARDUINO
+    multi_heap_info_t heapAfter;
+    heap_caps_get_info(&heapAfter, MALLOC_CAP_DEFAULT);
+    if (heapAfter.allocated_blocks > heapBefore.allocated_blocks) {
+      allocations += heapAfter.allocated_blocks - heapBefore.allocated_blocks;
+    }
+#endif
+    Serial.printf("Card profile %s%s: %d reads, %d with PAN, %lu heap allocations\n", reads[r].profile->name, reads[r].reader,
+                  E06_TRANSACTIONS, readsWithPan, (unsigned long)allocations);
+    totalAllocations += allocations;
+    if (readsWithPan != E06_TRANSACTIONS) isEveryPanRead = false;
+  }
+
+  Serial.println(DIVIDER);
+  if (totalAllocations == 0 && isEveryPanRead) {
+    Serial.println(" E06 Allocation Check PASSED, a read allocates no heap memory");
+  } else if (!isEveryPanRead) {
+    Serial.println(" E06 Allocation Check FAILED, a read did not find the PAN");
+#ifndef ARDUINO
+    exit(1);
+#endif
+  } else {
+    Serial.printf(" E06 Allocation Check FAILED, %lu heap allocations during the reads\n", (unsigned long)totalAllocations);
+#ifndef ARDUINO
+    exit(1);
+#endif
+  }
+  Serial.println(DIVIDER);
+}
@@ -0,0 +1,137 @@
+// Reads all cards of one activation, e.g. a wallet with two cards in front of the reader.
+// emv.DetectCards lists up to EMV_MAX_CARDS cards, then the read flow runs for every card by its
+// number (EMV_Session::beginCard) and both results are printed. The cards stay activated, so
+// the second card needs no poll and no new tap.
+// When the sketch starts the same reads run against a simulated field with a Visa and a
+// MasterCard card and are compared with two separate taps (one card in the field per activation).
+// The check passes if every read finds the PAN and one activation serves both cards. The time an
+// activation takes is not known without a reader, the saved time is printed as an estimate with
+// E07_ACTIVATION_MICROS per activation. The PN532 lists one card (EMV_PN532Transport has no
+// detectCards), so on the reader the saving does not apply yet.
+
+#include "EMV_Session.h"
+#include "EMV_SimCard.h"
+
+const uint16_t E07_TRANSACTIONS = 100;
+// an assumed time of one activation by the reader for the estimate, it is not measured
+const uint32_t E07_ACTIVATION_MICROS = 5000;
+
+struct E07_CardResult {
+  EMV_SessionState state;
+  byte pan[10];
+  uint8_t panLen;
+  byte expDate[3];
+  uint8_t expDateLen;
+};
+
+E07_CardResult twoCardResults[EMV_MAX_CARDS];
+EMV_Session twoCardSession(&emv);
+
+// the instances of the simulated field are global, an ESP32_EMV object is too large for the stack
+EMV_SimCard twoCardVisa(&EMV_SIM_PROFILE_VISA);
+EMV_SimCard twoCardMasterCard(&EMV_SIM_PROFILE_MASTERCARD);
+EMV_SimField twoCardField;
+ESP32_EMV twoCardEmv(&twoCardField);
+EMV_Session twoCardFieldSession(&twoCardEmv);
+
+// runs the read flow for the cards 0 .. numberOfCards - 1 of the last DetectCards
+void readListedCards(EMV_Session* session, byte numberOfCards, E07_CardResult* results) {
+  for (byte i = 0; i < numberOfCards; i++) {
+    session->beginCard(i);
+    while (!session->isFinished()) session->step();
+    results[i].state = session->getState();
+    memcpy(results[i].pan, session->pan, session->panLen);
+    results[i].panLen = session->panLen;
+    memcpy(results[i].expDate, session->expDate, session->expDateLen);
+    results[i].expDateLen = session->expDateLen;
+  }
+}
+
+void printCardResults(byte numberOfCards, E07_CardResult* results) {
+  for (byte i = 0; i < numberOfCards; i++) {
+    Serial.printf("Card %d: %s PAN", i, EMV_Session::stateText(results[i].state));
+    emv.printHex(results[i].pan, results[i].panLen);
+    Serial.print(" ExpDate");
+    emv.printHex(results[i].expDate, results[i].expDateLen);
+    Serial.println();
+  }
+}
+
+void run_E07_Two_Card_Benchmark() {
+  Serial.println();
+  Serial.println(DIVIDER);
+  Serial.println(" E07 Two Card Read");
+  Serial.println(DIVIDER);
+
+  twoCardEmv.setDebugPrint(false);
+  twoCardField.addCard(&twoCardVisa);
+  twoCardField.addCard(&twoCardMasterCard);
+
+  // both cards with one activation
+  E07_CardResult results[EMV_MAX_CARDS];
+  uint16_t readsWithPan = 0;
+  twoCardField.activations = 0;
+  uint32_t start = micros();
+  for (uint16_t t = 0; t < E07_TRANSACTIONS; t++) {
+    byte numberOfCards = twoCardEmv.DetectCards(EMV_MAX_CARDS);
+    readListedCards(&twoCardFieldSession, numberOfCards, results);
+    for (byte i = 0; i < numberOfCards; i++) {
+      if (results[i].panLen > 0) readsWithPan++;
+    }
+  }
+  uint32_t oneActivationMicros = micros() - start;
+  uint32_t oneActivationCount = twoCardField.activations;
+  printCardResults(EMV_MAX_CARDS, results);
+  Serial.printf("One activation:  %d reads with PAN, %lu activations, %lu us\n", readsWithPan, (unsigned long)oneActivationCount,
+                (unsigned long)oneActivationMicros);
+
+  // the same cards in two separate taps, only one card is in the field at a time
+  uint16_t separateReadsWithPan = 0;
+  twoCardField.activations = 0;
+  start = micros();
+  for (uint16_t t = 0; t < E07_TRANSACTIONS; t++) {
+    for (byte c = 0; c < EMV_MAX_CARDS; c++) {
+      twoCardVisa.present = (c == 0);
+      twoCardMasterCard.present = (c == 1);
+      twoCardFieldSession.begin();
+      while (!twoCardFieldSession.isFinished()) twoCardFieldSession.step();
+      if (twoCardFieldSession.panLen > 0) separateReadsWithPan++;
+    }
+  }
+  uint32_t separateMicros = micros() - start;
+  twoCardVisa.present = true;
+  twoCardMasterCard.present = true;
+  Serial.printf("Separate taps:   %d reads with PAN, %lu activations, %lu us\n", separateReadsWithPan,
+                (unsigned long)twoCardField.activations, (unsigned long)separateMicros);
+
+  uint32_t separateCount = twoCardField.activations;
+  uint32_t savedActivations = separateCount - oneActivationCount;
+  Serial.printf("Estimate: %lu activations saved, at %lu us per activation (assumed) %lu us per wallet\n",
+                (unsigned long)savedActivations, (unsigned long)E07_ACTIVATION_MICROS,
+                (unsigned long)((uint64_t)savedActivations * E07_ACTIVATION_MICROS / E07_TRANSACTIONS));
+
+  Serial.println(DIVIDER);
+  if (readsWithPan == separateReadsWithPan && readsWithPan == EMV_MAX_CARDS * E07_TRANSACTIONS && oneActivationCount == E07_TRANSACTIONS
+      && separateCount == EMV_MAX_CARDS * E07_TRANSACTIONS) {
+    Serial.println(" E07 Two Card Read PASSED, one activation reads both cards");
+  } else {
+    Serial.println(" E07 Two Card Read FAILED");
+#ifndef ARDUINO
+    exit(1);
+#endif
+  }
+  Serial.println(DIVIDER);
+}
+
+// one activation of the reader, every card found is read
+void run_E07_Two_Card_Read() {
+  byte numberOfCards = emv.DetectCards(EMV_MAX_CARDS);
+  if (numberOfCards == 0) return;
+  Serial.println(DIVIDER);
+  Serial.printf(" E07 Two Card Read: found %d card(s)\n", numberOfCards);
+  uint32_t start = millis();
+  readListedCards(&twoCardSession, numberOfCards, twoCardResults);
+  printCardResults(numberOfCards, twoCardResults);
+  Serial.printf("Read in %lu ms\n", (unsigned long)(millis() - start));
+  Serial.println(DIVIDER);
+}
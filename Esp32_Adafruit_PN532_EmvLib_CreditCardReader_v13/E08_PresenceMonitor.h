@@ -0,0 +1,32 @@
+// Reads a card once when it arrives and waits until it is removed, without a blocking poll.
+// EMV_PresenceMonitor checks the field every E08_POLL_PERIOD_MILLIS, so a new card is found
+// within tens of milliseconds and a card that stays on the reader is not read again.
+// The E01 read runs on EMV_PRESENCE_ARRIVED, without the pauses between the AIDs.
+
+#include "EMV_Presence.h"
+
+const uint32_t E08_POLL_PERIOD_MILLIS = 20;
+// failed presence checks in a row that are retried before the card counts as removed
+const byte E08_REMOVAL_RETRIES = 2;
+
+EMV_PresenceMonitor presenceMonitor(&emv);
+
+void setup_E08_Presence_Monitor() {
+  presenceMonitor.setPollPeriod(E08_POLL_PERIOD_MILLIS);
+  presenceMonitor.setRemovalRetries(E08_REMOVAL_RETRIES);
+}
+
+void run_E08_Presence_Monitor() {
+  EMV_PresenceEvent event = presenceMonitor.update();
+  if (event == EMV_PRESENCE_ARRIVED) {
+    Serial.println(DIVIDER);
+    Serial.println(" E08 Presence Monitor: card arrived");
+    run_E01_Credit_Card_Handling();
+    Serial.printf("Read in %lu ms, remove the card\n", (unsigned long)(millis() - presenceMonitor.arrivedMillis));
+  } else if (event == EMV_PRESENCE_REMOVED) {
+    Serial.printf(" E08 Presence Monitor: card removed after %lu ms in the field, %lu failed presence checks\n",
+                  (unsigned long)(presenceMonitor.removedMillis - presenceMonitor.arrivedMillis), (unsigned long)presenceMonitor.failedChecks);
+    Serial.println(DIVIDER);
+    Serial.println("Waiting for an ISO14443A card");
+  }
+}
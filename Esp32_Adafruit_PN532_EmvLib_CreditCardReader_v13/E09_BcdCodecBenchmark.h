@@ -0,0 +1,156 @@
+// Checks the BCD codec of EMV_Bcd.h with valid and broken data elements and compares its
+// throughput with the tag 57 decoder the library used up to V13 (one sprintf and one strcat per
+// nibble). The test data is the track 2 of the simulated Visa card and the PAN and dates of the
+// simulated MasterCard card together with broken variants of them.
+
+#include "EMV_Bcd.h"
+
+const uint32_t BCD_BENCHMARK_ROUNDS = 20000;
+
+struct E09_Track2Vector {
+  const char* name;
+  byte data[EMV_CARD_MAX_TRACK2];
+  uint8_t len;
+  EMV_BcdStatus status;
+  const char* pan;
+};
+
+static const E09_Track2Vector E09_TRACK2_VECTORS[] = {
+  { "Visa", { 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0xD2, 0x80, 0x22, 0x01, 0x00, 0x00, 0x01, 0x73, 0x01, 0x00, 0x0F }, 19, EMV_BCD_OK, "4163691002567114" },
+  { "odd PAN", { 0x41, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0D, 0x28, 0x12, 0x20, 0x1F }, 14, EMV_BCD_OK, "4111111111111111110" },
+  { "Luhn", { 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x15, 0xD2, 0x80, 0x22, 0x01 }, 12, EMV_BCD_LUHN_FAILED, "4163691002567115" },
+  { "no separator", { 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0x2F }, 9, EMV_BCD_NO_SEPARATOR, "" },
+  { "invalid digit", { 0x41, 0x63, 0x6A, 0x10, 0x02, 0x56, 0x71, 0x14, 0xD2, 0x80, 0x22, 0x01 }, 12, EMV_BCD_INVALID_DIGIT, "" },
+  { "PAN too long", { 0x41, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xD2, 0x81, 0x22, 0x01 }, 14, EMV_BCD_PAN_TOO_LONG, "" },
+  { "PAN too short", { 0x41, 0x11, 0xD2, 0x81, 0x22, 0x01 }, 6, EMV_BCD_PAN_TOO_SHORT, "" },
+  { "padded date", { 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0xD2, 0x8F, 0x01 }, 11, EMV_BCD_INVALID_DIGIT, "" },
+  { "no date", { 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0xD2 }, 9, EMV_BCD_INVALID_LENGTH, "" },
+  { "month 13", { 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0xD2, 0x81, 0x32, 0x01 }, 12, EMV_BCD_INVALID_DATE, "" },
+  { "empty", {}, 0, EMV_BCD_EMPTY, "" },
+};
+
+// the tag 57 decoder of the library up to V13, bChar got a byte for the terminator
+uint8_t decodeTrack2WithSprintf(const byte* track2, uint8_t track2Len, char* panChar, char* expDateChar) {
+  uint8_t panCharLen = 0;
+  uint8_t expDateCharLen = 0;
+  bool isPanDelimiterFound = false;
+  uint8_t posIndex = 0;
+  char bChar[3];
+  panChar[0] = 0;
+  expDateChar[0] = 0;
+  while (!isPanDelimiterFound && posIndex < track2Len) {
+    byte upperByte = (track2[posIndex] & 0xF0) >> 4;
+    byte lowerByte = (track2[posIndex] & 0x0F);
+    if (upperByte != 0xd) {
+      sprintf(bChar, "%x", upperByte);
+      strcat(panChar, bChar);
+      panCharLen++;
+      if (lowerByte != 0xd) {
+        sprintf(bChar, "%x", lowerByte);
+        strcat(panChar, bChar);
+        panCharLen++;
+      }
+    }
+    if ((upperByte == 0xd) || (lowerByte == 0xd)) {
+      if (upperByte == 0xd) {
+        sprintf(bChar, "%x", lowerByte);
+        strcpy(expDateChar, bChar);
+        expDateCharLen++;
+      }
+      isPanDelimiterFound = true;
+    }
+    posIndex++;
+  }
+  while (expDateCharLen < 4 && posIndex < track2Len) {
+    byte upperByte = (track2[posIndex] & 0xF0) >> 4;
+    byte lowerByte = (track2[posIndex] & 0x0F);
+    sprintf(bChar, "%x", upperByte);
+    strcat(expDateChar, bChar);
+    expDateCharLen++;
+    if (expDateCharLen < 4) {
+      sprintf(bChar, "%x", lowerByte);
+      strcat(expDateChar, bChar);
+      expDateCharLen++;
+    }
+    posIndex++;
+  }
+  return panCharLen;
+}
+
+bool checkBcdVectors() {
+  bool isPassed = true;
+  EMV_Track2 track2;
+  for (uint8_t i = 0; i < sizeof(E09_TRACK2_VECTORS) / sizeof(E09_TRACK2_VECTORS[0]); i++) {
+    const E09_Track2Vector* vector = &E09_TRACK2_VECTORS[i];
+    EMV_BcdStatus status = EMV_DecodeTrack2(vector->data, vector->len, &track2);
+    bool isOk = status == vector->status && strcmp(track2.pan, vector->pan) == 0;
+    Serial.printf("Track 2 %-14s %-18s %-20s %s\n", vector->name, EMV_BcdStatusText(status), track2.pan, isOk ? "ok" : "WRONG");
+    if (!isOk) isPassed = false;
+  }
+
+  // tag 5A and 5F24 / 5F25 of the MasterCard record
+  static const byte PAN_MC[] = { 0x54, 0x13, 0x33, 0x00, 0x89, 0x01, 0x04, 0x34 };
+  static const byte PAN_PADDED[] = { 0x41, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0F };
+  static const byte PAN_INNER_PADDING[] = { 0x54, 0x13, 0x33, 0xFF, 0x89, 0x01, 0x04, 0x34 };
+  static const byte DATE_EXPIRATION[] = { 0x28, 0x12, 0x31 };
+  static const byte DATE_FEBRUARY_30[] = { 0x28, 0x02, 0x30 };
+  char pan[EMV_BCD_MAX_PAN_DIGITS + 1];
+  uint8_t panLen;
+  char date[7];
+  bool isOk = EMV_DecodePan(PAN_MC, sizeof(PAN_MC), pan, &panLen) == EMV_BCD_OK && strcmp(pan, "5413330089010434") == 0;
+  isOk = isOk && EMV_DecodePan(PAN_PADDED, sizeof(PAN_PADDED), pan, &panLen) == EMV_BCD_OK && panLen == 19;
+  isOk = isOk && EMV_DecodePan(PAN_INNER_PADDING, sizeof(PAN_INNER_PADDING), pan, &panLen) == EMV_BCD_INVALID_DIGIT && panLen == 0;
+  isOk = isOk && EMV_DecodeDate(DATE_EXPIRATION, sizeof(DATE_EXPIRATION), date) == EMV_BCD_OK && strcmp(date, "281231") == 0;
+  isOk = isOk && EMV_DecodeDate(DATE_FEBRUARY_30, sizeof(DATE_FEBRUARY_30), date) == EMV_BCD_INVALID_DATE;
+  isOk = isOk && EMV_DecodeDate(DATE_EXPIRATION, 2, date) == EMV_BCD_INVALID_LENGTH;
+  byte bcd[EMV_BCD_MAX_PAN];
+  isOk = isOk && EMV_EncodeBcd("4111111111111111110", 19, bcd) == sizeof(PAN_PADDED) && memcmp(bcd, PAN_PADDED, sizeof(PAN_PADDED)) == 0;
+  Serial.printf("PAN, dates and encoding %s\n", isOk ? "ok" : "WRONG");
+  return isPassed && isOk;
+}
+
+void run_E09_Bcd_Codec_Benchmark() {
+  Serial.println();
+  Serial.println(DIVIDER);
+  Serial.println(" E09 BCD Codec Benchmark");
+  Serial.println(DIVIDER);
+
+  bool isPassed = checkBcdVectors();
+
+  const E09_Track2Vector* visa = &E09_TRACK2_VECTORS[0];
+  char panChar[EMV_BCD_MAX_PAN_DIGITS + 1];
+  char expDateChar[EMV_CARD_MAX_EXP_DATE_DIGITS + 1];
+  uint32_t digitsSprintf = 0;
+  uint32_t start = micros();
+  for (uint32_t round = 0; round < BCD_BENCHMARK_ROUNDS; round++) {
+    digitsSprintf += decodeTrack2WithSprintf(visa->data, visa->len, panChar, expDateChar);
+  }
+  uint32_t sprintfMicros = micros() - start;
+
+  EMV_Track2 track2;
+  uint32_t digitsCodec = 0;
+  start = micros();
+  for (uint32_t round = 0; round < BCD_BENCHMARK_ROUNDS; round++) {
+    if (EMV_DecodeTrack2(visa->data, visa->len, &track2) == EMV_BCD_OK) digitsCodec += track2.panLen;
+  }
+  uint32_t codecMicros = micros() - start;
+
+  Serial.printf("%lu rounds over the %d bytes of the Visa track 2\n", (unsigned long)BCD_BENCHMARK_ROUNDS, visa->len);
+  Serial.printf("sprintf/strcat %8lu us, %lu ns/track 2, %lu PAN digits\n", (unsigned long)sprintfMicros,
+                (unsigned long)((uint64_t)sprintfMicros * 1000 / BCD_BENCHMARK_ROUNDS), (unsigned long)digitsSprintf);
+  Serial.printf("EMV_Bcd        %8lu us, %lu ns/track 2, %lu PAN digits (with Luhn check)\n", (unsigned long)codecMicros,
+                (unsigned long)((uint64_t)codecMicros * 1000 / BCD_BENCHMARK_ROUNDS), (unsigned long)digitsCodec);
+  if (digitsSprintf != digitsCodec) isPassed = false;
+
+  Serial.println(DIVIDER);
+  if (isPassed) {
+    Serial.println(" E09 BCD Codec Benchmark PASSED");
+  } else {
+    Serial.println(" E09 BCD Codec Benchmark FAILED");
+#ifndef ARDUINO
+    exit(1);
+#endif
+  }
+  Serial.println(DIVIDER);
+  Serial.println();
+}
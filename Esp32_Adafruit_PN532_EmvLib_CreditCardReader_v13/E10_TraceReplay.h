@@ -0,0 +1,154 @@
+// Checks the APDU traces of EMV_Trace.h. A read of the simulated Visa card is recorded with
+// EMV_TraceRecorder, on Linux (no ARDUINO) the log of Sample_CreditCard_Reading_Log.md is
+// imported as well, written to a file and mapped back into memory. Every trace is replayed
+// through EMV_ReplayTransport and EMV_Session: the replay has to find the PAN of the card and
+// every command of the read flow in the trace. A log with lines that do not have the logged length
+// has to be rejected by the import. On Linux a failed check exits with code 1.
+
+#include "EMV_Trace.h"
+#include "EMV_Session.h"
+#include "EMV_SimCard.h"
+#ifndef ARDUINO
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+#define E10_TRACE_SIZE 8192
+const char* E10_PAN = "4163691002567114";  // the Visa card of the sample log and of EMV_SIM_PROFILE_VISA
+
+byte traceBuffer[E10_TRACE_SIZE];
+EMV_TraceWriter traceWriter;
+EMV_SimCard traceCard(&EMV_SIM_PROFILE_VISA);
+EMV_TraceRecorder traceRecorder(&traceCard, &traceWriter);
+ESP32_EMV recordEmv(&traceRecorder);
+EMV_Session recordSession(&recordEmv);
+
+EMV_TraceReader traceReader;
+EMV_ReplayTransport replayTransport(&traceReader);
+ESP32_EMV replayEmv(&replayTransport);
+EMV_Session replaySession(&replayEmv);
+
+// replays the first session of a complete trace
+bool run_E10_Replay(const char* name, const byte* trace, uint32_t traceSize) {
+  if (!traceReader.begin(trace, traceSize) || !replayTransport.selectSession(0)) {
+    Serial.printf("%-14s the trace is invalid\n", name);
+    return false;
+  }
+  replayTransport.mismatchCount = 0;
+  replayEmv.lePolicy = EMV_LePolicy();  // the first Le of the recorded read
+  replaySession.begin();
+  while (!replaySession.isFinished()) replaySession.step();
+  char pan[EMV_BCD_MAX_PAN_DIGITS + 1];
+  uint8_t panLen;
+  EMV_DecodePan(replaySession.pan, replaySession.panLen, pan, &panLen);
+  bool isOk = strcmp(pan, E10_PAN) == 0 && replayTransport.mismatchCount == 0;
+  Serial.printf("%-14s %lu bytes, %d exchanges, replay %-5s PAN %-19s %lu mismatches %s\n", name, (unsigned long)traceSize,
+                traceReader.exchangeCount(0), EMV_Session::stateText(replaySession.getState()), pan,
+                (unsigned long)replayTransport.mismatchCount, isOk ? "ok" : "WRONG");
+  return isOk;
+}
+
+bool run_E10_Recorded_Read() {
+  traceWriter.begin(traceBuffer, sizeof(traceBuffer));
+  traceCard.reset();
+  traceRecorder.beginSession();
+  recordSession.begin();
+  while (!recordSession.isFinished()) recordSession.step();
+  traceRecorder.endSession();
+  if (!traceWriter.finish() || traceWriter.overflow()) {
+    Serial.println("Recorded read  the trace buffer is too small");
+    return false;
+  }
+  return run_E10_Replay("Recorded read", traceWriter.data(), traceWriter.size());
+}
+
+// the second response has one byte less, the third one byte more than logged
+bool run_E10_Broken_Log() {
+  static const char BROKEN_LOG[] =
+    "Found a card!\n"
+    "Send length 5\n 00 B2 01 0C 00\nRecv length 4\n 70 00 90 00\n"
+    "Send length 5\n 00 B2 02 0C 00\nRecv length 4\n 70 00 90\n"
+    "Send length 5\n 00 B2 03 0C 00\nRecv length 4\n 70 00 00 90 00\n";
+  traceWriter.begin(traceBuffer, sizeof(traceBuffer));
+  uint32_t rejected = 0;
+  uint32_t exchanges = EMV_ImportTextLog(BROKEN_LOG, &traceWriter, &rejected);
+  traceWriter.finish();
+  bool isOk = exchanges == 1 && rejected == 2;
+  Serial.printf("Broken log     %lu exchanges imported, %lu rejected %s\n", (unsigned long)exchanges, (unsigned long)rejected,
+                isOk ? "ok" : "WRONG");
+  return isOk;
+}
+
+#ifndef ARDUINO
+// the sample log is next to this file
+bool run_E10_Sample_Log() {
+  char fileName[512];
+  const char* slash = strrchr(__FILE__, '/');
+  int directoryLen = (slash != NULL) ? slash - __FILE__ + 1 : 0;
+  snprintf(fileName, sizeof(fileName), "%.*sSample_CreditCard_Reading_Log.md", directoryLen, __FILE__);
+  FILE* file = fopen(fileName, "rb");
+  if (file == NULL) {
+    Serial.printf("Sample log     %s not found\n", fileName);
+    return false;
+  }
+  static char text[32768];
+  size_t textLen = fread(text, 1, sizeof(text) - 1, file);
+  fclose(file);
+  text[textLen] = 0;
+
+  traceWriter.begin(traceBuffer, sizeof(traceBuffer));
+  uint32_t rejected = 0;
+  uint32_t exchanges = EMV_ImportTextLog(text, &traceWriter, &rejected);
+  if (!traceWriter.finish() || traceWriter.overflow() || exchanges == 0 || rejected > 0) {
+    Serial.printf("Sample log     %lu exchanges imported, %lu rejected, the trace is incomplete\n", (unsigned long)exchanges,
+                  (unsigned long)rejected);
+    return false;
+  }
+
+  // the trace goes through a file, as a trace recorded on the ESP32 would
+  char traceFileName[] = "/tmp/E10_TraceReplay_XXXXXX";
+  int fd = mkstemp(traceFileName);
+  if (fd < 0) return false;
+  bool isWritten = write(fd, traceWriter.data(), traceWriter.size()) == (ssize_t)traceWriter.size();
+  close(fd);
+  uint32_t traceSize = 0;
+  const byte* trace = isWritten ? EMV_MapTraceFile(traceFileName, &traceSize) : NULL;
+  unlink(traceFileName);
+  if (trace == NULL) {
+    Serial.println("Sample log     the trace file could not be mapped");
+    return false;
+  }
+  bool isOk = run_E10_Replay("Sample log", trace, traceSize);
+  EMV_UnmapTraceFile(trace, traceSize);
+  return isOk;
+}
+#endif
+
+void run_E10_Trace_Replay() {
+  Serial.println();
+  Serial.println(DIVIDER);
+  Serial.println(" E10 Trace Replay");
+  Serial.println(DIVIDER);
+
+  recordEmv.setDebugPrint(false);
+  replayEmv.setDebugPrint(false);
+
+  bool isPassed = run_E10_Recorded_Read();
+  isPassed &= run_E10_Broken_Log();
+#ifndef ARDUINO
+  isPassed &= run_E10_Sample_Log();
+#endif
+
+  Serial.println(DIVIDER);
+  if (isPassed) {
+    Serial.println(" E10 Trace Replay PASSED");
+  } else {
+    Serial.println(" E10 Trace Replay FAILED");
+#ifndef ARDUINO
+    exit(1);
+#endif
+  }
+  Serial.println(DIVIDER);
+  Serial.println();
+}
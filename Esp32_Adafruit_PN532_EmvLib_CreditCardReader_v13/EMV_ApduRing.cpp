@@ -0,0 +1,201 @@
+#include "EMV_ApduRing.h"
+
+#define EMV_APDU_RING_DUMP_LINE 32  // bytes per hex line of dump()
+
+static void putU16(byte* p, uint16_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+}
+
+static void putU32(byte* p, uint32_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+static uint16_t getU16(const byte* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const byte* p) {
+  return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_ApduRing
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+void EMV_ApduRing::add(EMV_ApduRingKind kind, byte flags, const byte* data, uint16_t length) {
+  if (length > EMV_APDU_RING_SIZE - EMV_APDU_RING_ENTRY_HEADER_LEN) length = EMV_APDU_RING_SIZE - EMV_APDU_RING_ENTRY_HEADER_LEN;
+  uint32_t needed = EMV_APDU_RING_ENTRY_HEADER_LEN + length;
+  while (EMV_APDU_RING_SIZE - (head - tail) < needed) dropOldest();
+  byte header[EMV_APDU_RING_ENTRY_HEADER_LEN];
+  putU32(header, micros());
+  header[4] = kind;
+  header[5] = flags;
+  putU16(header + 6, length);
+  write(header, sizeof(header));
+  if (length > 0) write(data, length);
+  entries++;
+}
+
+void EMV_ApduRing::clear() {
+  head = 0;
+  tail = 0;
+  entries = 0;
+  droppedEntries = 0;
+}
+
+// at most two copies, the second one after the wrap around
+void EMV_ApduRing::write(const byte* data, uint16_t length) {
+  uint32_t offset = head & (EMV_APDU_RING_SIZE - 1);
+  uint32_t first = EMV_APDU_RING_SIZE - offset;
+  if (first > length) first = length;
+  memcpy(&ring[offset], data, first);
+  memcpy(ring, data + first, length - first);
+  head += length;
+}
+
+void EMV_ApduRing::read(uint32_t position, byte* data, uint16_t length) {
+  uint32_t offset = position & (EMV_APDU_RING_SIZE - 1);
+  uint32_t first = EMV_APDU_RING_SIZE - offset;
+  if (first > length) first = length;
+  memcpy(data, &ring[offset], first);
+  memcpy(data + first, ring, length - first);
+}
+
+void EMV_ApduRing::dropOldest() {
+  byte header[EMV_APDU_RING_ENTRY_HEADER_LEN];
+  read(tail, header, sizeof(header));
+  tail += EMV_APDU_RING_ENTRY_HEADER_LEN + getU16(header + 6);
+  entries--;
+  droppedEntries++;
+}
+
+void EMV_ApduRing::snapshotHeader(byte* header) {
+  header[0] = 'E';
+  header[1] = 'M';
+  header[2] = 'V';
+  header[3] = 'R';
+  header[4] = EMV_APDU_RING_VERSION;
+  header[5] = 0;
+  putU16(header + 6, entries);
+  putU32(header + 8, droppedEntries);
+}
+
+uint32_t EMV_ApduRing::snapshot(byte* buffer, uint32_t bufferSize) {
+  uint32_t size = EMV_APDU_RING_SNAPSHOT_HEADER_LEN + used();
+  if (bufferSize < size) return 0;
+  snapshotHeader(buffer);
+  read(tail, buffer + EMV_APDU_RING_SNAPSHOT_HEADER_LEN, used());
+  return size;
+}
+
+// the snapshot without a buffer for it, the ring is read in place
+void EMV_ApduRing::dump() {
+  byte header[EMV_APDU_RING_SNAPSHOT_HEADER_LEN];
+  snapshotHeader(header);
+  Serial.printf("APDU ring %lu bytes, %d entries, %lu dropped\n", (unsigned long)(sizeof(header) + used()), entries,
+                (unsigned long)droppedEntries);
+  uint32_t total = sizeof(header) + used();
+  for (uint32_t position = 0; position < total; position++) {
+    byte b = (position < sizeof(header)) ? header[position] : ring[(tail + position - sizeof(header)) & (EMV_APDU_RING_SIZE - 1)];
+    Serial.printf("%02X", b);
+    if ((position + 1) % EMV_APDU_RING_DUMP_LINE == 0 || position + 1 == total) Serial.println();
+  }
+  Serial.println("APDU ring end");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_ApduRingReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+bool EMV_ApduRingReader::begin(const byte* data, uint32_t size) {
+  this->data = NULL;
+  if (size < EMV_APDU_RING_SNAPSHOT_HEADER_LEN) return false;
+  if (data[0] != 'E' || data[1] != 'M' || data[2] != 'V' || data[3] != 'R' || data[4] != EMV_APDU_RING_VERSION) return false;
+  this->data = data;
+  this->size = size;
+  entries = getU16(data + 6);
+  dropped = getU32(data + 8);
+  position = EMV_APDU_RING_SNAPSHOT_HEADER_LEN;
+  return true;
+}
+
+bool EMV_ApduRingReader::next(EMV_ApduRingEntry* entry) {
+  if (data == NULL || position + EMV_APDU_RING_ENTRY_HEADER_LEN > size) return false;
+  const byte* p = &data[position];
+  uint16_t length = getU16(p + 6);
+  if ((uint32_t)(EMV_APDU_RING_ENTRY_HEADER_LEN + length) > size - position) return false;  // corrupted snapshot
+  entry->timestamp = getU32(p);
+  entry->kind = (EMV_ApduRingKind)p[4];
+  entry->flags = p[5];
+  entry->length = length;
+  entry->data = p + EMV_APDU_RING_ENTRY_HEADER_LEN;
+  position += EMV_APDU_RING_ENTRY_HEADER_LEN + length;
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Decoding
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+uint32_t EMV_ImportApduRingDump(const char* text, byte* buffer, uint32_t bufferSize) {
+  const char* p = strstr(text, "APDU ring ");
+  if (p == NULL) return 0;
+  while (*p != 0 && *p != '\n') p++;
+  uint32_t size = 0;
+  while (*p != 0) {
+    while (*p == '\n' || *p == '\r' || *p == ' ') p++;
+    if (strncmp(p, "APDU ring end", 13) == 0) return size;
+    int high, low;
+    while ((high = hexValue(p[0])) >= 0 && (low = hexValue(p[1])) >= 0) {
+      if (size == bufferSize) return 0;
+      buffer[size++] = (high << 4) | low;
+      p += 2;
+    }
+    if (*p != '\n' && *p != '\r') return 0;  // not a line of the dump
+  }
+  return 0;  // the end line is missing
+}
+
+uint32_t EMV_ApduRingToTrace(const byte* data, uint32_t size, EMV_TraceWriter* writer) {
+  EMV_ApduRingReader reader;
+  if (!reader.begin(data, size)) return 0;
+  EMV_ApduRingEntry entry;
+  EMV_ApduRingEntry command = {};
+  bool inTap = false;
+  bool haveCommand = false;
+  uint32_t tapStart = 0;
+  uint32_t exchanges = 0;
+  while (reader.next(&entry)) {
+    if (entry.kind == EMV_APDU_RING_TAP) {
+      writer->beginSession();
+      inTap = true;
+      haveCommand = false;
+      tapStart = entry.timestamp;
+    } else if (entry.kind == EMV_APDU_RING_COMMAND) {
+      command = entry;
+      haveCommand = true;
+    } else if (entry.kind == EMV_APDU_RING_RESPONSE && inTap && haveCommand) {
+      if (writer->addExchange(command.timestamp - tapStart, command.data, command.length, entry.data, entry.length, entry.flags)) exchanges++;
+      haveCommand = false;
+    }
+  }
+  if (inTap) writer->endSession();
+  return exchanges;
+}
@@ -0,0 +1,97 @@
+/**
+ * An always-on APDU ring for the ESP32_EMV library.
+ * ESP32_EMV::EMV_Exchange appends every command and response in binary form to a fixed
+ * size ring in RAM (emv.apduRing = &ring), SelectPpse adds a tap marker for every new card.
+ * When the ring is full the oldest entries are dropped, so the ring always holds the last taps.
+ * Appending an entry is a header and a memcpy, there is no formatting and no Serial output.
+ * dump() prints the ring as hex lines on demand or after an error, on a PC EMV_ImportApduRingDump
+ * converts the lines back, EMV_ApduRingReader reads the entries and EMV_ApduRingToTrace writes
+ * them as an EMV_Trace (see EMV_Trace.h) that EMV_ReplayTransport can replay.
+ * The ring is not locked, append and dump from the same task.
+ *
+ * Entry             8 bytes  u32 timestamp (micros()), u8 kind, u8 flags (bit 0 = transceive
+ *                            succeeded, as in EMV_Trace), u16 length, followed by length data bytes
+ * Snapshot header  12 bytes  'E' 'M' 'V' 'R', version, reserved, u16 entryCount, u32 droppedEntries
+ *                            followed by the entries, the oldest first
+ * All numbers little endian.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_ApduRing_h
+#define EMV_ApduRing_h
+
+#include "Arduino.h"
+#include "EMV_Trace.h"
+
+#define EMV_APDU_RING_SIZE 2048  // a power of 2
+#define EMV_APDU_RING_VERSION 1
+#define EMV_APDU_RING_ENTRY_HEADER_LEN 8
+#define EMV_APDU_RING_SNAPSHOT_HEADER_LEN 12
+
+enum EMV_ApduRingKind : byte {
+  EMV_APDU_RING_COMMAND = 0,
+  EMV_APDU_RING_RESPONSE = 1,
+  EMV_APDU_RING_TAP = 2  // a new card, no data
+};
+
+struct EMV_ApduRingEntry {
+  uint32_t timestamp;
+  EMV_ApduRingKind kind;
+  byte flags;
+  uint16_t length;
+  const byte* data;  // points into the snapshot
+};
+
+class EMV_ApduRing {
+
+public:
+  void add(EMV_ApduRingKind kind, byte flags, const byte* data, uint16_t length);
+  void beginTap() { add(EMV_APDU_RING_TAP, 0, NULL, 0); }
+  void clear();
+
+  // copies the entries (oldest first) behind a snapshot header, returns the size or 0 if the buffer is too small
+  uint32_t snapshot(byte* buffer, uint32_t bufferSize);
+  // prints the snapshot as hex lines between "APDU ring" and "APDU ring end"
+  void dump();
+
+  uint16_t entryCount() { return entries; }
+  uint32_t used() { return head - tail; }
+  uint32_t droppedEntries = 0;  // entries overwritten by newer ones
+
+private:
+  byte ring[EMV_APDU_RING_SIZE];
+  uint32_t head = 0;  // free running positions, masked on access
+  uint32_t tail = 0;
+  uint16_t entries = 0;
+
+  void write(const byte* data, uint16_t length);
+  void read(uint32_t position, byte* data, uint16_t length);
+  void dropOldest();
+  void snapshotHeader(byte* header);
+};
+
+// Reads the entries of a snapshot in place
+class EMV_ApduRingReader {
+
+public:
+  bool begin(const byte* data, uint32_t size);
+  bool next(EMV_ApduRingEntry* entry);
+  uint16_t entryCount() { return entries; }
+  uint32_t droppedEntries() { return dropped; }
+
+private:
+  const byte* data = NULL;
+  uint32_t size = 0;
+  uint32_t position = 0;
+  uint16_t entries = 0;
+  uint32_t dropped = 0;
+};
+
+// Converts the hex lines of dump() back into a snapshot, returns the size or 0 on error
+uint32_t EMV_ImportApduRingDump(const char* text, byte* buffer, uint32_t bufferSize);
+// Writes every tap of a snapshot as a session of a trace, returns the number of exchanges.
+// Exchanges before the first tap marker (the tap was partly dropped) are skipped.
+uint32_t EMV_ApduRingToTrace(const byte* data, uint32_t size, EMV_TraceWriter* writer);
+
+#endif
@@ -0,0 +1,195 @@
+#include "EMV_Bcd.h"
+
+#define NIBBLE_DIGIT 0
+#define NIBBLE_INVALID 1
+#define NIBBLE_SEPARATOR 2  // 'D' of track 2
+#define NIBBLE_PADDING 3    // 'F' at the end of cn data and track 2
+
+static const byte NIBBLE_CLASS[16] = {
+  NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_DIGIT,
+  NIBBLE_DIGIT, NIBBLE_DIGIT, NIBBLE_INVALID, NIBBLE_INVALID, NIBBLE_INVALID, NIBBLE_SEPARATOR, NIBBLE_INVALID, NIBBLE_PADDING
+};
+
+// the two characters of byte b are at BYTE_CHARS[2 * b]
+static const char BYTE_CHARS[] =
+  "000102030405060708090A0B0C0D0E0F"
+  "101112131415161718191A1B1C1D1E1F"
+  "202122232425262728292A2B2C2D2E2F"
+  "303132333435363738393A3B3C3D3E3F"
+  "404142434445464748494A4B4C4D4E4F"
+  "505152535455565758595A5B5C5D5E5F"
+  "606162636465666768696A6B6C6D6E6F"
+  "707172737475767778797A7B7C7D7E7F"
+  "808182838485868788898A8B8C8D8E8F"
+  "909192939495969798999A9B9C9D9E9F"
+  "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+  "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+  "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+  "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+  "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+  "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+// the Luhn algorithm doubles every second digit and adds the digits of the product
+static const byte LUHN_DOUBLE[10] = { 0, 2, 4, 6, 8, 1, 3, 5, 7, 9 };
+
+// February has 29 days, the year of an EMV date has no century
+static const byte DAYS_OF_MONTH[13] = { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+static byte nibbleAt(const byte* data, uint16_t position) {
+  return (position & 1) ? (data[position / 2] & 0x0F) : (data[position / 2] >> 4);
+}
+
+static bool isDigitByte(byte b) {
+  return NIBBLE_CLASS[b >> 4] == NIBBLE_DIGIT && NIBBLE_CLASS[b & 0x0F] == NIBBLE_DIGIT;
+}
+
+static uint8_t twoDigits(const char* digits) {
+  return (digits[0] - '0') * 10 + (digits[1] - '0');
+}
+
+static EMV_BcdStatus clearTrack2(EMV_Track2* track2, EMV_BcdStatus status) {
+  memset(track2, 0, sizeof(EMV_Track2));
+  return status;
+}
+
+EMV_BcdStatus EMV_DecodeTrack2(const byte* data, uint16_t len, EMV_Track2* track2) {
+  memset(track2, 0, sizeof(EMV_Track2));
+  if (len == 0) return EMV_BCD_EMPTY;
+
+  // the PAN, two digits per byte up to the byte with the separator
+  uint8_t panLen = 0;
+  uint16_t i = 0;
+  byte high = NIBBLE_INVALID;
+  for (; i < len; i++) {
+    byte b = data[i];
+    high = NIBBLE_CLASS[b >> 4];
+    byte low = NIBBLE_CLASS[b & 0x0F];
+    if (high == NIBBLE_DIGIT && low == NIBBLE_DIGIT) {
+      if (panLen + 2 > EMV_BCD_MAX_PAN_DIGITS) return clearTrack2(track2, EMV_BCD_PAN_TOO_LONG);
+      memcpy(&track2->pan[panLen], &BYTE_CHARS[2 * b], 2);
+      panLen += 2;
+      continue;
+    }
+    if (high == NIBBLE_DIGIT && low == NIBBLE_SEPARATOR) {
+      if (panLen + 1 > EMV_BCD_MAX_PAN_DIGITS) return clearTrack2(track2, EMV_BCD_PAN_TOO_LONG);
+      track2->pan[panLen++] = BYTE_CHARS[2 * b];
+      break;
+    }
+    if (high == NIBBLE_SEPARATOR) break;
+    // 'F' is the padding at the end of the track
+    return clearTrack2(track2, (high == NIBBLE_PADDING || low == NIBBLE_PADDING) ? EMV_BCD_NO_SEPARATOR : EMV_BCD_INVALID_DIGIT);
+  }
+  if (i == len) return clearTrack2(track2, EMV_BCD_NO_SEPARATOR);
+  if (panLen < EMV_BCD_MIN_PAN_DIGITS) return clearTrack2(track2, EMV_BCD_PAN_TOO_SHORT);
+  track2->panLen = panLen;
+
+  // YYMM and the service code follow the separator
+  uint16_t position = 2 * i + (high == NIBBLE_SEPARATOR ? 1 : 2);
+  uint16_t numberOfNibbles = 2 * len;
+  if (position + 4 > numberOfNibbles) return clearTrack2(track2, EMV_BCD_INVALID_LENGTH);
+  for (uint8_t n = 0; n < 4; n++) {
+    byte nibble = nibbleAt(data, position++);
+    if (NIBBLE_CLASS[nibble] != NIBBLE_DIGIT) return clearTrack2(track2, EMV_BCD_INVALID_DIGIT);
+    track2->expDate[n] = '0' + nibble;
+  }
+  uint8_t month = twoDigits(&track2->expDate[2]);
+  if (month < 1 || month > 12) return clearTrack2(track2, EMV_BCD_INVALID_DATE);
+  if (position + 3 <= numberOfNibbles) {
+    uint8_t n = 0;
+    while (n < 3 && NIBBLE_CLASS[nibbleAt(data, position + n)] == NIBBLE_DIGIT) n++;
+    if (n == 3) {
+      for (n = 0; n < 3; n++) track2->serviceCode[n] = '0' + nibbleAt(data, position + n);
+    }
+  }
+  return EMV_LuhnValid(track2->pan, panLen) ? EMV_BCD_OK : EMV_BCD_LUHN_FAILED;
+}
+
+static EMV_BcdStatus clearPan(char* pan, uint8_t* panLen, EMV_BcdStatus status) {
+  pan[0] = 0;
+  *panLen = 0;
+  return status;
+}
+
+EMV_BcdStatus EMV_DecodePan(const byte* data, uint16_t len, char* pan, uint8_t* panLen) {
+  if (len == 0) return clearPan(pan, panLen, EMV_BCD_EMPTY);
+  uint8_t digits = 0;
+  uint16_t i = 0;
+  for (; i < len; i++) {
+    byte b = data[i];
+    byte high = NIBBLE_CLASS[b >> 4];
+    byte low = NIBBLE_CLASS[b & 0x0F];
+    if (high == NIBBLE_DIGIT && low == NIBBLE_DIGIT) {
+      if (digits + 2 > EMV_BCD_MAX_PAN_DIGITS) return clearPan(pan, panLen, EMV_BCD_PAN_TOO_LONG);
+      memcpy(&pan[digits], &BYTE_CHARS[2 * b], 2);
+      digits += 2;
+      continue;
+    }
+    if (high == NIBBLE_DIGIT && low == NIBBLE_PADDING) {
+      if (digits + 1 > EMV_BCD_MAX_PAN_DIGITS) return clearPan(pan, panLen, EMV_BCD_PAN_TOO_LONG);
+      pan[digits++] = BYTE_CHARS[2 * b];
+      i++;
+    } else if (high != NIBBLE_PADDING || low != NIBBLE_PADDING) {
+      return clearPan(pan, panLen, EMV_BCD_INVALID_DIGIT);
+    }
+    break;
+  }
+  // only padding may follow the digits
+  for (; i < len; i++) {
+    if (data[i] != 0xFF) return clearPan(pan, panLen, EMV_BCD_INVALID_DIGIT);
+  }
+  if (digits < EMV_BCD_MIN_PAN_DIGITS) return clearPan(pan, panLen, EMV_BCD_PAN_TOO_SHORT);
+  pan[digits] = 0;
+  *panLen = digits;
+  return EMV_LuhnValid(pan, digits) ? EMV_BCD_OK : EMV_BCD_LUHN_FAILED;
+}
+
+EMV_BcdStatus EMV_DecodeDate(const byte* data, uint16_t len, char* date) {
+  date[0] = 0;
+  if (len == 0) return EMV_BCD_EMPTY;
+  if (len != 3) return EMV_BCD_INVALID_LENGTH;
+  if (!isDigitByte(data[0]) || !isDigitByte(data[1]) || !isDigitByte(data[2])) return EMV_BCD_INVALID_DIGIT;
+  uint8_t month = (data[1] >> 4) * 10 + (data[1] & 0x0F);
+  uint8_t day = (data[2] >> 4) * 10 + (data[2] & 0x0F);
+  if (month < 1 || month > 12 || day < 1 || day > DAYS_OF_MONTH[month]) return EMV_BCD_INVALID_DATE;
+  for (uint8_t i = 0; i < 3; i++) memcpy(&date[2 * i], &BYTE_CHARS[2 * data[i]], 2);
+  date[6] = 0;
+  return EMV_BCD_OK;
+}
+
+uint8_t EMV_EncodeBcd(const char* digits, uint8_t digitsLen, byte* bcd) {
+  uint8_t bytes = 0;
+  for (uint8_t i = 0; i < digitsLen; i += 2) {
+    byte high = digits[i] - '0';
+    byte low = (i + 1 < digitsLen) ? digits[i + 1] - '0' : 0x0F;
+    bcd[bytes++] = (high << 4) | low;
+  }
+  return bytes;
+}
+
+bool EMV_LuhnValid(const char* digits, uint8_t digitsLen) {
+  if (digitsLen < 2) return false;
+  uint16_t sum = 0;
+  bool isDoubled = false;
+  for (int16_t i = digitsLen - 1; i >= 0; i--) {
+    byte digit = digits[i] - '0';
+    if (digit > 9) return false;
+    sum += isDoubled ? LUHN_DOUBLE[digit] : digit;
+    isDoubled = !isDoubled;
+  }
+  return sum % 10 == 0;
+}
+
+const char* EMV_BcdStatusText(EMV_BcdStatus status) {
+  switch (status) {
+    case EMV_BCD_OK: return "ok";
+    case EMV_BCD_EMPTY: return "empty";
+    case EMV_BCD_INVALID_DIGIT: return "invalid digit";
+    case EMV_BCD_NO_SEPARATOR: return "no separator";
+    case EMV_BCD_PAN_TOO_SHORT: return "PAN too short";
+    case EMV_BCD_PAN_TOO_LONG: return "PAN too long";
+    case EMV_BCD_INVALID_LENGTH: return "invalid length";
+    case EMV_BCD_INVALID_DATE: return "invalid date";
+    case EMV_BCD_LUHN_FAILED: return "Luhn check failed";
+  }
+  return "?";
+}
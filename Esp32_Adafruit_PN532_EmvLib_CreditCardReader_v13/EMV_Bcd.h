@@ -0,0 +1,56 @@
+/**
+ * A table driven codec for the BCD data elements of a payment card.
+ * It decodes Track 2 Equivalent Data (tag 57) and Track 2 Data (tag 9F6B, MasterCard): the PAN,
+ * the separator 'D', the expiration date YYMM and the service code. It also decodes the PAN of
+ * tag 5A (cn, padded with 'F') and the dates of tag 5F24 (expiration date) and tag 5F25
+ * (effective date), n 6 YYMMDD.
+ * A 16 entry table classifies every nibble (digit, separator, padding, invalid), a 256 entry
+ * table holds the two characters of every byte, so two digits are copied with one lookup and
+ * without a format call or a string concatenation.
+ * Every decoder checks the data and returns an explicit EMV_BcdStatus. The PAN is checked with
+ * the Luhn algorithm (ISO/IEC 7812), a failed check still returns the decoded data.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Bcd_h
+#define EMV_Bcd_h
+
+#include "Arduino.h"
+
+#define EMV_BCD_MIN_PAN_DIGITS 8    // ISO/IEC 7812-1
+#define EMV_BCD_MAX_PAN_DIGITS 19
+#define EMV_BCD_MAX_PAN 10          // bytes of a BCD PAN
+
+enum EMV_BcdStatus : byte {
+  EMV_BCD_OK = 0,
+  EMV_BCD_EMPTY = 1,           // no data
+  EMV_BCD_INVALID_DIGIT = 2,   // a nibble A - F where a digit is expected
+  EMV_BCD_NO_SEPARATOR = 3,    // track 2 without the separator 'D'
+  EMV_BCD_PAN_TOO_SHORT = 4,   // less than EMV_BCD_MIN_PAN_DIGITS
+  EMV_BCD_PAN_TOO_LONG = 5,    // more than EMV_BCD_MAX_PAN_DIGITS
+  EMV_BCD_INVALID_LENGTH = 6,  // track 2 ends inside YYMM, a date is not 3 bytes long
+  EMV_BCD_INVALID_DATE = 7,    // month not 01 - 12 or day not 01 - 31
+  EMV_BCD_LUHN_FAILED = 8      // the data is decoded, but the check digit of the PAN is wrong
+};
+
+struct EMV_Track2 {
+  char pan[EMV_BCD_MAX_PAN_DIGITS + 1];
+  uint8_t panLen;
+  char expDate[5];      // YYMM
+  char serviceCode[4];  // "" if the track 2 has none
+};
+
+// tag 57 or 9F6B; the track2 fields are filled for EMV_BCD_OK and EMV_BCD_LUHN_FAILED, else they are empty
+EMV_BcdStatus EMV_DecodeTrack2(const byte* data, uint16_t len, EMV_Track2* track2);
+// tag 5A, pan needs EMV_BCD_MAX_PAN_DIGITS + 1 characters; filled for EMV_BCD_OK and EMV_BCD_LUHN_FAILED
+EMV_BcdStatus EMV_DecodePan(const byte* data, uint16_t len, char* pan, uint8_t* panLen);
+// tag 5F24 or 5F25, date needs 7 characters (YYMMDD); filled for EMV_BCD_OK only
+EMV_BcdStatus EMV_DecodeDate(const byte* data, uint16_t len, char* date);
+// digits to BCD, an odd number of digits is padded with 'F' (cn), returns the number of bytes
+uint8_t EMV_EncodeBcd(const char* digits, uint8_t digitsLen, byte* bcd);
+// true if the last digit is the Luhn check digit of the others
+bool EMV_LuhnValid(const char* digits, uint8_t digitsLen);
+const char* EMV_BcdStatusText(EMV_BcdStatus status);
+
+#endif
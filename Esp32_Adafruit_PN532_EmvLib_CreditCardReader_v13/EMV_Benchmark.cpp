@@ -0,0 +1,105 @@
+#include "EMV_Benchmark.h"
+
+static const char* PHASE_NAMES[EMV_PHASE_COUNT] = { "Select PPSE", "Select AID", "Send PDOL", "Read Record" };
+
+EMV_BenchmarkTransport::EMV_BenchmarkTransport(EMV_Transport* transport) {
+  this->transport = transport;
+  reset();
+}
+
+void EMV_BenchmarkTransport::reset() {
+  memset(phaseStats, 0, sizeof(phaseStats));
+  memset(&tapStats, 0, sizeof(tapStats));
+}
+
+EMV_TransceiveStatus EMV_BenchmarkTransport::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  EMV_PhaseStats* stats = &phaseStats[phase];
+  uint32_t start = micros();
+  EMV_TransceiveStatus status = transport->exchange(sendData, sendLen, backData, backSize, backLen);
+  uint32_t elapsed = micros() - start;
+  stats->ioMicros += elapsed;
+  stats->roundTrips++;
+  stats->bytesSent += sendLen;
+  if (status == EMV_TRANSCEIVE_OK) stats->bytesReceived += *backLen;
+  return status;
+}
+
+// measures one call of a phase
+static void addPhaseTime(EMV_PhaseStats* stats, uint32_t start) {
+  uint32_t duration = micros() - start;
+  stats->calls++;
+  stats->wallMicros += duration;
+  if (duration > stats->maxWallMicros) stats->maxWallMicros = duration;
+}
+
+ESP32_EMV::EMV_StatusCode EMV_RunReadFlow(ESP32_EMV* emv, EMV_BenchmarkTransport* benchmark) {
+  byte appData[255];
+  uint16_t appLen = 255;
+  uint32_t tapStart = micros();
+  uint32_t start = tapStart;
+
+  benchmark->setPhase(EMV_PHASE_SELECT_PPSE);
+  ESP32_EMV::EMV_StatusCode statusCode = emv->SelectPpse(appData, &appLen);
+  addPhaseTime(&benchmark->phaseStats[EMV_PHASE_SELECT_PPSE], start);
+
+  for (uint8_t aidIndex = 0; statusCode == ESP32_EMV::EMV_STATUS_OK && aidIndex < emv->card.numberOfAids; aidIndex++) {
+    benchmark->setPhase(EMV_PHASE_SELECT_AID);
+    start = micros();
+    appLen = 255;
+    emv->SelectApdu(emv->card.aids[aidIndex], emv->card.aidsLen[aidIndex], 0x02, appData, &appLen);
+    addPhaseTime(&benchmark->phaseStats[EMV_PHASE_SELECT_AID], start);
+
+    benchmark->setPhase(EMV_PHASE_SEND_PDOL);
+    start = micros();
+    appLen = 255;
+    statusCode = emv->SendPdol(appData, &appLen);
+    addPhaseTime(&benchmark->phaseStats[EMV_PHASE_SEND_PDOL], start);
+    if (statusCode != ESP32_EMV::EMV_STATUS_OK) break;
+
+    benchmark->setPhase(EMV_PHASE_READ_RECORD);
+    uint8_t numberOfAfl = emv->card.aflLen / 4;
+    for (uint8_t j = 0; j < numberOfAfl; j++) {
+      byte aflEntry[4];
+      memcpy(aflEntry, &emv->card.afl[4 * j], 4);
+      uint8_t fileIndex = aflEntry[2] - aflEntry[1] + 1;
+      for (uint8_t i = 0; i < fileIndex; i++) {
+        start = micros();
+        appLen = 255;
+        emv->ReadRecord(aflEntry, appData, &appLen);
+        addPhaseTime(&benchmark->phaseStats[EMV_PHASE_READ_RECORD], start);
+        aflEntry[1]++;
+      }
+    }
+  }
+
+  uint32_t duration = micros() - tapStart;
+  EMV_TapStats* tapStats = &benchmark->tapStats;
+  tapStats->taps++;
+  if (statusCode != ESP32_EMV::EMV_STATUS_OK) tapStats->failedTaps++;
+  if (duration > EMV_TAP_BUDGET_MICROS) tapStats->overBudgetTaps++;
+  tapStats->wallMicros += duration;
+  if (duration > tapStats->maxWallMicros) tapStats->maxWallMicros = duration;
+  return statusCode;
+}
+
+void EMV_PrintBenchmark(EMV_BenchmarkTransport* benchmark) {
+  EMV_TapStats* tapStats = &benchmark->tapStats;
+  if (tapStats->taps == 0) {
+    Serial.println("No taps measured");
+    return;
+  }
+  Serial.printf("Taps %lu failed %lu over budget (%lu us) %lu\n", (unsigned long)tapStats->taps, (unsigned long)tapStats->failedTaps,
+                (unsigned long)EMV_TAP_BUDGET_MICROS, (unsigned long)tapStats->overBudgetTaps);
+  Serial.printf("Tap avg %lu us max %lu us\n", (unsigned long)(tapStats->wallMicros / tapStats->taps), (unsigned long)tapStats->maxWallMicros);
+  Serial.println("Phase        calls  avg us  max us  io us/tap  parse us/tap  RTT/tap  sent/tap  recv/tap");
+  for (uint8_t i = 0; i < EMV_PHASE_COUNT; i++) {
+    EMV_PhaseStats* stats = &benchmark->phaseStats[i];
+    uint32_t avg = stats->calls ? stats->wallMicros / stats->calls : 0;
+    uint64_t parseMicros = stats->wallMicros > stats->ioMicros ? stats->wallMicros - stats->ioMicros : 0;
+    Serial.printf("%-12s %6lu %7lu %7lu %10lu %13lu %8.2f %9lu %9lu\n", PHASE_NAMES[i], (unsigned long)stats->calls,
+                  (unsigned long)avg, (unsigned long)stats->maxWallMicros,
+                  (unsigned long)(stats->ioMicros / tapStats->taps), (unsigned long)(parseMicros / tapStats->taps),
+                  (float)stats->roundTrips / tapStats->taps,
+                  (unsigned long)(stats->bytesSent / tapStats->taps), (unsigned long)(stats->bytesReceived / tapStats->taps));
+  }
+}
@@ -0,0 +1,83 @@
+/**
+ * Per-phase latency measurement of the EMV read flow.
+ * EMV_BenchmarkTransport wraps the transport of an ESP32_EMV instance and measures
+ * the time spent in the exchanges, the number of round trips and the bytes sent and
+ * received, separated by the phase of the read flow (Select PPSE, Select AID,
+ * Send PDOL/GPO, Read Record). The remaining time of a phase is spent in the library
+ * (building commands, TLV decoding, printing).
+ * EMV_RunReadFlow drives the same sequence as run_E01_Credit_Card_Handling, but without
+ * any output, so the complete read can be repeated thousands of times.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Benchmark_h
+#define EMV_Benchmark_h
+
+#include "Arduino.h"
+#include "EMV_Transport.h"
+#include "ESP32_EMV.h"
+
+// a tap that takes longer than this fails in practice
+#define EMV_TAP_BUDGET_MICROS 500000UL
+
+enum EMV_Phase : byte {
+  EMV_PHASE_SELECT_PPSE = 0,
+  EMV_PHASE_SELECT_AID = 1,
+  EMV_PHASE_SEND_PDOL = 2,
+  EMV_PHASE_READ_RECORD = 3,
+  EMV_PHASE_COUNT = 4
+};
+
+struct EMV_PhaseStats {
+  uint32_t calls;          // number of times the phase was run
+  uint64_t wallMicros;     // complete time of the phase
+  uint64_t ioMicros;       // time spent in the exchanges with the card
+  uint32_t maxWallMicros;  // slowest single run of the phase
+  uint32_t roundTrips;
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+};
+
+struct EMV_TapStats {
+  uint32_t taps;
+  uint32_t failedTaps;      // taps that did not end with EMV_STATUS_OK
+  uint32_t overBudgetTaps;  // taps longer than EMV_TAP_BUDGET_MICROS
+  uint64_t wallMicros;
+  uint32_t maxWallMicros;
+};
+
+class EMV_BenchmarkTransport : public EMV_Transport {
+
+public:
+  EMV_BenchmarkTransport(EMV_Transport* transport);
+
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  bool detectCard() override { return transport->detectCard(); }
+  bool checkPresence() override { return transport->checkPresence(); }
+  byte cardUid(byte* uid) override { return transport->cardUid(uid); }
+  byte detectCards(byte maxCards) override { return transport->detectCards(maxCards); }
+  bool selectCard(byte index) override { return transport->selectCard(index); }
+  uint16_t maxResponseLen() override { return transport->maxResponseLen(); }
+
+  void setTransport(EMV_Transport* transport) { this->transport = transport; }
+  void setPhase(EMV_Phase phase) { this->phase = phase; }
+  void reset();
+
+  EMV_PhaseStats phaseStats[EMV_PHASE_COUNT];
+  EMV_TapStats tapStats;
+
+private:
+  EMV_Transport* transport;
+  EMV_Phase phase = EMV_PHASE_SELECT_PPSE;
+};
+
+// Runs one complete read (Select PPSE, then for every AID Select AID, Send PDOL and Read Record
+// for every record of the AFL) and adds the timings to the benchmark transport. The ESP32_EMV
+// instance has to use the benchmark transport.
+ESP32_EMV::EMV_StatusCode EMV_RunReadFlow(ESP32_EMV* emv, EMV_BenchmarkTransport* benchmark);
+
+// prints a table of the collected timings
+void EMV_PrintBenchmark(EMV_BenchmarkTransport* benchmark);
+
+#endif
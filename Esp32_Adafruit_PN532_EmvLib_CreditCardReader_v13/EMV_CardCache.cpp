@@ -0,0 +1,59 @@
+#include "EMV_CardCache.h"
+#include "EMV_DolPlan.h"
+
+uint32_t EMV_CardCache::fingerprint(const byte* ppseResponse, uint16_t ppseResponseLen) {
+  return EMV_DolHash(ppseResponse, ppseResponseLen);
+}
+
+EMV_CachedCard* EMV_CardCache::lookUp(const byte* uid, byte uidLen, uint32_t fingerprint) {
+  for (uint8_t i = 0; i < EMV_CARD_CACHE_SIZE; i++) {
+    if (cards[i].uidLen == uidLen && cards[i].fingerprint == fingerprint && memcmp(cards[i].uid, uid, uidLen) == 0) return &cards[i];
+  }
+  return NULL;
+}
+
+const EMV_CachedCard* EMV_CardCache::find(const byte* uid, byte uidLen, uint32_t fingerprint) {
+  if (uidLen == 0 || uidLen > EMV_MAX_UID || isRandomUid(uid, uidLen)) {
+    misses++;
+    return NULL;
+  }
+  EMV_CachedCard* card = lookUp(uid, uidLen, fingerprint);
+  if (card == NULL || millis() - card->readMillis >= windowMillis) {
+    misses++;
+    return NULL;
+  }
+  hits++;
+  card->lastUse = ++useCounter;
+  return card;
+}
+
+void EMV_CardCache::put(const byte* uid, byte uidLen, uint32_t fingerprint, const byte* pan, uint8_t panLen, const byte* expDate, uint8_t expDateLen) {
+  if (uidLen == 0 || uidLen > EMV_MAX_UID || isRandomUid(uid, uidLen)) return;
+  if (panLen > sizeof(cards[0].pan) || expDateLen > sizeof(cards[0].expDate)) return;
+  EMV_CachedCard* card = lookUp(uid, uidLen, fingerprint);
+  if (card == NULL) {
+    // replace the least recently used card, unused entries have lastUse 0
+    card = &cards[0];
+    for (uint8_t i = 1; i < EMV_CARD_CACHE_SIZE; i++) {
+      if (cards[i].lastUse < card->lastUse) card = &cards[i];
+    }
+  }
+  memcpy(card->uid, uid, uidLen);
+  card->uidLen = uidLen;
+  card->fingerprint = fingerprint;
+  card->readMillis = millis();
+  card->lastUse = ++useCounter;
+  memcpy(card->pan, pan, panLen);
+  card->panLen = panLen;
+  memcpy(card->expDate, expDate, expDateLen);
+  card->expDateLen = expDateLen;
+}
+
+void EMV_CardCache::clear() {
+  for (uint8_t i = 0; i < EMV_CARD_CACHE_SIZE; i++) {
+    cards[i].uidLen = 0;
+    cards[i].lastUse = 0;
+  }
+  hits = 0;
+  misses = 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Cache of the last card reads for the ESP32_EMV library.
+ * A card that is tapped again within the window (EMV_CARD_CACHE_WINDOW_MILLIS) is not read
+ * again: after the SELECT PPSE, the single verification exchange, EMV_Session looks up the UID
+ * and a fingerprint of the PPSE response and takes PAN and expiration date from the cache.
+ * The fingerprint is a FNV-1a hash of the PPSE response (see EMV_DolHash), it differs between
+ * card products and issuers, the UID tells cards of the same product apart.
+ * Many payment cards answer with a random UID (4 bytes, first byte 0x08) on every activation,
+ * these cards are never found in the cache and always read completely.
+ * The entries are replaced in LRU order as EMV_DolPlanCache does it.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_CardCache_h
+#define EMV_CardCache_h
+
+#include "Arduino.h"
+#include "EMV_Transport.h"
+
+#define EMV_CARD_CACHE_SIZE 4                 // number of cached cards
+#define EMV_CARD_CACHE_WINDOW_MILLIS 10000UL  // default time a read stays valid
+
+struct EMV_CachedCard {
+  byte uid[EMV_MAX_UID];
+  byte uidLen;           // 0 = unused cache entry
+  uint32_t fingerprint;  // hash of the PPSE response
+  uint32_t readMillis;   // millis() of the complete read
+  uint32_t lastUse;      // for the LRU replacement
+  byte pan[10];          // BCD, padded with F
+  uint8_t panLen;
+  byte expDate[3];
+  uint8_t expDateLen;
+};
+
+class EMV_CardCache {
+
+public:
+  void setWindow(uint32_t millis) { windowMillis = millis; }
+  // the read of this card within the window, NULL if the card is not cached
+  const EMV_CachedCard* find(const byte* uid, byte uidLen, uint32_t fingerprint);
+  // stores the result of a complete read
+  void put(const byte* uid, byte uidLen, uint32_t fingerprint, const byte* pan, uint8_t panLen, const byte* expDate, uint8_t expDateLen);
+  void clear();
+
+  // the PPSE response (without the status word) as fingerprint
+  static uint32_t fingerprint(const byte* ppseResponse, uint16_t ppseResponseLen);
+  // a random UID is new on every activation, the card can't be found again by it
+  static bool isRandomUid(const byte* uid, byte uidLen) { return uidLen == 4 && uid[0] == 0x08; }
+
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+
+private:
+  EMV_CachedCard cards[EMV_CARD_CACHE_SIZE] = {};
+  uint32_t windowMillis = EMV_CARD_CACHE_WINDOW_MILLIS;
+  uint32_t useCounter = 0;
+
+  EMV_CachedCard* lookUp(const byte* uid, byte uidLen, uint32_t fingerprint);
+};
+
+#endif
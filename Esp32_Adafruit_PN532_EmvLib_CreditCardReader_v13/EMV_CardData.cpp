@@ -0,0 +1,18 @@
+#include "EMV_CardData.h"
+
+void EMV_CardData::clear() {
+  numberOfAids = 0;
+  clearApplication();
+}
+
+void EMV_CardData::clearApplication() {
+  pdolLen = 0;
+  track2Len = 0;
+  aflLen = 0;
+  panLen = 0;
+  expDateLen = 0;
+  panCharLen = 0;
+  panChar[0] = 0;
+  expDateCharLen = 0;
+  expDateChar[0] = 0;
+}
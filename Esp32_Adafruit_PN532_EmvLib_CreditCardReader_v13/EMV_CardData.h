@@ -0,0 +1,61 @@
+/**
+ * The data the library reads from an EMV card, filled by ESP32_EMV (emv.card).
+ * All buffers have fixed sizes that are tuned to the EMV maxima of the data elements or, where
+ * EMV allows up to 252 bytes (PDOL, AFL), to the lengths real cards use. Every length byte is
+ * 0 if the data element was not found. SelectPpse clears all data, SelectApdu of an AID clears
+ * the data of the application, so a caller never resets a length by hand.
+ * The struct holds bytes only and has no padding.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_CardData_h
+#define EMV_CardData_h
+
+#include "Arduino.h"
+
+#define EMV_CARD_MAX_AIDS 4          // a PPSE lists 1 - 3 AIDs (e.g. Visa and a national debit scheme)
+#define EMV_CARD_MAX_AID 16          // tag 4F, 5 - 16 bytes
+#define EMV_CARD_MAX_PDOL 64         // tag 9F38, real PDOLs have up to 12 data objects (about 40 bytes)
+#define EMV_CARD_MAX_TRACK2 19       // tag 57, 19 bytes
+#define EMV_CARD_MAX_AFL 64          // tag 94, 16 AFL entries, real cards use 1 - 5
+#define EMV_CARD_MAX_PAN 10          // tag 5A, 19 digits BCD
+#define EMV_CARD_MAX_EXP_DATE 3      // tag 5F24, YYMMDD
+#define EMV_CARD_MAX_PAN_DIGITS 19
+#define EMV_CARD_MAX_EXP_DATE_DIGITS 4  // YYMM of tag 57
+
+struct EMV_CardData {
+  // Select PPSE: tag 4F of every application
+  uint8_t numberOfAids;
+  uint8_t aidsLen[EMV_CARD_MAX_AIDS];
+  byte aids[EMV_CARD_MAX_AIDS][EMV_CARD_MAX_AID];
+
+  // Select AID: tag 9F38 = PDOL, 0 = no PDOL
+  uint8_t pdolLen;
+  byte pdol[EMV_CARD_MAX_PDOL];
+
+  // GPO: tag 57 = Track 2 Equivalent Data and tag 94 = AFL (or the AFL of tag 80)
+  uint8_t track2Len;
+  byte track2[EMV_CARD_MAX_TRACK2];
+  uint8_t aflLen;
+  byte afl[EMV_CARD_MAX_AFL];
+
+  // Read Record: tag 5A = PAN and tag 5F24 = expiration date, the last record that holds them
+  uint8_t panLen;
+  byte pan[EMV_CARD_MAX_PAN];
+  uint8_t expDateLen;
+  byte expDate[EMV_CARD_MAX_EXP_DATE];
+
+  // PAN and expiration date (YYMM) of tag 57 as characters
+  uint8_t panCharLen;
+  char panChar[EMV_CARD_MAX_PAN_DIGITS + 1];
+  uint8_t expDateCharLen;
+  char expDateChar[EMV_CARD_MAX_EXP_DATE_DIGITS + 1];
+
+  // forgets all data, a new card
+  void clear();
+  // forgets the data of the selected application, keeps the AIDs
+  void clearApplication();
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "EMV_DolPlan.h"
+#include "EMV_Tlv.h"
+
+uint32_t EMV_DolHash(const byte* dol, uint16_t dolLen) {
+  uint32_t hash = 2166136261UL;
+  for (uint16_t i = 0; i < dolLen; i++) {
+    hash ^= dol[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+bool EMV_DolCompile(const byte* dol, uint16_t dolLen, EMV_TerminalData* terminalData, EMV_DolPlan* plan) {
+  if (dolLen > EMV_DOL_PLAN_MAX_DOL) return false;
+  uint16_t position = 0;
+  uint16_t destination = 0;
+  uint8_t numberOfSteps = 0;
+  while (position < dolLen) {
+    uint32_t tag;
+    uint16_t length;
+    uint8_t tagLen = EMV_TlvParseTag(dol + position, dolLen - position, &tag);
+    if (tagLen == 0) return false;
+    position += tagLen;
+    uint8_t lengthLen = EMV_TlvParseLength(dol + position, dolLen - position, &length);
+    if (lengthLen == 0) return false;
+    position += lengthLen;
+    if (length > 255 || destination + length > 255) return false;
+    if (numberOfSteps + 2 > EMV_DOL_PLAN_MAX_STEPS) return false;
+    numberOfSteps += terminalData->fillSteps(tag, destination, length, &plan->steps[numberOfSteps]);
+    destination += length;
+  }
+  plan->hash = EMV_DolHash(dol, dolLen);
+  plan->dolLen = dolLen;
+  memcpy(plan->dol, dol, dolLen);
+  plan->terminalData = terminalData;
+  plan->layoutVersion = terminalData->layoutVersion();
+  plan->outputLen = destination;
+  plan->numberOfSteps = numberOfSteps;
+  return true;
+}
+
+void EMV_DolExecute(const EMV_DolPlan* plan, byte* output) {
+  EMV_DolRunSteps(plan->steps, plan->numberOfSteps, plan->terminalData->image(), output);
+}
+
+const EMV_DolPlan* EMV_DolPlanCache::get(const byte* dol, uint16_t dolLen, EMV_TerminalData* terminalData) {
+  if (dolLen == 0 || dolLen > EMV_DOL_PLAN_MAX_DOL) return NULL;
+  uint32_t hash = EMV_DolHash(dol, dolLen);
+  useCounter++;
+  EMV_DolPlan* plan = NULL;
+  for (uint8_t i = 0; i < EMV_DOL_PLAN_CACHE_SIZE; i++) {
+    if (plans[i].dolLen == dolLen && plans[i].hash == hash && plans[i].terminalData == terminalData
+        && memcmp(plans[i].dol, dol, dolLen) == 0) {
+      plan = &plans[i];
+      break;
+    }
+  }
+  if (plan != NULL && plan->layoutVersion == terminalData->layoutVersion()) {
+    hits++;
+    plan->lastUse = useCounter;
+    return plan;
+  }
+  misses++;
+  if (plan == NULL) {
+    // replace the least recently used plan
+    plan = &plans[0];
+    for (uint8_t i = 1; i < EMV_DOL_PLAN_CACHE_SIZE; i++) {
+      if (plans[i].lastUse < plan->lastUse) plan = &plans[i];
+    }
+  }
+  if (!EMV_DolCompile(dol, dolLen, terminalData, plan)) {
+    plan->dolLen = 0;
+    plan->lastUse = 0;
+    return NULL;
+  }
+  plan->lastUse = useCounter;
+  return plan;
+}
+
+void EMV_DolPlanCache::clear() {
+  for (uint8_t i = 0; i < EMV_DOL_PLAN_CACHE_SIZE; i++) {
+    plans[i].dolLen = 0;
+    plans[i].lastUse = 0;
+  }
+  hits = 0;
+  misses = 0;
+}
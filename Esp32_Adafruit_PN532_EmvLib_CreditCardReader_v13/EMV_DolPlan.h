@@ -0,0 +1,60 @@
+/**
+ * Compiled Data Object Lists (PDOL, CDOL, DDOL).
+ * Cards of the same product send byte identical DOLs. The DOL is parsed once and compiled into
+ * a plan of copy/pad steps from the terminal data (EMV_TerminalData::image()), building the DOL
+ * data is then a few memcpy calls without parsing the DOL or looking up the tags.
+ * EMV_DolPlanCache keeps the plans of the last DOLs keyed by a FNV-1a hash of the DOL bytes.
+ * The DOL is stored in the plan as well, a hash collision can't return a wrong plan.
+ * A plan is recompiled when the layout of the terminal data changed (a tag was added or a value
+ * changed its length), new values of the same length are picked up without recompiling.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_DolPlan_h
+#define EMV_DolPlan_h
+
+#include "Arduino.h"
+#include "EMV_TerminalData.h"
+
+#define EMV_DOL_PLAN_MAX_DOL 64     // longer DOLs are not cached, use EMV_DolBuild for them
+#define EMV_DOL_PLAN_MAX_STEPS 32   // a DOL entry needs 1 or 2 steps
+#define EMV_DOL_PLAN_CACHE_SIZE 4   // number of cached plans
+
+struct EMV_DolPlan {
+  uint32_t hash;
+  uint8_t dolLen;                  // 0 = unused cache entry
+  byte dol[EMV_DOL_PLAN_MAX_DOL];
+  EMV_TerminalData* terminalData;  // the plan is valid for this terminal data only
+  uint16_t layoutVersion;          // ... and for this layout
+  uint16_t outputLen;              // the length of the DOL data
+  uint8_t numberOfSteps;
+  EMV_DolStep steps[EMV_DOL_PLAN_MAX_STEPS];
+  uint32_t lastUse;                // for the LRU replacement
+};
+
+// 32 bit FNV-1a hash
+uint32_t EMV_DolHash(const byte* dol, uint16_t dolLen);
+
+// compiles a DOL into a plan, false on a malformed DOL or if it does not fit into a plan
+bool EMV_DolCompile(const byte* dol, uint16_t dolLen, EMV_TerminalData* terminalData, EMV_DolPlan* plan);
+
+// writes the DOL data (plan->outputLen bytes)
+void EMV_DolExecute(const EMV_DolPlan* plan, byte* output);
+
+class EMV_DolPlanCache {
+
+public:
+  // the plan for the DOL, compiled on a miss. NULL if the DOL is malformed or too long for a plan.
+  const EMV_DolPlan* get(const byte* dol, uint16_t dolLen, EMV_TerminalData* terminalData);
+  void clear();
+
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+
+private:
+  EMV_DolPlan plans[EMV_DOL_PLAN_CACHE_SIZE] = {};
+  uint32_t useCounter = 0;
+};
+
+#endif
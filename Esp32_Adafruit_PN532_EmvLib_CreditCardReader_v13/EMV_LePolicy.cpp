@@ -0,0 +1,55 @@
+#include "EMV_LePolicy.h"
+
+void EMV_LePolicy::beginSession() {
+  isSessionLeKnown = false;
+  sessionLe = EMV_LE_DEFAULT;
+  current = NULL;
+}
+
+void EMV_LePolicy::setKey(const byte* key, byte keyLen) {
+  if (keyLen > EMV_LE_POLICY_KEY_SIZE) keyLen = EMV_LE_POLICY_KEY_SIZE;
+  useCounter++;
+  EMV_LeEntry* oldest = &entries[0];
+  for (byte i = 0; i < EMV_LE_POLICY_ENTRIES; i++) {
+    EMV_LeEntry* entry = &entries[i];
+    if (entry->keyLen == keyLen && memcmp(entry->key, key, keyLen) == 0) {
+      entry->lastUsed = useCounter;
+      current = entry;
+      return;
+    }
+    if (entry->keyLen == 0 || (oldest->keyLen != 0 && entry->lastUsed < oldest->lastUsed)) oldest = entry;
+  }
+  // unknown AID, replace the least recently used entry
+  memcpy(oldest->key, key, keyLen);
+  oldest->keyLen = keyLen;
+  oldest->leByte = EMV_LE_DEFAULT;
+  oldest->lastUsed = useCounter;
+  current = oldest;
+}
+
+byte EMV_LePolicy::firstLe() {
+  byte leByte = EMV_LE_DEFAULT;
+  if (isSessionLeKnown) {
+    // the card in the field behaves the same way for all commands
+    leByte = sessionLe;
+  } else if (current != NULL) {
+    leByte = current->leByte;
+  }
+  isLearnedLe = leByte != EMV_LE_DEFAULT;
+  return leByte;
+}
+
+byte EMV_LePolicy::fallbackLe(byte failedLe) {
+  fallbacks++;
+  if (isLearnedLe) mispredictions++;
+  isLearnedLe = false;
+  return (failedLe == 0x00) ? EMV_LE_DEFAULT : 0x00;
+}
+
+void EMV_LePolicy::learn(byte leByte, bool isFirstLe) {
+  commands++;
+  if (isFirstLe && isLearnedLe) fallbacksAvoided++;
+  isSessionLeKnown = true;
+  sessionLe = leByte;
+  if (current != NULL) current->leByte = leByte;
+}
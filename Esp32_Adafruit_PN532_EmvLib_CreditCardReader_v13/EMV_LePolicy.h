@@ -0,0 +1,58 @@
+/**
+ * Le negotiation for the ESP32_EMV library.
+ * SELECT, GET PROCESSING OPTIONS and READ RECORD are sent with Le = 0xF8 first, as asking for
+ * the full length may exceed the receive buffer. Many cards (e.g. Visa) answer this with 67 00
+ * (wrong length) and the command has to be resent with Le = 0x00, costing one round trip per command.
+ * EMV_LePolicy learns which Le the card accepts, for the running session and per AID across
+ * sessions, so the right Le is sent first.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_LePolicy_h
+#define EMV_LePolicy_h
+
+#include "Arduino.h"
+
+#define EMV_LE_DEFAULT 0xF8             // don't ask for the full length in the first run
+#define EMV_LE_POLICY_ENTRIES 8         // number of AIDs remembered across sessions
+#define EMV_LE_POLICY_KEY_SIZE 16       // AIDs are 5..16 bytes long
+
+struct EMV_LeEntry {
+  byte key[EMV_LE_POLICY_KEY_SIZE];
+  byte keyLen;                          // 0 = unused entry
+  byte leByte;                          // the Le the card accepted the last time
+  uint32_t lastUsed;                    // for replacing the least recently used entry
+};
+
+class EMV_LePolicy {
+
+public:
+  // a new card is in the field, the session knowledge is cleared, the AID table is kept
+  void beginSession();
+  // the following commands belong to this AID (or the PPSE name for SELECT PPSE)
+  void setKey(const byte* key, byte keyLen);
+
+  // the Le to be sent first
+  byte firstLe();
+  // the card answered 67 00, returns the Le for the resend
+  byte fallbackLe(byte failedLe);
+  // the card accepted the command with this Le
+  void learn(byte leByte, bool isFirstLe);
+
+  // counters
+  uint32_t commands = 0;          // commands that were accepted by the card
+  uint32_t fallbacks = 0;         // resends after 67 00
+  uint32_t fallbacksAvoided = 0;  // commands accepted at once with a learned Le other than EMV_LE_DEFAULT
+  uint32_t mispredictions = 0;    // learned Le was answered with 67 00
+
+private:
+  EMV_LeEntry entries[EMV_LE_POLICY_ENTRIES] = {};
+  EMV_LeEntry* current = NULL;
+  uint32_t useCounter = 0;
+  bool isSessionLeKnown = false;
+  byte sessionLe = EMV_LE_DEFAULT;
+  bool isLearnedLe = false;       // the last firstLe() was a learned value
+};
+
+#endif
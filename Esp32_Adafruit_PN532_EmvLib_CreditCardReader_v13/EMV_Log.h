@@ -0,0 +1,38 @@
+/**
+ * Compile time logging of the library.
+ * Every output of the library has a level and a category. A statement is compiled in only if
+ * its level is <= EMV_LOG_LEVEL and its category is in EMV_LOG_CATEGORIES, otherwise the
+ * condition is the constant false and the compiler removes the statement including the
+ * evaluation of its arguments and the format strings.
+ * The run time switches (emv.COMM_DEBUG_PRINT etc.) still work for the compiled in categories.
+ * The sketch folder is compiled file by file, so a #define in the sketch does not reach the
+ * library. Change the values here or set them as build flags, e.g. -DEMV_LOG_LEVEL=0.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Log_h
+#define EMV_Log_h
+
+#define EMV_LOG_LEVEL_NONE 0
+#define EMV_LOG_LEVEL_ERROR 1  // the read failed, e.g. the card did not accept the GPO
+#define EMV_LOG_LEVEL_INFO 2   // results, e.g. the name of an AID
+#define EMV_LOG_LEVEL_DEBUG 3  // commands, responses, TLV dumps and the steps of the methods
+
+#define EMV_LOG_COMM 0x01    // the sent and received data (COMM_DEBUG_PRINT)
+#define EMV_LOG_METHOD 0x02  // results from inside the methods (METHOD_DEBUG_PRINT)
+#define EMV_LOG_TLV 0x04     // the decoded responses (TLV_DEBUG_PRINT)
+#define EMV_LOG_PDOL 0x08    // filling the PDOL (PDOL_DEBUG_PRINT)
+
+#ifndef EMV_LOG_LEVEL
+#define EMV_LOG_LEVEL EMV_LOG_LEVEL_DEBUG
+#endif
+
+#ifndef EMV_LOG_CATEGORIES
+#define EMV_LOG_CATEGORIES (EMV_LOG_COMM | EMV_LOG_METHOD | EMV_LOG_TLV | EMV_LOG_PDOL)
+#endif
+
+// true if statements of level and category are compiled in and flag switches them on at run time
+#define EMV_LOG_ON(level, category, flag) ((EMV_LOG_LEVEL >= (level)) && (((category) & EMV_LOG_CATEGORIES) != 0) && (flag))
+
+#endif
@@ -0,0 +1,113 @@
+#include "EMV_Metrics.h"
+
+// a PN532 exchange takes some milliseconds, a long record or a slow card up to 100 ms
+const uint32_t EMV_METRICS_BUCKET_LIMITS[EMV_METRICS_BUCKETS - 1] = { 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+
+static const char* COMMAND_NAMES[EMV_METRICS_COMMANDS] = { "SELECT", "GPO", "READ RECORD", "GET RESPONSE", "other" };
+
+void EMV_Metrics::reset() {
+  memset(&data, 0, sizeof(data));
+  data.version = EMV_METRICS_VERSION;
+  lastCommand = EMV_METRICS_OTHER;
+  currentAid = NULL;
+  isAidSelected = false;
+}
+
+void EMV_Metrics::setAid(const byte* aid, byte aidLen) {
+  currentAid = NULL;
+  isAidSelected = aid != NULL && aidLen > 0;
+  if (!isAidSelected) return;
+  if (aidLen > EMV_METRICS_AID_SIZE) aidLen = EMV_METRICS_AID_SIZE;
+  for (uint8_t i = 0; i < EMV_METRICS_AIDS; i++) {
+    EMV_AidMetrics* entry = &data.aids[i];
+    if (entry->aidLen == aidLen && memcmp(entry->aid, aid, aidLen) == 0) {
+      currentAid = entry;
+      return;
+    }
+    if (entry->aidLen == 0) {
+      memcpy(entry->aid, aid, aidLen);
+      entry->aidLen = aidLen;
+      currentAid = entry;
+      return;
+    }
+  }
+}
+
+static uint8_t bucketOf(uint32_t micros) {
+  uint8_t bucket = 0;
+  while (bucket < EMV_METRICS_BUCKETS - 1 && micros > EMV_METRICS_BUCKET_LIMITS[bucket]) bucket++;
+  return bucket;
+}
+
+void EMV_Metrics::recordExchange(const byte* sendData, uint16_t sendLen, uint16_t recvLen, uint32_t micros, bool success, bool noResponse) {
+  lastCommand = commandType(sendData, sendLen);
+  EMV_CommandMetrics* command = &data.commands[lastCommand];
+  uint8_t bucket = bucketOf(micros);
+  command->exchanges++;
+  if (!success) command->errors++;
+  if (noResponse) command->noResponses++;
+  command->bytesSent += sendLen;
+  if (success && !noResponse) command->bytesReceived += recvLen;
+  if (micros > command->maxMicros) command->maxMicros = micros;
+  command->totalMicros += micros;
+  command->histogram[bucket]++;
+  if (currentAid != NULL) {
+    currentAid->exchanges++;
+    currentAid->totalMicros += micros;
+    currentAid->histogram[bucket]++;
+  } else if (isAidSelected) {
+    data.untrackedAidExchanges++;
+  }
+}
+
+EMV_MetricsCommand EMV_Metrics::commandType(const byte* sendData, uint16_t sendLen) {
+  if (sendLen < 2) return EMV_METRICS_OTHER;
+  switch (sendData[1]) {
+    case 0xA4: return EMV_METRICS_SELECT;
+    case 0xA8: return EMV_METRICS_GPO;
+    case 0xB2: return EMV_METRICS_READ_RECORD;
+    case 0xC0: return EMV_METRICS_GET_RESPONSE;
+  }
+  return EMV_METRICS_OTHER;
+}
+
+const char* EMV_Metrics::commandName(EMV_MetricsCommand command) {
+  return (command < EMV_METRICS_COMMANDS) ? COMMAND_NAMES[command] : "?";
+}
+
+static void printHistogram(const uint32_t* histogram) {
+  for (uint8_t i = 0; i < EMV_METRICS_BUCKETS; i++) Serial.printf(" %6lu", (unsigned long)histogram[i]);
+  Serial.println();
+}
+
+void EMV_PrintMetrics(const EMV_MetricsSnapshot* snapshot) {
+  Serial.println("Command       exchanges errors no resp retries Le fallb     sent     recv  avg us  max us");
+  for (uint8_t i = 0; i < EMV_METRICS_COMMANDS; i++) {
+    const EMV_CommandMetrics* command = &snapshot->commands[i];
+    if (command->exchanges == 0) continue;
+    Serial.printf("%-13s %9lu %6lu %7lu %7lu %8lu %8lu %8lu %7lu %7lu\n", EMV_Metrics::commandName((EMV_MetricsCommand)i),
+                  (unsigned long)command->exchanges, (unsigned long)command->errors, (unsigned long)command->noResponses,
+                  (unsigned long)command->retries, (unsigned long)command->leFallbacks, (unsigned long)command->bytesSent,
+                  (unsigned long)command->bytesReceived, (unsigned long)(command->totalMicros / command->exchanges),
+                  (unsigned long)command->maxMicros);
+  }
+  Serial.print("Latency up to us      ");
+  for (uint8_t i = 0; i < EMV_METRICS_BUCKETS - 1; i++) Serial.printf(" %6lu", (unsigned long)EMV_METRICS_BUCKET_LIMITS[i]);
+  Serial.println("  above");
+  for (uint8_t i = 0; i < EMV_METRICS_COMMANDS; i++) {
+    if (snapshot->commands[i].exchanges == 0) continue;
+    Serial.printf("%-22s", EMV_Metrics::commandName((EMV_MetricsCommand)i));
+    printHistogram(snapshot->commands[i].histogram);
+  }
+  for (uint8_t i = 0; i < EMV_METRICS_AIDS; i++) {
+    const EMV_AidMetrics* aid = &snapshot->aids[i];
+    if (aid->aidLen == 0) continue;
+    Serial.print("AID ");
+    for (uint8_t j = 0; j < aid->aidLen; j++) Serial.printf("%02X", aid->aid[j]);
+    if (aid->aidLen < 9) Serial.printf("%*s", 18 - 2 * aid->aidLen, "");
+    printHistogram(aid->histogram);
+  }
+  if (snapshot->untrackedAidExchanges > 0) {
+    Serial.printf("Exchanges of AIDs without a histogram %lu\n", (unsigned long)snapshot->untrackedAidExchanges);
+  }
+}
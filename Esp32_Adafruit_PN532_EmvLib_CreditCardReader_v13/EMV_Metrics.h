@@ -0,0 +1,96 @@
+/**
+ * Permanent metrics of the ESP32_EMV library (emv.metrics).
+ * Every exchange is counted by its command type (SELECT, GET PROCESSING OPTIONS, READ RECORD,
+ * GET RESPONSE, others): exchanges, failed exchanges, EMV_STATUS_NO_RESPONSE, retries,
+ * Le fallbacks (67 00 and 6Cxx), bytes sent and received and the latency in a histogram with
+ * fixed buckets. A second histogram is kept per AID, all exchanges after the Select of an AID
+ * belong to this AID, so slow card families show up.
+ * The counters are a plain struct: snapshot() copies it for an export (e.g. a binary upload
+ * together with EMV_LIBRARY_VERSION to compare firmware versions), EMV_PrintMetrics prints it.
+ * Recording an exchange is a few additions and at most EMV_METRICS_BUCKETS compares, the
+ * metrics are always on.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Metrics_h
+#define EMV_Metrics_h
+
+#include "Arduino.h"
+
+#define EMV_METRICS_VERSION 1
+#define EMV_METRICS_BUCKETS 9       // the last bucket takes all exchanges above the last limit
+#define EMV_METRICS_AIDS 6          // number of AIDs with an own histogram
+#define EMV_METRICS_AID_SIZE 16
+
+// the upper limits (microseconds) of the latency buckets 0 .. EMV_METRICS_BUCKETS - 2
+extern const uint32_t EMV_METRICS_BUCKET_LIMITS[EMV_METRICS_BUCKETS - 1];
+
+enum EMV_MetricsCommand : byte {
+  EMV_METRICS_SELECT = 0,
+  EMV_METRICS_GPO = 1,
+  EMV_METRICS_READ_RECORD = 2,
+  EMV_METRICS_GET_RESPONSE = 3,
+  EMV_METRICS_OTHER = 4,
+  EMV_METRICS_COMMANDS = 5
+};
+
+struct EMV_CommandMetrics {
+  uint32_t exchanges;
+  uint32_t errors;       // the transport failed
+  uint32_t noResponses;  // EMV_STATUS_NO_RESPONSE
+  uint32_t retries;      // resends after a missing response
+  uint32_t leFallbacks;  // resends with another Le
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t maxMicros;
+  uint64_t totalMicros;
+  uint32_t histogram[EMV_METRICS_BUCKETS];
+};
+
+struct EMV_AidMetrics {
+  byte aid[EMV_METRICS_AID_SIZE];
+  byte aidLen;  // 0 = unused
+  uint32_t exchanges;
+  uint64_t totalMicros;
+  uint32_t histogram[EMV_METRICS_BUCKETS];
+};
+
+struct EMV_MetricsSnapshot {
+  byte version;  // EMV_METRICS_VERSION
+  EMV_CommandMetrics commands[EMV_METRICS_COMMANDS];
+  EMV_AidMetrics aids[EMV_METRICS_AIDS];
+  uint32_t untrackedAidExchanges;  // exchanges of AIDs that found no free histogram
+};
+
+class EMV_Metrics {
+
+public:
+  EMV_Metrics() { reset(); }
+  void reset();
+
+  // the following exchanges belong to this AID, NULL = no AID (e.g. SELECT PPSE)
+  void setAid(const byte* aid, byte aidLen);
+  // one exchange, the command type is taken from the INS byte of the command
+  void recordExchange(const byte* sendData, uint16_t sendLen, uint16_t recvLen, uint32_t micros, bool success, bool noResponse);
+  // resends of the last command
+  void recordRetry() { data.commands[lastCommand].retries++; }
+  void recordLeFallback() { data.commands[lastCommand].leFallbacks++; }
+
+  void snapshot(EMV_MetricsSnapshot* snapshot) { *snapshot = data; }
+  const EMV_MetricsSnapshot* get() { return &data; }
+
+  static EMV_MetricsCommand commandType(const byte* sendData, uint16_t sendLen);
+  static const char* commandName(EMV_MetricsCommand command);
+
+private:
+  EMV_MetricsSnapshot data;
+  EMV_MetricsCommand lastCommand = EMV_METRICS_OTHER;
+  EMV_AidMetrics* currentAid = NULL;
+  bool isAidSelected = false;
+};
+
+// prints the counters and the histograms
+void EMV_PrintMetrics(const EMV_MetricsSnapshot* snapshot);
+
+#endif
@@ -0,0 +1,217 @@
+#include "EMV_Pipeline.h"
+#include "EMV_Tlv.h"
+#include "EMV_Tags.h"
+#include "EMV_StatusWord.h"
+#include "EMV_Bcd.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+/////////////////////////////////////////////////////////////////////
+// Ring
+
+EMV_PipelineItem* EMV_ResponseRing::reserve() {
+  uint32_t position = head.load(std::memory_order_relaxed);
+  if (position - tail.load(std::memory_order_acquire) >= EMV_PIPELINE_SLOTS) {
+    fullCount++;
+    return NULL;
+  }
+  return &slots[position & (EMV_PIPELINE_SLOTS - 1)];
+}
+
+void EMV_ResponseRing::publish() {
+  head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const EMV_PipelineItem* EMV_ResponseRing::peek() {
+  uint32_t position = tail.load(std::memory_order_relaxed);
+  if (position == head.load(std::memory_order_acquire)) return NULL;
+  return &slots[position & (EMV_PIPELINE_SLOTS - 1)];
+}
+
+void EMV_ResponseRing::release() {
+  tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void EMV_PipelineYield() {
+#ifdef ARDUINO
+  vTaskDelay(1);
+#else
+  std::this_thread::yield();
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// I/O stage
+
+EMV_PipelineTransport::EMV_PipelineTransport(EMV_Transport* transport, EMV_ResponseRing* ring) {
+  this->transport = transport;
+  this->ring = ring;
+}
+
+EMV_PipelineItem* EMV_PipelineTransport::waitForSlot() {
+  EMV_PipelineItem* item;
+  while ((item = ring->reserve()) == NULL) EMV_PipelineYield();
+  return item;
+}
+
+EMV_TransceiveStatus EMV_PipelineTransport::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  EMV_TransceiveStatus status = transport->exchange(sendData, sendLen, backData, backSize, backLen);
+  bool isNextPart = pending != NULL && sendLen >= 2 && sendData[1] == 0xC0;  // GET RESPONSE
+  EMV_PipelineItem* item = isNextPart ? pending : NULL;
+  pending = NULL;
+  // a failed exchange ends the response, the reserved slot is not published
+  if (status != EMV_TRANSCEIVE_OK || *backLen < 2) return status;
+
+  EMV_SwClass swClass = EMV_ClassifyResponse(backData, *backLen);
+  if (swClass == EMV_SW_WRONG_LE) return status;
+  if (item == NULL) {
+    item = waitForSlot();
+    item->kind = EMV_PIPELINE_RESPONSE;
+    item->tap = tap;
+    memset(item->command, 0, sizeof(item->command));
+    memcpy(item->command, sendData, (sendLen < sizeof(item->command)) ? sendLen : sizeof(item->command));
+    item->responseLen = 0;
+  }
+  // the data of the part goes behind the data of the previous parts, the status word stays in front of the slot end
+  uint16_t dataLen = *backLen - 2;
+  uint16_t freeLen = sizeof(item->response) - 2 - item->responseLen;
+  if (dataLen > freeLen) {
+    dataLen = freeLen;
+    cutCount++;
+  }
+  memcpy(&item->response[item->responseLen], backData, dataLen);
+  item->responseLen += dataLen;
+  if (swClass == EMV_SW_MORE_DATA) {
+    pending = item;
+    return status;
+  }
+  item->response[item->responseLen++] = backData[*backLen - 2];
+  item->response[item->responseLen++] = backData[*backLen - 1];
+  ring->publish();
+  return status;
+}
+
+void EMV_PipelineTransport::endTap() {
+  pending = NULL;
+  EMV_PipelineItem* item = waitForSlot();
+  item->kind = EMV_PIPELINE_END_OF_TAP;
+  item->tap = tap;
+  item->responseLen = 0;
+  ring->publish();
+  tap++;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Parse stage
+
+EMV_ParseStage::EMV_ParseStage(EMV_ResponseRing* ring, void (*onTap)(const EMV_PipelineResult* result)) {
+  this->ring = ring;
+  this->onTap = onTap;
+  memset(&result, 0, sizeof(result));
+}
+
+bool EMV_ParseStage::start(uint8_t core) {
+  if (!stopped) return false;
+  running = true;
+  stopped = false;
+#ifdef ARDUINO
+  TaskHandle_t handle;
+  if (xTaskCreatePinnedToCore(run, "EMV_ParseStage", 4096, this, 1, &handle, core) != pdPASS) {
+    running = false;
+    stopped = true;
+    return false;
+  }
+  thread = handle;
+#else
+  (void)core;
+  thread = new std::thread(run, this);
+#endif
+  return true;
+}
+
+void EMV_ParseStage::stop() {
+  if (stopped) return;
+  running = false;
+#ifdef ARDUINO
+  while (!stopped) EMV_PipelineYield();
+#else
+  std::thread* worker = (std::thread*)thread;
+  worker->join();
+  delete worker;
+#endif
+  thread = NULL;
+}
+
+void EMV_ParseStage::run(void* stage) {
+  EMV_ParseStage* parseStage = (EMV_ParseStage*)stage;
+  while (parseStage->running) {
+    if (parseStage->poll() == 0) EMV_PipelineYield();
+  }
+  parseStage->poll();  // the items published before stop()
+  parseStage->stopped = true;
+#ifdef ARDUINO
+  vTaskDelete(NULL);
+#endif
+}
+
+uint16_t EMV_ParseStage::poll() {
+  uint16_t count = 0;
+  const EMV_PipelineItem* item;
+  while ((item = ring->peek()) != NULL) {
+    parse(item);
+    ring->release();
+    count++;
+  }
+  return count;
+}
+
+void EMV_ParseStage::parse(const EMV_PipelineItem* item) {
+  if (item->kind == EMV_PIPELINE_END_OF_TAP) {
+    result.tap = item->tap;
+    taps++;
+    if (onTap != NULL) onTap(&result);
+    memset(&result, 0, sizeof(result));
+    return;
+  }
+  responses++;
+  result.responses++;
+  EMV_SwClass swClass = EMV_ClassifyResponse(item->response, item->responseLen);
+  if (swClass != EMV_SW_SUCCESS && swClass != EMV_SW_WARNING) return;
+
+  static const uint32_t PIPELINE_TAGS[] = { EMV_TAG_TRACK2_EQUIVALENT_DATA, EMV_TAG_TRACK2_DATA, EMV_TAG_PAN, EMV_TAG_EXPIRATION_DATE,
+                                            EMV_TAG_APPLICATION_LABEL };
+  EMV_TagIndex tagIndex(PIPELINE_TAGS, sizeof(PIPELINE_TAGS) / sizeof(PIPELINE_TAGS[0]));
+  tagIndex.build(item->response, item->responseLen - 2);
+  uint16_t length;
+  const byte* value;
+
+  // tag 5A and 5F24 of the records win over tag 57 of the GPO response
+  // an invalid data element leaves the field empty
+  uint8_t panLen;
+  if ((value = tagIndex.find(EMV_TAG_PAN, &length)) != NULL) {
+    EMV_DecodePan(value, length, result.pan, &panLen);
+  }
+  if ((value = tagIndex.find(EMV_TAG_EXPIRATION_DATE, &length)) != NULL) {
+    EMV_DecodeDate(value, length, result.expDate);
+  }
+  // MasterCard may send tag 9F6B Track 2 Data instead of tag 57
+  if (result.pan[0] == 0 && ((value = tagIndex.find(EMV_TAG_TRACK2_EQUIVALENT_DATA, &length)) != NULL ||
+                             (value = tagIndex.find(EMV_TAG_TRACK2_DATA, &length)) != NULL)) {
+    EMV_Track2 track2;
+    EMV_DecodeTrack2(value, length, &track2);
+    if (track2.panLen > 0) {
+      memcpy(result.pan, track2.pan, track2.panLen + 1);
+      if (result.expDate[0] == 0) memcpy(result.expDate, track2.expDate, sizeof(track2.expDate));
+    }
+  }
+  if ((value = tagIndex.find(EMV_TAG_APPLICATION_LABEL, &length)) != NULL) {
+    uint8_t labelLen = (length < sizeof(result.label) - 1) ? length : sizeof(result.label) - 1;
+    for (uint8_t i = 0; i < labelLen; i++) result.label[i] = (value[i] >= 0x20 && value[i] < 0x7F) ? value[i] : '.';
+    result.label[labelLen] = 0;
+  }
+}
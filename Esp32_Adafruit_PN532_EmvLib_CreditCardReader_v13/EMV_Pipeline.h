@@ -0,0 +1,127 @@
+/**
+ * A two stage read pipeline for the two cores of the ESP32.
+ * The I/O stage runs the read flow (e.g. EMV_Session with all debug output off and
+ * ESP32_EMV::captureOnly set) on one core: it decodes only the AIDs, the PDOL and the AFL it needs
+ * for the next command, and EMV_PipelineTransport passes every response into a bounded single
+ * producer / single consumer ring, a response sent in parts (61xx, GET RESPONSE) as one item. The parse stage (EMV_ParseStage) runs on the other core,
+ * decodes the responses, formats PAN and expiration date and does the Serial output.
+ * The ring is lock free (one atomic index per side) and hands out its slots in place,
+ * a response is copied once into the ring and parsed there.
+ * On the ESP32 the parse stage is a FreeRTOS task pinned to a core, on Linux (no ARDUINO
+ * defined) it is a std::thread, so the pipeline can be stress tested and benchmarked on a PC.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Pipeline_h
+#define EMV_Pipeline_h
+
+#include "Arduino.h"
+#include <atomic>
+#include "EMV_Transport.h"
+
+#define EMV_PIPELINE_SLOTS 8            // a power of 2
+#define EMV_PIPELINE_MAX_RESPONSE 258   // 256 bytes of data + status word
+
+enum EMV_PipelineItemKind : byte {
+  EMV_PIPELINE_RESPONSE,  // a response APDU
+  EMV_PIPELINE_END_OF_TAP // the read flow of a tap is finished
+};
+
+struct EMV_PipelineItem {
+  EMV_PipelineItemKind kind;
+  uint32_t tap;
+  byte command[4];  // CLA INS P1 P2 of the command
+  uint16_t responseLen;
+  byte response[EMV_PIPELINE_MAX_RESPONSE];
+};
+
+class EMV_ResponseRing {
+
+public:
+  // producer: the next free slot or NULL if the ring is full, publish() hands it to the consumer
+  EMV_PipelineItem* reserve();
+  void publish();
+  // consumer: the oldest published slot or NULL if the ring is empty, release() frees it
+  const EMV_PipelineItem* peek();
+  void release();
+
+  uint32_t fullCount = 0;  // producer side: reserve() found the ring full
+
+private:
+  EMV_PipelineItem slots[EMV_PIPELINE_SLOTS];
+  std::atomic<uint32_t> head{ 0 };  // written by the producer only
+  std::atomic<uint32_t> tail{ 0 };  // written by the consumer only
+};
+
+// lets the other task run while a stage waits for the ring
+void EMV_PipelineYield();
+
+// The I/O stage: forwards every exchange and passes the response into the ring. If the ring
+// is full the I/O stage waits for the parse stage. The ring gets the responses as TransceiveLong
+// returns them: the parts of a 61xx response are joined in the slot behind the data of the
+// command and published with the status word of the last part, a 6Cxx response is dropped
+// (the command is sent once again with the exact Le).
+class EMV_PipelineTransport : public EMV_Transport {
+
+public:
+  EMV_PipelineTransport(EMV_Transport* transport, EMV_ResponseRing* ring);
+
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  bool detectCard() override { return transport->detectCard(); }
+  bool checkPresence() override { return transport->checkPresence(); }
+  byte cardUid(byte* uid) override { return transport->cardUid(uid); }
+  byte detectCards(byte maxCards) override { return transport->detectCards(maxCards); }
+  bool selectCard(byte index) override { return transport->selectCard(index); }
+  uint16_t maxResponseLen() override { return transport->maxResponseLen(); }
+  // call when the read flow of a tap is finished
+  void endTap();
+
+  uint32_t cutCount = 0;  // joined responses longer than a slot, the data is cut
+
+private:
+  EMV_Transport* transport;
+  EMV_ResponseRing* ring;
+  uint32_t tap = 0;
+  EMV_PipelineItem* pending = NULL;  // the reserved slot of a response with 61xx, waiting for the next part
+  EMV_PipelineItem* waitForSlot();
+};
+
+// the result of one tap, formatted by the parse stage
+struct EMV_PipelineResult {
+  uint32_t tap;
+  char pan[20];      // digits, "" if not found
+  char expDate[7];   // YYMM or YYMMDD
+  char label[17];    // Application Label (tag 50)
+  uint16_t responses;
+};
+
+// The parse stage: decodes the responses of the ring and calls onTap after every tap.
+class EMV_ParseStage {
+
+public:
+  EMV_ParseStage(EMV_ResponseRing* ring, void (*onTap)(const EMV_PipelineResult* result));
+
+  // starts the parse stage on a core (ESP32) or in a thread (Linux)
+  bool start(uint8_t core);
+  // waits until all published items are parsed and stops the parse stage
+  void stop();
+  // parses the available items, returns the number of items
+  uint16_t poll();
+
+  uint32_t taps = 0;
+  uint32_t responses = 0;
+  std::atomic<bool> running{ false };
+  std::atomic<bool> stopped{ true };
+
+private:
+  EMV_ResponseRing* ring;
+  void (*onTap)(const EMV_PipelineResult* result);
+  EMV_PipelineResult result;
+  void* thread = NULL;
+
+  void parse(const EMV_PipelineItem* item);
+  static void run(void* stage);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "EMV_Presence.h"
+
+EMV_PresenceMonitor::EMV_PresenceMonitor(ESP32_EMV* emv) {
+  this->emv = emv;
+}
+
+void EMV_PresenceMonitor::reset() {
+  cardPresent = false;
+  checked = false;
+  failedInRow = 0;
+}
+
+EMV_PresenceEvent EMV_PresenceMonitor::update() {
+  uint32_t now = millis();
+  if (checked && now - lastCheckMillis < pollPeriodMillis) return EMV_PRESENCE_NONE;
+  checked = true;
+  lastCheckMillis = now;
+  checks++;
+
+  if (!cardPresent) {
+    if (!emv->DetectCard()) return EMV_PRESENCE_NONE;
+    cardPresent = true;
+    failedInRow = 0;
+    arrivedMillis = now;
+    return EMV_PRESENCE_ARRIVED;
+  }
+
+  if (emv->CheckPresence()) {
+    failedInRow = 0;
+    return EMV_PRESENCE_NONE;
+  }
+  failedChecks++;
+  if (++failedInRow <= removalRetries) return EMV_PRESENCE_NONE;
+  cardPresent = false;
+  removedMillis = now;
+  return EMV_PRESENCE_REMOVED;
+}
+
+const char* EMV_PresenceMonitor::eventText(EMV_PresenceEvent event) {
+  switch (event) {
+    case EMV_PRESENCE_NONE: return "none";
+    case EMV_PRESENCE_ARRIVED: return "card arrived";
+    case EMV_PRESENCE_REMOVED: return "card removed";
+  }
+  return "?";
+}
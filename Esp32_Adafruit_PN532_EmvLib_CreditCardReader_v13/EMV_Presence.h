@@ -0,0 +1,60 @@
+/**
+ * Card presence and removal detection for the ESP32_EMV library.
+ * EMV_PresenceMonitor replaces a blocking poll: every call of update() does at most one check
+ * when the poll period is over and returns at once. Without a card the check is one activation
+ * attempt (DetectCard), with a card it is a presence check of the activated card (CheckPresence).
+ * update() returns EMV_PRESENCE_ARRIVED once for a new card and EMV_PRESENCE_REMOVED once when it
+ * has left the field, so a card that stays on the reader is read only once.
+ * A presence check fails now and then while the card is moved in the field, the card counts as
+ * removed after removalRetries + 1 failed checks in a row.
+ * For the PN532 reader set nfc.setPassiveActivationRetries(0x01), then a check without a card
+ * returns after one activation attempt and a new card is found within a few poll periods.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Presence_h
+#define EMV_Presence_h
+
+#include "Arduino.h"
+#include "ESP32_EMV.h"
+
+#define EMV_PRESENCE_POLL_MILLIS 20      // default time between two checks
+#define EMV_PRESENCE_REMOVAL_RETRIES 2   // default failed checks that are retried before a card is removed
+
+enum EMV_PresenceEvent : byte {
+  EMV_PRESENCE_NONE = 0,
+  EMV_PRESENCE_ARRIVED = 1,  // a new card was activated, it can be read now
+  EMV_PRESENCE_REMOVED = 2   // the card has left the field
+};
+
+class EMV_PresenceMonitor {
+
+public:
+  EMV_PresenceMonitor(ESP32_EMV* emv);
+
+  void setPollPeriod(uint32_t millis) { pollPeriodMillis = millis; }
+  void setRemovalRetries(byte retries) { removalRetries = retries; }
+  // forgets the card, the next update() looks for a new one
+  void reset();
+  // does one check if the poll period is over and returns the event
+  EMV_PresenceEvent update();
+  bool isCardPresent() { return cardPresent; }
+  static const char* eventText(EMV_PresenceEvent event);
+
+  uint32_t arrivedMillis = 0;  // millis() of the last EMV_PRESENCE_ARRIVED
+  uint32_t removedMillis = 0;  // millis() of the last EMV_PRESENCE_REMOVED
+  uint32_t checks = 0;         // DetectCard and CheckPresence calls
+  uint32_t failedChecks = 0;   // presence checks that failed, including the retried ones
+
+private:
+  ESP32_EMV* emv;
+  uint32_t pollPeriodMillis = EMV_PRESENCE_POLL_MILLIS;
+  byte removalRetries = EMV_PRESENCE_REMOVAL_RETRIES;
+  bool cardPresent = false;
+  bool checked = false;  // false until the first check, it runs at once
+  uint32_t lastCheckMillis = 0;
+  byte failedInRow = 0;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "EMV_RecordCapture.h"
+
+void EMV_RecordCapture::clear() {
+  numberOfRecords = 0;
+  usedBytes = 0;
+  isOverflow = false;
+}
+
+byte* EMV_RecordCapture::reserve() {
+  if (numberOfRecords >= EMV_RECORD_CAPTURE_RECORDS || EMV_RECORD_CAPTURE_SIZE - usedBytes < EMV_RECORD_CAPTURE_MAX_RESPONSE) {
+    isOverflow = true;
+    return NULL;
+  }
+  return &buffer[usedBytes];
+}
+
+bool EMV_RecordCapture::commit(byte sfi, byte record, uint8_t aidIndex, uint16_t length) {
+  if (numberOfRecords >= EMV_RECORD_CAPTURE_RECORDS || length > EMV_RECORD_CAPTURE_SIZE - usedBytes) {
+    isOverflow = true;
+    return false;
+  }
+  EMV_CapturedRecord* entry = &records[numberOfRecords++];
+  entry->sfi = sfi;
+  entry->record = record;
+  entry->aidIndex = aidIndex;
+  entry->offset = usedBytes;
+  entry->length = length;
+  usedBytes += length;
+  return true;
+}
@@ -0,0 +1,56 @@
+/**
+ * A preallocated capture area for the raw READ RECORD responses of a read.
+ * While the card is in the field the records are only received into the capture area
+ * (ESP32_EMV::CaptureRecord), nothing gets decoded or printed. When the read is finished the
+ * records are parsed from here (ESP32_EMV::ParseRecord), so the time in the field is the time
+ * of the commands to the card only.
+ * The records are stored one after another in one fixed buffer, a response is received
+ * directly into the free part of the buffer and is not copied again.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_RecordCapture_h
+#define EMV_RecordCapture_h
+
+#include "Arduino.h"
+#include "EMV_Transport.h"
+
+#define EMV_RECORD_CAPTURE_SIZE 2048      // bytes for all records of a read
+#define EMV_RECORD_CAPTURE_RECORDS 16     // records of a read
+#define EMV_RECORD_CAPTURE_MAX_RESPONSE EMV_MAX_RESPONSE  // a reassembled response, see EMV_Transport.h
+
+struct EMV_CapturedRecord {
+  byte sfi;
+  byte record;
+  uint8_t aidIndex;  // the AID the record belongs to
+  uint16_t offset;   // offset of the record in the capture area
+  uint16_t length;   // record data without the status word
+};
+
+class EMV_RecordCapture {
+
+public:
+  // forgets all records, call before a new read
+  void clear();
+  // the free part of the capture area for the next response (EMV_RECORD_CAPTURE_MAX_RESPONSE
+  // bytes) or NULL if the capture area is full
+  byte* reserve();
+  // stores the response received into reserve() as the next record, length without the status word
+  bool commit(byte sfi, byte record, uint8_t aidIndex, uint16_t length);
+
+  uint8_t count() { return numberOfRecords; }
+  const EMV_CapturedRecord* entry(uint8_t index) { return &records[index]; }
+  const byte* data(uint8_t index) { return &buffer[records[index].offset]; }
+  uint16_t used() { return usedBytes; }
+  bool overflow() { return isOverflow; }
+
+private:
+  byte buffer[EMV_RECORD_CAPTURE_SIZE];
+  EMV_CapturedRecord records[EMV_RECORD_CAPTURE_RECORDS];
+  uint8_t numberOfRecords = 0;
+  uint16_t usedBytes = 0;
+  bool isOverflow = false;
+};
+
+#endif
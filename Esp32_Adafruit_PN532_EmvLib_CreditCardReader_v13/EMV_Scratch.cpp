@@ -0,0 +1,12 @@
+#include "EMV_Scratch.h"
+
+byte* EMV_ScratchArena::alloc(uint16_t size) {
+  if (size > EMV_SCRATCH_SIZE - used) {
+    failures++;
+    return NULL;
+  }
+  byte* block = &buffer[used];
+  used += size;
+  if (used > highWater) highWater = used;
+  return block;
+}
@@ -0,0 +1,54 @@
+/**
+ * One scratch arena per ESP32_EMV instance for the buffers of the data path.
+ * The commands and responses of an exchange (the response of SelectApdu, SendPdol and ReadRecord,
+ * the command APDU of the *_Le methods and the PDOL data) are taken
+ * from the arena instead of the stack of the calling task. A method opens an EMV_ScratchScope,
+ * allocates its buffers and everything is given back when the method returns.
+ * highWater tells how much of the arena a read needed.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Scratch_h
+#define EMV_Scratch_h
+
+#include "Arduino.h"
+
+// the deepest path is SendPdol: response 255 + PDOL data 249 + command 261, the parts of a
+// GET RESPONSE are received directly behind the data in the response
+#define EMV_SCRATCH_SIZE 1024
+
+class EMV_ScratchArena {
+
+public:
+  // size bytes of the arena or NULL if the arena is exhausted
+  byte* alloc(uint16_t size);
+  uint16_t mark() { return used; }
+  // gives back everything allocated after mark
+  void release(uint16_t mark) { used = mark; }
+  uint16_t available() { return EMV_SCRATCH_SIZE - used; }
+
+  uint16_t highWater = 0;  // the most bytes in use at the same time
+  uint32_t failures = 0;   // alloc() found the arena exhausted
+
+private:
+  byte buffer[EMV_SCRATCH_SIZE];
+  uint16_t used = 0;
+};
+
+// gives back the buffers allocated in a block when the block is left
+class EMV_ScratchScope {
+
+public:
+  EMV_ScratchScope(EMV_ScratchArena* arena) {
+    this->arena = arena;
+    position = arena->mark();
+  }
+  ~EMV_ScratchScope() { arena->release(position); }
+
+private:
+  EMV_ScratchArena* arena;
+  uint16_t position;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "EMV_Session.h"
+
+EMV_Session::EMV_Session(ESP32_EMV* emv) {
+  this->emv = emv;
+}
+
+void EMV_Session::begin() {
+  state = EMV_SESSION_POLL;
+  aidIndex = 0;
+  aflIndex = 0;
+  panLen = 0;
+  expDateLen = 0;
+  steps = 0;
+  finishedEarly = false;
+  skippedRecords = 0;
+  skippedAids = 0;
+  fromCache = false;
+  uidLen = 0;
+}
+
+bool EMV_Session::beginCard(byte index) {
+  begin();
+  if (!emv->SelectCard(index)) {
+    state = EMV_SESSION_ERROR;
+    return false;
+  }
+  state = EMV_SESSION_SELECT_PPSE;
+  return true;
+}
+
+EMV_SessionState EMV_Session::step() {
+  if (!measureStack) return runStep();
+  EMV_SessionState phase = state;
+  EMV_StackProbe probe;
+  probe.begin();
+  EMV_SessionState newState = runStep();
+  uint16_t used = probe.end();
+  if (used > stackHighWater[phase]) stackHighWater[phase] = used;
+  return newState;
+}
+
+EMV_SessionState EMV_Session::runStep() {
+  uint16_t appLen = sizeof(appData);
+  switch (state) {
+    case EMV_SESSION_POLL:
+      if (emv->DetectCard()) state = EMV_SESSION_SELECT_PPSE;
+      break;
+    case EMV_SESSION_SELECT_PPSE:
+      steps++;
+      if (emv->SelectPpse(appData, &appLen) != ESP32_EMV::EMV_STATUS_OK || emv->card.numberOfAids == 0) {
+        state = EMV_SESSION_ERROR;
+      } else if (takeFromCache(appLen)) {
+        state = EMV_SESSION_DONE;
+      } else {
+        aidIndex = 0;
+        state = EMV_SESSION_SELECT_AID;
+      }
+      break;
+    case EMV_SESSION_SELECT_AID:
+      steps++;
+      if (emv->SelectApdu(emv->card.aids[aidIndex], emv->card.aidsLen[aidIndex], 0x02, appData, &appLen) == ESP32_EMV::EMV_STATUS_OK) {
+        state = EMV_SESSION_SEND_PDOL;
+      } else {
+        state = failedStep(nextAid());
+      }
+      break;
+    case EMV_SESSION_SEND_PDOL:
+      steps++;
+      if (emv->SendPdol(appData, &appLen) != ESP32_EMV::EMV_STATUS_OK) {
+        state = failedStep(nextAid());
+        break;
+      }
+      takeTrack2();
+      if (emv->card.aflLen < 4) {
+        state = nextAid();
+        break;
+      }
+      aflIndex = 0;
+      memcpy(aflEntry, emv->card.afl, 4);
+      state = seekRecord();
+      break;
+    case EMV_SESSION_READ_RECORD:
+      steps++;
+      if (emv->ReadRecord(aflEntry, appData, &appLen) == ESP32_EMV::EMV_STATUS_OK) {
+        if (panLen == 0 && emv->card.panLen > 0) {
+          memcpy(pan, emv->card.pan, emv->card.panLen);
+          panLen = emv->card.panLen;
+        }
+        if (expDateLen == 0 && emv->card.expDateLen > 0) {
+          memcpy(expDate, emv->card.expDate, emv->card.expDateLen);
+          expDateLen = emv->card.expDateLen;
+        }
+        state = nextRecord();
+      } else {
+        state = failedStep(nextRecord());
+      }
+      break;
+    default:
+      // idle or finished, nothing to do
+      break;
+  }
+  if (targets != 0 && (state == EMV_SESSION_SELECT_AID || state == EMV_SESSION_READ_RECORD) && (found() & targets) == targets) {
+    state = finishEarly();
+  }
+  if (state == EMV_SESSION_DONE && cache != NULL && !fromCache && uidLen > 0 && panLen > 0) {
+    cache->put(uid, uidLen, fingerprint, pan, panLen, expDate, expDateLen);
+    uidLen = 0;  // stored once
+  }
+  return state;
+}
+
+// the PPSE response is in appData, true if the card was read within the window of the cache
+bool EMV_Session::takeFromCache(uint16_t ppseResponseLen) {
+  if (cache == NULL) return false;
+  uidLen = emv->CardUid(uid);
+  if (uidLen == 0) return false;
+  fingerprint = EMV_CardCache::fingerprint(appData, ppseResponseLen);
+  const EMV_CachedCard* cached = cache->find(uid, uidLen, fingerprint);
+  if (cached == NULL) return false;
+  memcpy(pan, cached->pan, cached->panLen);
+  panLen = cached->panLen;
+  memcpy(expDate, cached->expDate, cached->expDateLen);
+  expDateLen = cached->expDateLen;
+  fromCache = true;
+  return true;
+}
+
+byte EMV_Session::found() {
+  byte result = 0;
+  if (panLen > 0) result |= EMV_TARGET_PAN;
+  if (expDateLen > 0) result |= EMV_TARGET_EXPIRATION_DATE;
+  return result;
+}
+
+// all targets are found: counts the commands the session would have sent next
+EMV_SessionState EMV_Session::finishEarly() {
+  finishedEarly = true;
+  if (state == EMV_SESSION_SELECT_AID) {
+    skippedAids = emv->card.numberOfAids - aidIndex;
+    return EMV_SESSION_DONE;
+  }
+  skippedAids = emv->card.numberOfAids - aidIndex - 1;
+  skippedRecords = aflEntry[2] - aflEntry[1] + 1;
+  for (uint8_t i = aflIndex + 1; i < emv->card.aflLen / 4; i++) {
+    const byte* entry = &emv->card.afl[4 * i];
+    if (entry[1] != 0 && entry[1] <= entry[2]) skippedRecords += entry[2] - entry[1] + 1;
+  }
+  return EMV_SESSION_DONE;
+}
+
+EMV_SessionState EMV_Session::nextAid() {
+  aidIndex++;
+  return (aidIndex < emv->card.numberOfAids) ? EMV_SESSION_SELECT_AID : EMV_SESSION_DONE;
+}
+
+EMV_SessionState EMV_Session::nextRecord() {
+  aflEntry[1]++;
+  return seekRecord();
+}
+
+// a command failed: the read goes on with next if the card rejected the command (e.g. 6A 83 record
+// not found) and ends with an error if the exchange failed or the card left the field
+EMV_SessionState EMV_Session::failedStep(EMV_SessionState next) {
+  if (emv->lastExchangeStatus != ESP32_EMV::EMV_STATUS_OK || !emv->CheckPresence()) return EMV_SESSION_ERROR;
+  return next;
+}
+
+// skips finished and malformed AFL entries (record 0 or first record > last record)
+EMV_SessionState EMV_Session::seekRecord() {
+  while (aflEntry[1] == 0 || aflEntry[1] > aflEntry[2]) {
+    aflIndex++;
+    if (aflIndex >= emv->card.aflLen / 4) return nextAid();
+    memcpy(aflEntry, &emv->card.afl[4 * aflIndex], 4);
+  }
+  return EMV_SESSION_READ_RECORD;
+}
+
+// PAN and expiration date (YYMM) from the Track 2 Equivalent Data of the GPO response
+void EMV_Session::takeTrack2() {
+  if (emv->card.track2Len == 0 || panLen > 0) return;
+  // SendPdol decoded the track 2, an invalid track 2 has no PAN characters
+  if (emv->card.panCharLen == 0) return;
+  panLen = EMV_EncodeBcd(emv->card.panChar, emv->card.panCharLen, pan);
+  expDateLen = EMV_EncodeBcd(emv->card.expDateChar, emv->card.expDateCharLen, expDate);
+}
+
+const char* EMV_Session::stateText(EMV_SessionState state) {
+  switch (state) {
+    case EMV_SESSION_IDLE: return "idle";
+    case EMV_SESSION_POLL: return "poll";
+    case EMV_SESSION_SELECT_PPSE: return "select PPSE";
+    case EMV_SESSION_SELECT_AID: return "select AID";
+    case EMV_SESSION_SEND_PDOL: return "send PDOL";
+    case EMV_SESSION_READ_RECORD: return "read record";
+    case EMV_SESSION_DONE: return "done";
+    case EMV_SESSION_ERROR: return "error";
+  }
+  return "?";
+}
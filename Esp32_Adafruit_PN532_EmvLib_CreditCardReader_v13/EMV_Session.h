@@ -0,0 +1,100 @@
+/**
+ * A non-blocking read of an EMV card.
+ * The read flow (poll, Select PPSE, for every AID Select AID, Send PDOL and Read Record for every
+ * record of the AFL) is split into steps, every call of step() sends at most one command and
+ * returns. The loop() can do other work (display, network) between the steps and never waits
+ * in a delay().
+ * For the PN532 reader set nfc.setPassiveActivationRetries(0x01), then a poll returns after one
+ * activation attempt instead of waiting for a card.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Session_h
+#define EMV_Session_h
+
+#include "Arduino.h"
+#include "ESP32_EMV.h"
+#include "EMV_StackProbe.h"
+#include "EMV_CardCache.h"
+
+enum EMV_SessionState : byte {
+  EMV_SESSION_IDLE,         // begin() was not called
+  EMV_SESSION_POLL,         // waiting for a card
+  EMV_SESSION_SELECT_PPSE,
+  EMV_SESSION_SELECT_AID,
+  EMV_SESSION_SEND_PDOL,
+  EMV_SESSION_READ_RECORD,
+  EMV_SESSION_DONE,         // all AIDs are read
+  EMV_SESSION_ERROR         // the card was lost or did not answer the Select PPSE
+};
+
+// the data elements a read is looking for, see EMV_Session::setTargets
+#define EMV_TARGET_PAN 0x01
+#define EMV_TARGET_EXPIRATION_DATE 0x02
+
+class EMV_Session {
+
+public:
+  EMV_Session(ESP32_EMV* emv);
+
+  // starts a new read, the next step polls for a card
+  void begin();
+  // starts the read of card index of ESP32_EMV::DetectCards, the card is already activated and
+  // the next step selects the PPSE. Returns false if there is no such card.
+  bool beginCard(byte index);
+  // does one step (at most one command to the card) and returns the new state
+  EMV_SessionState step();
+  EMV_SessionState getState() { return state; }
+  bool isFinished() { return state == EMV_SESSION_DONE || state == EMV_SESSION_ERROR; }
+  static const char* stateText(EMV_SessionState state);
+  // e.g. EMV_TARGET_PAN | EMV_TARGET_EXPIRATION_DATE: the session is done as soon as all targets are
+  // found and sends no further commands, 0 (default) reads all AIDs and records
+  void setTargets(byte targets) { this->targets = targets; }
+  // the targets found in this session
+  byte found();
+  // a card that is in the cache is done after the SELECT PPSE, the results come from the cache.
+  // Every complete read with a PAN is stored. NULL (default) = no cache.
+  void setCache(EMV_CardCache* cache) { this->cache = cache; }
+
+  // the results, the first PAN and expiration date found (from tag 57 or tag 5A/5F24)
+  byte pan[10];      // BCD, padded with F
+  uint8_t panLen = 0;
+  byte expDate[3];   // BCD YYMM (tag 57) or YYMMDD (tag 5F24)
+  uint8_t expDateLen = 0;
+  uint8_t steps = 0;  // steps with a command to the card in this session
+  // the commands the session did not send because all targets were found
+  bool finishedEarly = false;
+  uint16_t skippedRecords = 0; // READ RECORD of the AFL of the current AID
+  uint8_t skippedAids = 0;     // AIDs not selected (SELECT AID, GPO and their READ RECORD)
+  bool fromCache = false;      // the results were taken from the cache
+
+  // if true every step is measured with an EMV_StackProbe, stackHighWater[state] is the most stack
+  // in bytes a step in this state used since the session was created
+  bool measureStack = false;
+  uint16_t stackHighWater[EMV_SESSION_ERROR + 1] = {};
+
+private:
+  ESP32_EMV* emv;
+  EMV_SessionState state = EMV_SESSION_IDLE;
+  byte targets = 0;
+  EMV_CardCache* cache = NULL;
+  byte uid[EMV_MAX_UID];
+  byte uidLen = 0;
+  uint32_t fingerprint = 0;  // of the PPSE response
+  uint8_t aidIndex = 0;
+  uint8_t aflIndex = 0;
+  byte aflEntry[4];  // the AFL entry in work, aflEntry[1] is the next record
+  byte appData[255];
+
+  EMV_SessionState runStep();
+  EMV_SessionState nextAid();
+  EMV_SessionState nextRecord();
+  EMV_SessionState seekRecord();
+  EMV_SessionState failedStep(EMV_SessionState next);
+  void takeTrack2();
+  EMV_SessionState finishEarly();
+  bool takeFromCache(uint16_t ppseResponseLen);
+};
+
+#endif
@@ -0,0 +1,339 @@
+#include "EMV_SimCard.h"
+
+// the name of the PPSE directory
+static const byte SIM_PPSE_NAME[14] = { 0x32, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31 };
+
+EMV_SimCard::EMV_SimCard(const EMV_SimCardProfile* profile) {
+  this->profile = profile;
+}
+
+void EMV_SimCard::setProfile(const EMV_SimCardProfile* profile) {
+  this->profile = profile;
+  reset();
+}
+
+void EMV_SimCard::reset() {
+  selectedApplication = NULL;
+  pendingLen = 0;
+  exchangeCount = 0;
+}
+
+void EMV_SimCard::setUid(const byte* uid, byte uidLen) {
+  if (uidLen > EMV_MAX_UID) uidLen = 0;
+  if (uidLen > 0) memcpy(this->uid, uid, uidLen);
+  this->uidLen = uidLen;
+}
+
+byte EMV_SimCard::cardUid(byte* uid) {
+  memcpy(uid, this->uid, uidLen);
+  return uidLen;
+}
+
+bool EMV_SimCard::detectCard() {
+  if (!present) return false;
+  reset();
+  return true;
+}
+
+EMV_TransceiveStatus EMV_SimCard::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  exchangeCount++;
+  *backLen = 0;
+  if (profile == NULL || !present) return EMV_TRANSCEIVE_ERROR;  // no card in the field
+  if (sendLen < 5) return respond(NULL, 0, 0x67, 0x00, backData, backSize, backLen);
+
+  byte cla = sendData[0];
+  byte ins = sendData[1];
+  byte p1 = sendData[2];
+  byte p2 = sendData[3];
+
+  // READ RECORD and GET RESPONSE are case 2 commands (CLA INS P1 P2 Le), SELECT and GPO are
+  // case 4 commands (CLA INS P1 P2 Lc Data Le)
+  byte lc = 0;
+  byte leByte = sendData[4];
+  if (sendLen > 5) {
+    lc = sendData[4];
+    if (5 + lc > sendLen) return respond(NULL, 0, 0x67, 0x00, backData, backSize, backLen);
+    leByte = (sendLen > 5 + lc) ? sendData[5 + lc] : 0x00;
+  }
+  if (profile->requiresLeZero && leByte != 0x00) return respond(NULL, 0, 0x67, 0x00, backData, backSize, backLen);
+
+  if (cla == 0x00 && ins == 0xC0) {
+    // GET RESPONSE, the next part of a long response
+    if (pendingLen == 0) return respond(NULL, 0, 0x69, 0x85, backData, backSize, backLen);
+    uint16_t partLen = (leByte == 0x00 || leByte > pendingLen) ? pendingLen : leByte;
+    const byte* part = pendingData;
+    pendingData += partLen;
+    pendingLen -= partLen;
+    if (pendingLen > 0) return respond(part, partLen, 0x61, pendingLen > 0xFF ? 0x00 : pendingLen, backData, backSize, backLen);
+    return respond(part, partLen, 0x90, 0x00, backData, backSize, backLen);
+  }
+  pendingLen = 0;
+
+  const byte* data = NULL;
+  uint16_t dataLen = 0;
+  if (cla == 0x00 && ins == 0xA4 && p1 == 0x04) {
+    // SELECT by name
+    if (lc == sizeof(SIM_PPSE_NAME) && memcmp(&sendData[5], SIM_PPSE_NAME, lc) == 0) {
+      selectedApplication = NULL;
+      data = profile->ppseResponse;
+      dataLen = profile->ppseResponseLen;
+    } else {
+      const EMV_SimApplication* application = findApplication(&sendData[5], lc);
+      if (application == NULL) return respond(NULL, 0, 0x6A, 0x82, backData, backSize, backLen);  // file not found
+      selectedApplication = application;
+      data = application->selectResponse;
+      dataLen = application->selectResponseLen;
+    }
+  } else if (cla == 0x80 && ins == 0xA8) {
+    // GET PROCESSING OPTIONS
+    if (selectedApplication == NULL) return respond(NULL, 0, 0x69, 0x85, backData, backSize, backLen);  // conditions of use not satisfied
+    data = selectedApplication->gpoResponse;
+    dataLen = selectedApplication->gpoResponseLen;
+  } else if (cla == 0x00 && ins == 0xB2) {
+    // READ RECORD, P1 = record number, P2 = SFI << 3 | 0b100
+    if (selectedApplication == NULL) return respond(NULL, 0, 0x69, 0x85, backData, backSize, backLen);
+    const EMV_SimRecord* record = findRecord(p2 >> 3, p1);
+    if (record == NULL) return respond(NULL, 0, 0x6A, 0x83, backData, backSize, backLen);  // record not found
+    data = record->data;
+    dataLen = record->dataLen;
+  } else {
+    return respond(NULL, 0, 0x6D, 0x00, backData, backSize, backLen);  // instruction not supported
+  }
+
+  if (profile->signalsExactLe && leByte != 0x00 && leByte != dataLen && dataLen <= 0xFF) {
+    return respond(NULL, 0, 0x6C, dataLen, backData, backSize, backLen);  // wrong Le, SW2 = exact length
+  }
+  if (profile->responseChunkSize > 0 && dataLen > profile->responseChunkSize) {
+    // the rest of the response is available with GET RESPONSE
+    pendingData = data + profile->responseChunkSize;
+    pendingLen = dataLen - profile->responseChunkSize;
+    return respond(data, profile->responseChunkSize, 0x61, pendingLen > 0xFF ? 0x00 : pendingLen, backData, backSize, backLen);
+  }
+  return respond(data, dataLen, 0x90, 0x00, backData, backSize, backLen);
+}
+
+EMV_TransceiveStatus EMV_SimCard::respond(const byte* data, uint16_t dataLen, byte sw1, byte sw2, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  // like the reader the response gets cut at the size of the receive buffer
+  uint16_t len = dataLen + 2;
+  if (len > backSize) len = backSize;
+  uint16_t copyLen = (dataLen < len) ? dataLen : len;
+  if (copyLen > 0) memcpy(backData, data, copyLen);
+  if (len > dataLen) backData[dataLen] = sw1;
+  if (len > dataLen + 1) backData[dataLen + 1] = sw2;
+  *backLen = len;
+  return (len < dataLen + 2) ? EMV_TRANSCEIVE_TOO_LONG : EMV_TRANSCEIVE_OK;
+}
+
+const EMV_SimApplication* EMV_SimCard::findApplication(const byte* aid, byte aidLen) {
+  for (byte i = 0; i < profile->numberOfApplications; i++) {
+    const EMV_SimApplication* application = &profile->applications[i];
+    if (application->aidLen == aidLen && memcmp(application->aid, aid, aidLen) == 0) return application;
+  }
+  return NULL;
+}
+
+const EMV_SimRecord* EMV_SimCard::findRecord(byte sfi, byte record) {
+  for (byte i = 0; i < selectedApplication->numberOfRecords; i++) {
+    const EMV_SimRecord* simRecord = &selectedApplication->records[i];
+    if (simRecord->sfi == sfi && simRecord->record == record) return simRecord;
+  }
+  return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_SimField
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+bool EMV_SimField::addCard(EMV_SimCard* card) {
+  if (numberOfCards == EMV_MAX_CARDS) return false;
+  cards[numberOfCards++] = card;
+  return true;
+}
+
+EMV_TransceiveStatus EMV_SimField::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  if (selectedCard == NULL) {
+    *backLen = 0;
+    return EMV_TRANSCEIVE_ERROR;
+  }
+  return selectedCard->exchange(sendData, sendLen, backData, backSize, backLen);
+}
+
+byte EMV_SimField::detectCards(byte maxCards) {
+  activations++;
+  if (activationMicros > 0) delayMicroseconds(activationMicros);
+  numberOfListedCards = 0;
+  for (byte i = 0; i < numberOfCards && numberOfListedCards < maxCards && numberOfListedCards < EMV_MAX_CARDS; i++) {
+    if (cards[i]->detectCard()) listedCards[numberOfListedCards++] = cards[i];
+  }
+  selectedCard = (numberOfListedCards > 0) ? listedCards[0] : NULL;
+  return numberOfListedCards;
+}
+
+bool EMV_SimField::selectCard(byte index) {
+  if (index >= numberOfListedCards) return false;
+  selectedCard = listedCards[index];
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_SimReaderFrame
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+EMV_SimReaderFrame::EMV_SimReaderFrame(EMV_Transport* transport, uint16_t packetBufferSize) {
+  this->transport = transport;
+  this->packetBufferSize = packetBufferSize;
+}
+
+EMV_TransceiveStatus EMV_SimReaderFrame::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  *backLen = 0;
+  if (sendLen > packetBufferSize - 2) return EMV_TRANSCEIVE_TOO_LONG;
+  uint16_t frameLen = 0;
+  EMV_TransceiveStatus status = transport->exchange(sendData, sendLen, frame, sizeof(frame), &frameLen);
+  if (status == EMV_TRANSCEIVE_ERROR || status == EMV_TRANSCEIVE_NO_RESPONSE) return status;
+  uint16_t limit = (backSize < maxResponseLen()) ? backSize : maxResponseLen();
+  *backLen = (frameLen < limit) ? frameLen : limit;
+  memcpy(backData, frame, *backLen);
+  return EMV_PN532ResponseStatus(backData, *backLen, limit);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Card profiles
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+// Visa card from Sample_CreditCard_Reading_Log.md (the card is outdated and all data is void)
+// The card answers 67 00 to every command that is not sent with Le = 0x00.
+static const byte VISA_AID[] = {
+  0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10
+};
+static const byte VISA_PPSE[] = {
+  0x6F, 0x40, 0x84, 0x0E, 0x32, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46,
+  0x30, 0x31, 0xA5, 0x2E, 0xBF, 0x0C, 0x2B, 0x61, 0x29, 0x4F, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x03,
+  0x10, 0x10, 0x50, 0x09, 0x56, 0x69, 0x73, 0x61, 0x20, 0x43, 0x61, 0x72, 0x64, 0x87, 0x01, 0x01,
+  0x9F, 0x0A, 0x08, 0x00, 0x01, 0x05, 0x02, 0x00, 0x00, 0x00, 0x00, 0xBF, 0x63, 0x04, 0xDF, 0x20,
+  0x01, 0x80
+};
+static const byte VISA_SELECT[] = {
+  0x6F, 0x51, 0x84, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10, 0xA5, 0x46, 0x50, 0x09, 0x56,
+  0x69, 0x73, 0x61, 0x20, 0x43, 0x61, 0x72, 0x64, 0x87, 0x01, 0x01, 0x9F, 0x38, 0x18, 0x9F, 0x66,
+  0x04, 0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05, 0x5F, 0x2A, 0x02, 0x9A,
+  0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04, 0x5F, 0x2D, 0x04, 0x64, 0x65, 0x65, 0x6E, 0xBF, 0x0C, 0x13,
+  0x9F, 0x5A, 0x05, 0x31, 0x09, 0x78, 0x02, 0x76, 0x9F, 0x0A, 0x08, 0x00, 0x01, 0x05, 0x02, 0x00,
+  0x00, 0x00, 0x00
+};
+static const byte VISA_GPO[] = {
+  0x77, 0x81, 0xD6, 0x82, 0x02, 0x20, 0x00, 0x94, 0x04, 0x10, 0x01, 0x04, 0x00, 0x57, 0x13, 0x41,
+  0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0xD2, 0x80, 0x22, 0x01, 0x00, 0x00, 0x01, 0x73, 0x01,
+  0x00, 0x0F, 0x5F, 0x20, 0x02, 0x20, 0x2F, 0x5F, 0x34, 0x01, 0x01, 0x9F, 0x10, 0x07, 0x06, 0x02,
+  0x12, 0x03, 0xA0, 0x20, 0x00, 0x9F, 0x26, 0x08, 0x2E, 0xC0, 0x60, 0xEC, 0xC9, 0x21, 0x1C, 0x8B,
+  0x9F, 0x27, 0x01, 0x80, 0x9F, 0x36, 0x02, 0x00, 0x2A, 0x9F, 0x6C, 0x02, 0x38, 0x00, 0x9F, 0x6E,
+  0x04, 0x20, 0x70, 0x00, 0x00, 0x9F, 0x4B, 0x81, 0x80, 0x2F, 0xA2, 0xB1, 0x8B, 0xE6, 0xBA, 0x8E,
+  0x29, 0x5C, 0x3B, 0x7D, 0x35, 0xCD, 0xB9, 0x5A, 0xAC, 0x3B, 0xB4, 0x40, 0xB6, 0xE9, 0x09, 0xD5,
+  0xA7, 0xFF, 0xB7, 0xEB, 0x7E, 0x81, 0x39, 0xF2, 0xF9, 0x94, 0xE9, 0x53, 0x09, 0x2E, 0xEB, 0x55,
+  0xF4, 0x12, 0x03, 0xA6, 0x4C, 0x99, 0xBA, 0x93, 0x42, 0x63, 0xEE, 0xA5, 0xF0, 0x77, 0x59, 0xE3,
+  0x43, 0x15, 0xB3, 0x89, 0x73, 0x67, 0x23, 0x60, 0xF4, 0xF4, 0x4D, 0x0C, 0xF9, 0x24, 0x86, 0xA9,
+  0x9C, 0xCB, 0xC5, 0x47, 0xF4, 0x6E, 0xEC, 0x7B, 0x4C, 0x5F, 0xD1, 0xBB, 0x82, 0x37, 0x0B, 0xD6,
+  0xCB, 0xFB, 0x8C, 0x18, 0x4A, 0x24, 0x16, 0xBC, 0x24, 0xC3, 0x53, 0x55, 0x82, 0xBA, 0x9E, 0x61,
+  0x82, 0x08, 0x28, 0x34, 0x8A, 0x43, 0x47, 0x8F, 0x10, 0x0A, 0x1E, 0xD6, 0x6F, 0x61, 0x3E, 0x50,
+  0x86, 0xF7, 0x3C, 0xAE, 0xB9, 0xEE, 0x34, 0xC8, 0x4B
+};
+static const byte VISA_SFI2_R1[] = {
+  0x70, 0x0D, 0x8F, 0x01, 0x09, 0x9F, 0x32, 0x03, 0x01, 0x00, 0x01, 0x9F, 0x47, 0x01, 0x03
+};
+// record 2 could not be read in the sample log (the response is longer than the reader buffer),
+// a short placeholder is used
+static const byte VISA_SFI2_R2[] = {
+  0x70, 0x05, 0x9F, 0x08, 0x02, 0x00, 0x96
+};
+static const byte VISA_SFI2_R3[] = {
+  0x70, 0x0A, 0x5F, 0x28, 0x02, 0x02, 0x76, 0x9F, 0x07, 0x02, 0xC0, 0xC0
+};
+static const byte VISA_SFI2_R4[] = {
+  0x70, 0x81, 0xCE, 0x5A, 0x08, 0x41, 0x63, 0x69, 0x10, 0x02, 0x56, 0x71, 0x14, 0x5F, 0x24, 0x03,
+  0x28, 0x02, 0x29, 0x9F, 0x46, 0x81, 0xB0, 0x33, 0x6D, 0x55, 0xDF, 0x10, 0x4A, 0x56, 0xD4, 0xEC,
+  0x3E, 0x80, 0x5F, 0x41, 0x91, 0x47, 0x8F, 0xD3, 0x21, 0x91, 0xCF, 0x2B, 0x4A, 0x18, 0xBB, 0xEB,
+  0x34, 0xA6, 0xA7, 0xA6, 0x92, 0x63, 0x1F, 0x45, 0x30, 0x1F, 0xC1, 0x31, 0x0A, 0x96, 0x08, 0xE7,
+  0xAC, 0xFE, 0x94, 0x8E, 0xF8, 0xEB, 0x02, 0x88, 0xDE, 0x6B, 0xCD, 0xC1, 0x8C, 0x05, 0xEB, 0xC6,
+  0x7F, 0x0D, 0xC1, 0xF0, 0xF0, 0x67, 0x49, 0x61, 0x51, 0xC6, 0xDA, 0x89, 0x4E, 0xC4, 0x65, 0x1B,
+  0x95, 0x25, 0xCA, 0x0F, 0x77, 0x20, 0x15, 0x64, 0xC8, 0x6E, 0x09, 0x37, 0x01, 0xC4, 0x2A, 0xAD,
+  0x58, 0x08, 0x1A, 0x03, 0xE9, 0x66, 0xB3, 0x87, 0x9A, 0x4F, 0xFA, 0x1A, 0xE5, 0x67, 0x2D, 0xC5,
+  0x83, 0xF5, 0x20, 0x81, 0x7E, 0x39, 0x8B, 0xDC, 0x78, 0xC4, 0x3F, 0xC3, 0x0E, 0x85, 0x3E, 0xD6,
+  0x79, 0x2B, 0x94, 0x96, 0xCB, 0x97, 0xB0, 0x0E, 0x87, 0xA5, 0x50, 0x0E, 0xD5, 0x62, 0xE3, 0x5B,
+  0xD9, 0x6C, 0xC4, 0xDA, 0x9A, 0x1C, 0xB7, 0x62, 0xDC, 0x49, 0x52, 0x45, 0x34, 0x7B, 0x51, 0xCF,
+  0xAE, 0xAF, 0x54, 0x7D, 0x7E, 0x7D, 0x59, 0x4A, 0x1D, 0x5C, 0xFF, 0x15, 0x90, 0x77, 0xCC, 0xDE,
+  0xE9, 0x76, 0x73, 0x4B, 0xE3, 0xC2, 0x50, 0x9F, 0x69, 0x07, 0x01, 0x9E, 0xD8, 0xA7, 0xA1, 0x00,
+  0x00
+};
+
+static const EMV_SimRecord VISA_RECORDS[] = {
+  { 2, 1, VISA_SFI2_R1, sizeof(VISA_SFI2_R1) },
+  { 2, 2, VISA_SFI2_R2, sizeof(VISA_SFI2_R2) },
+  { 2, 3, VISA_SFI2_R3, sizeof(VISA_SFI2_R3) },
+  { 2, 4, VISA_SFI2_R4, sizeof(VISA_SFI2_R4) }
+};
+
+static const EMV_SimApplication VISA_APPLICATIONS[] = {
+  { VISA_AID, sizeof(VISA_AID), VISA_SELECT, sizeof(VISA_SELECT), VISA_GPO, sizeof(VISA_GPO), VISA_RECORDS, 4 }
+};
+
+const EMV_SimCardProfile EMV_SIM_PROFILE_VISA = { "Visa", VISA_PPSE, sizeof(VISA_PPSE), VISA_APPLICATIONS, 1, true, false, 0 };
+// GET RESPONSE is sent with the Le of the reader frame, so this card accepts any Le
+const EMV_SimCardProfile EMV_SIM_PROFILE_VISA_CHUNKED = { "Visa in parts of 40 bytes", VISA_PPSE, sizeof(VISA_PPSE), VISA_APPLICATIONS, 1, false, false, 40 };
+
+// MasterCard without a PDOL, the GPO response carries an AFL with 3 entries (test data, PAN passes the Luhn check)
+static const byte MC_AID[] = {
+  0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10
+};
+static const byte MC_PPSE[] = {
+  0x6F, 0x2F, 0x84, 0x0E, 0x32, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46,
+  0x30, 0x31, 0xA5, 0x1D, 0xBF, 0x0C, 0x1A, 0x61, 0x18, 0x4F, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x04,
+  0x10, 0x10, 0x50, 0x0A, 0x4D, 0x61, 0x73, 0x74, 0x65, 0x72, 0x43, 0x61, 0x72, 0x64, 0x87, 0x01,
+  0x01
+};
+static const byte MC_SELECT[] = {
+  0x6F, 0x21, 0x84, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10, 0xA5, 0x16, 0x50, 0x0A, 0x4D,
+  0x61, 0x73, 0x74, 0x65, 0x72, 0x43, 0x61, 0x72, 0x64, 0x87, 0x01, 0x01, 0x5F, 0x2D, 0x04, 0x64,
+  0x65, 0x65, 0x6E
+};
+static const byte MC_GPO[] = {
+  0x77, 0x12, 0x82, 0x02, 0x19, 0x80, 0x94, 0x0C, 0x08, 0x01, 0x01, 0x00, 0x10, 0x01, 0x01, 0x01,
+  0x20, 0x01, 0x02, 0x00
+};
+static const byte MC_SFI1_R1[] = {
+  0x70, 0x1A, 0x57, 0x13, 0x54, 0x13, 0x33, 0x00, 0x89, 0x01, 0x04, 0x34, 0xD2, 0x81, 0x22, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x5F, 0x20, 0x02, 0x20, 0x2F
+};
+static const byte MC_SFI2_R1[] = {
+  0x70, 0x24, 0x5A, 0x08, 0x54, 0x13, 0x33, 0x00, 0x89, 0x01, 0x04, 0x34, 0x5F, 0x24, 0x03, 0x28,
+  0x12, 0x31, 0x5F, 0x25, 0x03, 0x23, 0x12, 0x01, 0x5F, 0x28, 0x02, 0x02, 0x76, 0x5F, 0x34, 0x01,
+  0x00, 0x9F, 0x07, 0x02, 0xFF, 0x00
+};
+static const byte MC_SFI4_R1[] = {
+  0x70, 0x22, 0x8C, 0x15, 0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05, 0x5F,
+  0x2A, 0x02, 0x9A, 0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04, 0x8D, 0x09, 0x91, 0x0A, 0x8A, 0x02, 0x95,
+  0x05, 0x9F, 0x37, 0x04
+};
+static const byte MC_SFI4_R2[] = {
+  0x70, 0x28, 0x8E, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x03, 0x1E, 0x03,
+  0x1F, 0x03, 0x9F, 0x0D, 0x05, 0xB4, 0x50, 0x84, 0x88, 0x00, 0x9F, 0x0E, 0x05, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x9F, 0x0F, 0x05, 0xB4, 0x70, 0x84, 0x98, 0x00
+};
+
+static const EMV_SimRecord MC_RECORDS[] = {
+  { 1, 1, MC_SFI1_R1, sizeof(MC_SFI1_R1) },
+  { 2, 1, MC_SFI2_R1, sizeof(MC_SFI2_R1) },
+  { 4, 1, MC_SFI4_R1, sizeof(MC_SFI4_R1) },
+  { 4, 2, MC_SFI4_R2, sizeof(MC_SFI4_R2) }
+};
+
+static const EMV_SimApplication MC_APPLICATIONS[] = {
+  { MC_AID, sizeof(MC_AID), MC_SELECT, sizeof(MC_SELECT), MC_GPO, sizeof(MC_GPO), MC_RECORDS, 4 }
+};
+
+const EMV_SimCardProfile EMV_SIM_PROFILE_MASTERCARD = { "MasterCard", MC_PPSE, sizeof(MC_PPSE), MC_APPLICATIONS, 1, false, false, 0 };
+const EMV_SimCardProfile EMV_SIM_PROFILE_MASTERCARD_EXACT_LE = { "MasterCard with exact Le", MC_PPSE, sizeof(MC_PPSE), MC_APPLICATIONS, 1, false, true, 0 };
@@ -0,0 +1,140 @@
+/**
+ * A simulated EMV card for the ESP32_EMV library.
+ * EMV_SimCard is an EMV_Transport that answers the commands of the read flow
+ * (SELECT PPSE, SELECT AID, GET PROCESSING OPTIONS, READ RECORD and GET RESPONSE) from a
+ * scripted card profile instead of sending them to a reader. It is used to run,
+ * profile and tune the read flow without a card in the field.
+ * EMV_SimField holds up to EMV_MAX_CARDS simulated cards that are in the field at the same
+ * time (e.g. a wallet with two cards), as the PN532 does it lists them with one activation.
+ * EMV_SimReaderFrame puts the packet buffer of the Adafruit_PN532 library in front of a simulated
+ * card, so the read flow can be run as it works with the stock or the modified library.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_SimCard_h
+#define EMV_SimCard_h
+
+#include "Arduino.h"
+#include "EMV_Transport.h"
+
+// All responses are stored without the status word, the simulator appends the status word
+struct EMV_SimRecord {
+  byte sfi;             // short file identifier (1..30)
+  byte record;          // record number
+  const byte* data;
+  uint16_t dataLen;
+};
+
+struct EMV_SimApplication {
+  const byte* aid;
+  byte aidLen;
+  const byte* selectResponse;  // response to SELECT AID (FCI template 6F)
+  uint16_t selectResponseLen;
+  const byte* gpoResponse;     // response to GET PROCESSING OPTIONS (77 or 80)
+  uint16_t gpoResponseLen;
+  const EMV_SimRecord* records;
+  byte numberOfRecords;
+};
+
+struct EMV_SimCardProfile {
+  const char* name;
+  const byte* ppseResponse;    // response to SELECT PPSE
+  uint16_t ppseResponseLen;
+  const EMV_SimApplication* applications;
+  byte numberOfApplications;
+  bool requiresLeZero;         // true = the card answers 67 00 to every command with an Le other than 0x00
+  bool signalsExactLe;         // true = a wrong Le is answered with 6Cxx, xx = exact length
+  byte responseChunkSize;      // > 0 = longer responses are sent in parts, announced with 61xx (GET RESPONSE)
+};
+
+// profiles of real cards, see EMV_SimCard.cpp
+extern const EMV_SimCardProfile EMV_SIM_PROFILE_VISA;        // the Visa card of Sample_CreditCard_Reading_Log.md
+extern const EMV_SimCardProfile EMV_SIM_PROFILE_MASTERCARD;  // MasterCard without PDOL, AFL with 3 entries
+// the same cards with the other answers to a long response or a wrong Le
+extern const EMV_SimCardProfile EMV_SIM_PROFILE_VISA_CHUNKED;       // Visa, parts of 40 bytes with 61xx, any Le
+extern const EMV_SimCardProfile EMV_SIM_PROFILE_MASTERCARD_EXACT_LE;  // MasterCard, a wrong Le is answered with 6Cxx
+
+class EMV_SimCard : public EMV_Transport {
+
+public:
+  EMV_SimCard(const EMV_SimCardProfile* profile);
+
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  // every detection is a new tap (reset) as long as the card is present
+  bool detectCard() override;
+  bool checkPresence() override { return present; }
+  byte cardUid(byte* uid) override;
+
+  // a new tap: the card is deselected and has to be selected again
+  void reset();
+  void setProfile(const EMV_SimCardProfile* profile);
+  // the UID the card reports, uidLen 0 (default) = unknown
+  void setUid(const byte* uid, byte uidLen);
+
+  uint32_t exchangeCount = 0;  // number of command APDUs answered since the last reset
+  bool present = true;         // false = the card is not in the field
+
+private:
+  const EMV_SimCardProfile* profile;
+  byte uid[EMV_MAX_UID];
+  byte uidLen = 0;
+  const EMV_SimApplication* selectedApplication = NULL;
+  const byte* pendingData = NULL;  // the part of a long response that is left for GET RESPONSE
+  uint16_t pendingLen = 0;
+
+  EMV_TransceiveStatus respond(const byte* data, uint16_t dataLen, byte sw1, byte sw2, byte* backData, uint16_t backSize, uint16_t* backLen);
+  const EMV_SimApplication* findApplication(const byte* aid, byte aidLen);
+  const EMV_SimRecord* findRecord(byte sfi, byte record);
+};
+
+class EMV_SimField : public EMV_Transport {
+
+public:
+  // the cards are listed in the order they were added, a card that is not present is skipped
+  bool addCard(EMV_SimCard* card);
+
+  // the exchanges go to the selected card
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  bool detectCard() override { return detectCards(1) > 0; }
+  bool checkPresence() override { return selectedCard != NULL && selectedCard->present; }
+  byte cardUid(byte* uid) override { return (selectedCard != NULL) ? selectedCard->cardUid(uid) : 0; }
+  // one activation: every listed card is a new tap, card 0 is selected
+  byte detectCards(byte maxCards) override;
+  bool selectCard(byte index) override;
+
+  uint32_t activationMicros = 0;  // time of one activation by the reader, 0 = none
+  uint32_t activations = 0;       // number of detectCard/detectCards calls
+
+private:
+  EMV_SimCard* cards[EMV_MAX_CARDS];
+  byte numberOfCards = 0;
+  EMV_SimCard* listedCards[EMV_MAX_CARDS];
+  byte numberOfListedCards = 0;
+  EMV_SimCard* selectedCard = NULL;
+};
+
+// The frame of the Adafruit_PN532 library with PN532_PACKBUFFSIZ = packetBufferSize in front of
+// another transport: a longer command fails, a longer response is cut silently as inDataExchange
+// does it and rated with EMV_PN532ResponseStatus as EMV_PN532Transport does it.
+class EMV_SimReaderFrame : public EMV_Transport {
+
+public:
+  EMV_SimReaderFrame(EMV_Transport* transport, uint16_t packetBufferSize);
+
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  uint16_t maxResponseLen() override { return packetBufferSize - EMV_PN532_FRAME_HEADER; }
+  bool detectCard() override { return transport->detectCard(); }
+  bool checkPresence() override { return transport->checkPresence(); }
+  byte cardUid(byte* uid) override { return transport->cardUid(uid); }
+  byte detectCards(byte maxCards) override { return transport->detectCards(maxCards); }
+  bool selectCard(byte index) override { return transport->selectCard(index); }
+
+  uint16_t packetBufferSize;
+
+private:
+  EMV_Transport* transport;
+  byte frame[EMV_MAX_RESPONSE];
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "EMV_StackProbe.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+// not inlined: the frame of begin() is the only stack between the caller and the painted area
+__attribute__((noinline)) void EMV_StackProbe::begin() {
+  volatile byte marker = 0;
+  // the painted area is outside of any object, its address is computed as an integer
+  start = (volatile byte*)((uintptr_t)&marker - EMV_STACK_PROBE_MARGIN);
+  depth = EMV_STACK_PROBE_DEPTH;
+#ifdef ARDUINO
+  // the high water mark of the task is in bytes on the ESP32, keep a margin to the end of the stack
+  uint32_t freeBytes = uxTaskGetStackHighWaterMark(NULL);
+  if (freeBytes < 3 * EMV_STACK_PROBE_MARGIN) {
+    depth = 0;
+  } else if (freeBytes - 3 * EMV_STACK_PROBE_MARGIN < depth) {
+    depth = freeBytes - 3 * EMV_STACK_PROBE_MARGIN;
+  }
+#endif
+  // a volatile loop instead of memset(), a call to memset would use the painted stack
+  for (uint16_t i = 0; i < depth; i++) start[-(int32_t)i] = EMV_STACK_PROBE_PATTERN;
+}
+
+uint16_t EMV_StackProbe::end() {
+  uint16_t used = depth;
+  while (used > 0 && start[-(int32_t)(used - 1)] == EMV_STACK_PROBE_PATTERN) used--;
+  isSaturated = (depth > 0 && used == depth);
+  return used + EMV_STACK_PROBE_MARGIN;
+}
@@ -0,0 +1,38 @@
+/**
+ * Measures how much stack a piece of code uses.
+ * begin() paints the free stack below the caller with a pattern, end() looks for the deepest
+ * painted byte that got overwritten. Call both from the same function, the code in between is
+ * measured including the functions it calls.
+ * On the ESP32 begin() paints no deeper than the free stack of the running task
+ * (uxTaskGetStackHighWaterMark), so the probe is safe in small FreeRTOS task stacks.
+ * The pattern is the byte FreeRTOS fills a new task stack with (tskSTACK_FILL_BYTE 0xA5): after a
+ * probe the painted bytes look unused to uxTaskGetStackHighWaterMark, it reports the free stack
+ * as too large as long as the probe is used in the task.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_StackProbe_h
+#define EMV_StackProbe_h
+
+#include "Arduino.h"
+
+#define EMV_STACK_PROBE_DEPTH 4096   // bytes below the caller that get painted
+#define EMV_STACK_PROBE_MARGIN 128   // bytes below the caller that stay untouched (the frame of begin)
+#define EMV_STACK_PROBE_PATTERN 0xA5  // tskSTACK_FILL_BYTE of FreeRTOS
+
+class EMV_StackProbe {
+
+public:
+  void begin();
+  // the bytes of stack used below the caller since begin(), saturated() if the painted area was too small
+  uint16_t end();
+  bool saturated() { return isSaturated; }
+
+private:
+  volatile byte* start = NULL;  // the first painted byte below the caller, painted downwards
+  uint16_t depth = 0;
+  bool isSaturated = false;
+};
+
+#endif
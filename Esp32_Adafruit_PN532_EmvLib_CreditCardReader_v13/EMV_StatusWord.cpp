@@ -0,0 +1,43 @@
+#include "EMV_StatusWord.h"
+
+// the first matching rule wins, see ISO 7816-4 and EMV Book 3 for the status words
+static const EMV_SwRule SW_RULES[] = {
+  { 0x90, 0x00, 0xFF, EMV_SW_SUCCESS, "Success" },
+  { 0x61, 0x00, 0x00, EMV_SW_MORE_DATA, "More data available" },
+  { 0x6C, 0x00, 0x00, EMV_SW_WRONG_LE, "Wrong Le, exact length in SW2" },
+  { 0x67, 0x00, 0xFF, EMV_SW_WRONG_LENGTH, "Wrong length" },
+  { 0x62, 0x83, 0xFF, EMV_SW_WARNING, "Selected file invalidated" },
+  { 0x62, 0x00, 0x00, EMV_SW_WARNING, "Warning, state unchanged" },
+  { 0x63, 0x00, 0x00, EMV_SW_WARNING, "Warning, state changed" },
+  { 0x6A, 0x82, 0xFF, EMV_SW_NOT_FOUND, "File or application not found" },
+  { 0x6A, 0x83, 0xFF, EMV_SW_NOT_FOUND, "Record not found" },
+  { 0x6A, 0x81, 0xFF, EMV_SW_ERROR, "Function not supported" },
+  { 0x69, 0x84, 0xFF, EMV_SW_ERROR, "Referenced data invalidated" },
+  { 0x69, 0x85, 0xFF, EMV_SW_ERROR, "Conditions of use not satisfied" },
+  { 0x6D, 0x00, 0xFF, EMV_SW_ERROR, "Instruction not supported" },
+  { 0x6E, 0x00, 0xFF, EMV_SW_ERROR, "Class not supported" },
+  { 0x6F, 0x00, 0xFF, EMV_SW_ERROR, "No precise diagnosis" }
+};
+
+static const EMV_SwRule* findRule(byte sw1, byte sw2) {
+  for (uint8_t i = 0; i < sizeof(SW_RULES) / sizeof(SW_RULES[0]); i++) {
+    const EMV_SwRule* rule = &SW_RULES[i];
+    if (rule->sw1 == sw1 && (sw2 & rule->sw2Mask) == (rule->sw2 & rule->sw2Mask)) return rule;
+  }
+  return NULL;
+}
+
+EMV_SwClass EMV_ClassifyStatusWord(byte sw1, byte sw2) {
+  const EMV_SwRule* rule = findRule(sw1, sw2);
+  return (rule != NULL) ? rule->swClass : EMV_SW_ERROR;
+}
+
+EMV_SwClass EMV_ClassifyResponse(const byte* response, uint16_t responseLen) {
+  if (responseLen < 2) return EMV_SW_NONE;
+  return EMV_ClassifyStatusWord(response[responseLen - 2], response[responseLen - 1]);
+}
+
+const char* EMV_StatusWordText(byte sw1, byte sw2) {
+  const EMV_SwRule* rule = findRule(sw1, sw2);
+  return (rule != NULL) ? rule->text : "Unknown status word";
+}
@@ -0,0 +1,39 @@
+/**
+ * Status words (SW1 SW2) of EMV card responses.
+ * Every response of the card ends with a status word. EMV_ClassifyStatusWord looks the
+ * status word up in a table and returns its class, so all commands handle a status word
+ * in the same way (e.g. 61xx = more data available, 6Cxx = wrong Le, exact Le in SW2).
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_StatusWord_h
+#define EMV_StatusWord_h
+
+#include "Arduino.h"
+
+enum EMV_SwClass : byte {
+  EMV_SW_SUCCESS = 0,       // 90 00
+  EMV_SW_WARNING = 1,       // 62xx, 63xx - processed, the data may be usable
+  EMV_SW_MORE_DATA = 2,     // 61xx - xx bytes more are available with GET RESPONSE
+  EMV_SW_WRONG_LE = 3,      // 6Cxx - wrong Le, xx is the exact length
+  EMV_SW_WRONG_LENGTH = 4,  // 67 00 - wrong length, resend with another Le
+  EMV_SW_NOT_FOUND = 5,     // 6A82, 6A83 - application, file or record not found
+  EMV_SW_ERROR = 6,         // all other status words
+  EMV_SW_NONE = 7           // the response is too short for a status word
+};
+
+struct EMV_SwRule {
+  byte sw1;
+  byte sw2;
+  byte sw2Mask;             // 0x00 = any SW2, 0xFF = SW2 has to match
+  EMV_SwClass swClass;
+  const char* text;
+};
+
+EMV_SwClass EMV_ClassifyStatusWord(byte sw1, byte sw2);
+// the class of the status word at the end of a response
+EMV_SwClass EMV_ClassifyResponse(const byte* response, uint16_t responseLen);
+const char* EMV_StatusWordText(byte sw1, byte sw2);
+
+#endif
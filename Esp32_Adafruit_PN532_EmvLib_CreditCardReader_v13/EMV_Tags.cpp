@@ -0,0 +1,71 @@
+#include "EMV_Tags.h"
+#include "EMV_Tlv.h"
+
+// the definition is required for runtime access before C++17
+constexpr EMV_TagInfo EMV_TagDictionary::tags[];
+
+static_assert(EMV_TagIndexOf(EMV_TAG_AID) >= 0, "EMV_TAG_AID");
+static_assert(EMV_TagIndexOf(EMV_TAG_APPLICATION_LABEL) >= 0, "EMV_TAG_APPLICATION_LABEL");
+static_assert(EMV_TagIndexOf(EMV_TAG_TRACK2_EQUIVALENT_DATA) >= 0, "EMV_TAG_TRACK2_EQUIVALENT_DATA");
+static_assert(EMV_TagIndexOf(EMV_TAG_PAN) >= 0, "EMV_TAG_PAN");
+static_assert(EMV_TagIndexOf(EMV_TAG_EXPIRATION_DATE) >= 0, "EMV_TAG_EXPIRATION_DATE");
+static_assert(EMV_TagIndexOf(EMV_TAG_RESPONSE_FORMAT_1) >= 0, "EMV_TAG_RESPONSE_FORMAT_1");
+static_assert(EMV_TagIndexOf(EMV_TAG_AFL) >= 0, "EMV_TAG_AFL");
+static_assert(EMV_TagIndexOf(EMV_TAG_PDOL) >= 0, "EMV_TAG_PDOL");
+
+const EMV_TagInfo* EMV_TagLookup(uint32_t tag) {
+  int16_t index = EMV_TagIndexOf(tag);
+  return (index < 0) ? NULL : &EMV_TagDictionary::tags[index];
+}
+
+const char* EMV_TagName(uint32_t tag) {
+  const EMV_TagInfo* info = EMV_TagLookup(tag);
+  return (info == NULL) ? "Unknown tag" : info->name;
+}
+
+const char* EMV_TagFormatText(EMV_TagFormat format) {
+  switch (format) {
+    case EMV_TAG_FORMAT_B: return "b";
+    case EMV_TAG_FORMAT_N: return "n";
+    case EMV_TAG_FORMAT_CN: return "cn";
+    case EMV_TAG_FORMAT_AN: return "an";
+    case EMV_TAG_FORMAT_ANS: return "ans";
+  }
+  return "?";
+}
+
+bool EMV_TagLengthValid(uint32_t tag, uint16_t length) {
+  const EMV_TagInfo* info = EMV_TagLookup(tag);
+  if (info == NULL) return true;
+  return length >= info->minLength && length <= info->maxLength;
+}
+
+void EMV_PrintTlv(const byte* data, uint16_t len) {
+  EMV_TlvWalker walker(data, len);
+  EMV_Tlv tlv;
+  while (walker.next(&tlv)) {
+    const EMV_TagInfo* info = EMV_TagLookup(tlv.tag);
+    for (uint8_t i = 0; i < tlv.depth; i++) Serial.print("  ");
+    Serial.printf("%02X %s [%s %d]", (unsigned int)tlv.tag, (info == NULL) ? "Unknown tag" : info->name,
+                  (info == NULL) ? "?" : EMV_TagFormatText(info->format), tlv.length);
+    if (info != NULL && (tlv.length < info->minLength || tlv.length > info->maxLength)) {
+      Serial.print(" unexpected length");
+    }
+    if (tlv.isConstructed) {
+      Serial.println();
+      continue;
+    }
+    Serial.print(":");
+    for (uint16_t i = 0; i < tlv.length; i++) Serial.printf(" %02X", tlv.value[i]);
+    if (info != NULL && (info->format == EMV_TAG_FORMAT_AN || info->format == EMV_TAG_FORMAT_ANS)) {
+      Serial.print(" \"");
+      for (uint16_t i = 0; i < tlv.length; i++) {
+        char c = tlv.value[i];
+        Serial.print((c >= 0x20 && c < 0x7F) ? c : '.');
+      }
+      Serial.print("\"");
+    }
+    Serial.println();
+  }
+  if (walker.error()) Serial.println("Malformed TLV, the rest of the response is not printed");
+}
@@ -0,0 +1,173 @@
+/**
+ * A dictionary of the EMV tags used by contactless payment cards.
+ * The table is constexpr and sorted by tag, a lookup is a binary search that the compiler
+ * resolves at compile time when the tag is a constant (EMV_TAG_INFO). The table lives in
+ * flash, it needs no RAM on the ESP32.
+ * The formats follow EMV Book 3 Annex A:
+ * b = binary, n = BCD digits, cn = BCD digits padded with 'F', an = alphanumeric,
+ * ans = alphanumeric and special characters.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Tags_h
+#define EMV_Tags_h
+
+#include "Arduino.h"
+
+// the tags the library extracts from the card responses
+#define EMV_TAG_AID 0x4F
+#define EMV_TAG_APPLICATION_LABEL 0x50
+#define EMV_TAG_TRACK2_EQUIVALENT_DATA 0x57
+#define EMV_TAG_PAN 0x5A
+#define EMV_TAG_EXPIRATION_DATE 0x5F24
+#define EMV_TAG_RESPONSE_FORMAT_1 0x80
+#define EMV_TAG_AFL 0x94
+#define EMV_TAG_PDOL 0x9F38
+#define EMV_TAG_TRACK2_DATA 0x9F6B
+
+enum EMV_TagFormat : uint8_t {
+  EMV_TAG_FORMAT_B,
+  EMV_TAG_FORMAT_N,
+  EMV_TAG_FORMAT_CN,
+  EMV_TAG_FORMAT_AN,
+  EMV_TAG_FORMAT_ANS
+};
+
+struct EMV_TagInfo {
+  uint32_t tag;
+  const char* name;
+  EMV_TagFormat format;
+  uint8_t minLength;  // in bytes
+  uint8_t maxLength;
+};
+
+struct EMV_TagDictionary {
+  // sorted by tag, checked by a static_assert below
+  static constexpr EMV_TagInfo tags[] = {
+    { 0x42, "Issuer Identification Number", EMV_TAG_FORMAT_N, 3, 3 },
+    { 0x4F, "Application Identifier (AID)", EMV_TAG_FORMAT_B, 5, 16 },
+    { 0x50, "Application Label", EMV_TAG_FORMAT_ANS, 1, 16 },
+    { 0x56, "Track 1 Data", EMV_TAG_FORMAT_ANS, 0, 76 },
+    { 0x57, "Track 2 Equivalent Data", EMV_TAG_FORMAT_B, 0, 19 },
+    { 0x5A, "Application Primary Account Number (PAN)", EMV_TAG_FORMAT_CN, 0, 10 },
+    { 0x61, "Application Template", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x6F, "File Control Information (FCI) Template", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x70, "READ RECORD Response Message Template", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x77, "Response Message Template Format 2", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x80, "Response Message Template Format 1", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x82, "Application Interchange Profile", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x84, "Dedicated File (DF) Name", EMV_TAG_FORMAT_B, 5, 16 },
+    { 0x87, "Application Priority Indicator", EMV_TAG_FORMAT_B, 1, 1 },
+    { 0x88, "Short File Identifier (SFI)", EMV_TAG_FORMAT_B, 1, 1 },
+    { 0x8C, "Card Risk Management Data Object List 1 (CDOL1)", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x8D, "Card Risk Management Data Object List 2 (CDOL2)", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x8E, "Cardholder Verification Method (CVM) List", EMV_TAG_FORMAT_B, 10, 252 },
+    { 0x8F, "Certification Authority Public Key Index", EMV_TAG_FORMAT_B, 1, 1 },
+    { 0x90, "Issuer Public Key Certificate", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x92, "Issuer Public Key Remainder", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x93, "Signed Static Application Data", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x94, "Application File Locator (AFL)", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x95, "Terminal Verification Results", EMV_TAG_FORMAT_B, 5, 5 },
+    { 0x9A, "Transaction Date", EMV_TAG_FORMAT_N, 3, 3 },
+    { 0x9C, "Transaction Type", EMV_TAG_FORMAT_N, 1, 1 },
+    { 0xA5, "File Control Information (FCI) Proprietary Template", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x5F20, "Cardholder Name", EMV_TAG_FORMAT_ANS, 2, 26 },
+    { 0x5F24, "Application Expiration Date", EMV_TAG_FORMAT_N, 3, 3 },
+    { 0x5F25, "Application Effective Date", EMV_TAG_FORMAT_N, 3, 3 },
+    { 0x5F28, "Issuer Country Code", EMV_TAG_FORMAT_N, 2, 2 },
+    { 0x5F2A, "Transaction Currency Code", EMV_TAG_FORMAT_N, 2, 2 },
+    { 0x5F2D, "Language Preference", EMV_TAG_FORMAT_AN, 2, 8 },
+    { 0x5F30, "Service Code", EMV_TAG_FORMAT_N, 2, 2 },
+    { 0x5F34, "Application PAN Sequence Number", EMV_TAG_FORMAT_N, 1, 1 },
+    { 0x9F02, "Amount, Authorised (Numeric)", EMV_TAG_FORMAT_N, 6, 6 },
+    { 0x9F03, "Amount, Other (Numeric)", EMV_TAG_FORMAT_N, 6, 6 },
+    { 0x9F07, "Application Usage Control", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x9F08, "Application Version Number", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x9F0A, "Application Selection Registered Proprietary Data", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x9F0D, "Issuer Action Code - Default", EMV_TAG_FORMAT_B, 5, 5 },
+    { 0x9F0E, "Issuer Action Code - Denial", EMV_TAG_FORMAT_B, 5, 5 },
+    { 0x9F0F, "Issuer Action Code - Online", EMV_TAG_FORMAT_B, 5, 5 },
+    { 0x9F10, "Issuer Application Data", EMV_TAG_FORMAT_B, 0, 32 },
+    { 0x9F11, "Issuer Code Table Index", EMV_TAG_FORMAT_N, 1, 1 },
+    { 0x9F12, "Application Preferred Name", EMV_TAG_FORMAT_ANS, 1, 16 },
+    { 0x9F1A, "Terminal Country Code", EMV_TAG_FORMAT_N, 2, 2 },
+    { 0x9F1D, "Terminal Risk Management Data", EMV_TAG_FORMAT_B, 1, 8 },
+    { 0x9F21, "Transaction Time", EMV_TAG_FORMAT_N, 3, 3 },
+    { 0x9F24, "Payment Account Reference (PAR)", EMV_TAG_FORMAT_AN, 29, 29 },
+    { 0x9F26, "Application Cryptogram", EMV_TAG_FORMAT_B, 8, 8 },
+    { 0x9F27, "Cryptogram Information Data", EMV_TAG_FORMAT_B, 1, 1 },
+    { 0x9F32, "Issuer Public Key Exponent", EMV_TAG_FORMAT_B, 1, 3 },
+    { 0x9F33, "Terminal Capabilities", EMV_TAG_FORMAT_B, 3, 3 },
+    { 0x9F34, "Cardholder Verification Method (CVM) Results", EMV_TAG_FORMAT_B, 3, 3 },
+    { 0x9F35, "Terminal Type", EMV_TAG_FORMAT_N, 1, 1 },
+    { 0x9F36, "Application Transaction Counter (ATC)", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x9F37, "Unpredictable Number", EMV_TAG_FORMAT_B, 4, 4 },
+    { 0x9F38, "Processing Options Data Object List (PDOL)", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x9F40, "Additional Terminal Capabilities", EMV_TAG_FORMAT_B, 5, 5 },
+    { 0x9F42, "Application Currency Code", EMV_TAG_FORMAT_N, 2, 2 },
+    { 0x9F44, "Application Currency Exponent", EMV_TAG_FORMAT_N, 1, 1 },
+    { 0x9F45, "Data Authentication Code", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x9F46, "ICC Public Key Certificate", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x9F47, "ICC Public Key Exponent", EMV_TAG_FORMAT_B, 1, 3 },
+    { 0x9F48, "ICC Public Key Remainder", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x9F49, "Dynamic Data Authentication Data Object List (DDOL)", EMV_TAG_FORMAT_B, 0, 252 },
+    { 0x9F4A, "Static Data Authentication Tag List", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x9F4B, "Signed Dynamic Application Data", EMV_TAG_FORMAT_B, 0, 255 },
+    { 0x9F4C, "ICC Dynamic Number", EMV_TAG_FORMAT_B, 2, 8 },
+    { 0x9F4D, "Log Entry", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x9F4E, "Merchant Name and Location", EMV_TAG_FORMAT_ANS, 0, 255 },
+    { 0x9F5A, "Application Program Identifier", EMV_TAG_FORMAT_B, 1, 16 },
+    { 0x9F5D, "Available Offline Spending Amount", EMV_TAG_FORMAT_N, 6, 6 },
+    { 0x9F66, "Terminal Transaction Qualifiers (TTQ)", EMV_TAG_FORMAT_B, 4, 4 },
+    { 0x9F69, "Card Authentication Related Data", EMV_TAG_FORMAT_B, 5, 16 },
+    { 0x9F6B, "Track 2 Data", EMV_TAG_FORMAT_B, 0, 19 },
+    { 0x9F6C, "Card Transaction Qualifiers (CTQ)", EMV_TAG_FORMAT_B, 2, 2 },
+    { 0x9F6E, "Form Factor Indicator / Third Party Data", EMV_TAG_FORMAT_B, 4, 32 },
+    { 0x9F7C, "Customer Exclusive Data", EMV_TAG_FORMAT_B, 0, 32 },
+    { 0xBF0C, "File Control Information (FCI) Issuer Discretionary Data", EMV_TAG_FORMAT_B, 0, 222 },
+  };
+  static constexpr uint16_t count = sizeof(tags) / sizeof(tags[0]);
+};
+
+// binary search in [low, high], -1 if the tag is not in the dictionary
+constexpr int16_t EMV_TagSearch(uint32_t tag, int16_t low, int16_t high) {
+  return low > high ? -1
+         : EMV_TagDictionary::tags[(low + high) / 2].tag == tag ? (low + high) / 2
+         : EMV_TagDictionary::tags[(low + high) / 2].tag < tag ? EMV_TagSearch(tag, (low + high) / 2 + 1, high)
+                                                                : EMV_TagSearch(tag, low, (low + high) / 2 - 1);
+}
+
+// the index of the tag in the dictionary, -1 if it is unknown
+constexpr int16_t EMV_TagIndexOf(uint32_t tag) {
+  return EMV_TagSearch(tag, 0, EMV_TagDictionary::count - 1);
+}
+
+constexpr bool EMV_TagsSorted(uint16_t i = 1) {
+  return i >= EMV_TagDictionary::count ? true
+         : EMV_TagDictionary::tags[i - 1].tag < EMV_TagDictionary::tags[i].tag && EMV_TagsSorted(i + 1);
+}
+
+static_assert(EMV_TagsSorted(), "EMV_TagDictionary::tags has to be sorted by tag");
+
+// resolves a constant tag at compile time, an unknown tag does not compile
+template<uint32_t TAG>
+struct EMV_KnownTag {
+  static constexpr int16_t index = EMV_TagIndexOf(TAG);
+  static_assert(index >= 0, "the tag is not in EMV_TagDictionary");
+};
+
+#define EMV_TAG_INFO(tag) (EMV_TagDictionary::tags[EMV_KnownTag<tag>::index])
+
+// runtime lookup, NULL if the tag is unknown
+const EMV_TagInfo* EMV_TagLookup(uint32_t tag);
+// the name of the tag or "Unknown tag"
+const char* EMV_TagName(uint32_t tag);
+// "b", "n", "cn", "an" or "ans"
+const char* EMV_TagFormatText(EMV_TagFormat format);
+// true if the length fits the dictionary, unknown tags are always valid
+bool EMV_TagLengthValid(uint32_t tag, uint16_t length);
+// prints all TLVs of a response with indentation, name, format and value
+void EMV_PrintTlv(const byte* data, uint16_t len);
+
+#endif
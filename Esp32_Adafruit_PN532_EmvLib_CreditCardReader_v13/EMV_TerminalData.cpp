@@ -0,0 +1,143 @@
+#include "EMV_TerminalData.h"
+#include "EMV_Tlv.h"
+#include "EMV_Tags.h"
+#include "EMV_Log.h"
+
+// the default values, sorted by tag
+static constexpr EMV_TerminalDataEntry EMV_TERMINAL_DATA_DEFAULTS[] = {
+  { 0x95, 5, { 0x00, 0x00, 0x00, 0x00, 0x00 } },                                 // Terminal Verification Results
+  { 0x9A, 3, { 0x25, 0x03, 0x01 } },                                             // Transaction Date 2025-03-01
+  { 0x9C, 1, { 0x00 } },                                                         // Transaction Type purchase
+  { 0x5F2A, 2, { 0x09, 0x78 } },                                                 // Transaction Currency Code EUR
+  { 0x9F02, 6, { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00 } },                         // Amount, Authorised 10.00
+  { 0x9F03, 6, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },                         // Amount, Other
+  { 0x9F1A, 2, { 0x09, 0x78 } },                                                 // Terminal Country Code
+  { 0x9F21, 3, { 0x11, 0x10, 0x09 } },                                           // Transaction Time 11:10:09
+  { 0x9F34, 3, { 0x00, 0x00, 0x00 } },                                           // CVM Results
+  { 0x9F35, 1, { 0x22 } },                                                       // Terminal Type
+  { 0x9F37, 4, { 0x38, 0x39, 0x30, 0x31 } },                                     // Unpredictable Number
+  { 0x9F45, 2, { 0x00, 0x00 } },                                                 // Data Authentication Code
+  { 0x9F4C, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },             // ICC Dynamic Number
+  { 0x9F66, 4, { 0x27, 0x00, 0x00, 0x00 } },                                     // Terminal Transaction Qualifiers
+  { 0x9F7C, 14, { 0x00 } },                                                      // Customer Exclusive Data
+};
+
+static constexpr bool defaultsSorted(uint8_t i = 1) {
+  return i >= sizeof(EMV_TERMINAL_DATA_DEFAULTS) / sizeof(EMV_TERMINAL_DATA_DEFAULTS[0]) ? true
+         : EMV_TERMINAL_DATA_DEFAULTS[i - 1].tag < EMV_TERMINAL_DATA_DEFAULTS[i].tag && defaultsSorted(i + 1);
+}
+
+static_assert(defaultsSorted(), "EMV_TERMINAL_DATA_DEFAULTS has to be sorted by tag");
+static_assert(sizeof(EMV_TERMINAL_DATA_DEFAULTS) / sizeof(EMV_TERMINAL_DATA_DEFAULTS[0]) <= EMV_TERMINAL_DATA_SIZE, "EMV_TERMINAL_DATA_SIZE");
+
+EMV_TerminalData::EMV_TerminalData() {
+  numberOfEntries = sizeof(EMV_TERMINAL_DATA_DEFAULTS) / sizeof(EMV_TERMINAL_DATA_DEFAULTS[0]);
+  memcpy(entries, EMV_TERMINAL_DATA_DEFAULTS, sizeof(EMV_TERMINAL_DATA_DEFAULTS));
+}
+
+// the index of the tag or the position where it has to be inserted
+static uint8_t lowerBound(const EMV_TerminalDataEntry* entries, uint8_t numberOfEntries, uint32_t tag) {
+  uint8_t low = 0;
+  uint8_t high = numberOfEntries;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    if (entries[middle].tag < tag) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool EMV_TerminalData::set(uint32_t tag, const byte* value, uint8_t length) {
+  if (length > EMV_TERMINAL_DATA_MAX_LENGTH) return false;
+  uint8_t index = lowerBound(entries, numberOfEntries, tag);
+  if (index == numberOfEntries || entries[index].tag != tag) {
+    if (numberOfEntries == EMV_TERMINAL_DATA_SIZE) return false;
+    memmove(&entries[index + 1], &entries[index], (numberOfEntries - index) * sizeof(EMV_TerminalDataEntry));
+    numberOfEntries++;
+    entries[index].tag = tag;
+    version++;
+  } else if (entries[index].length != length) {
+    version++;
+  }
+  entries[index].length = length;
+  memcpy(entries[index].value, value, length);
+  return true;
+}
+
+const EMV_TerminalDataEntry* EMV_TerminalData::find(uint32_t tag) {
+  uint8_t index = lowerBound(entries, numberOfEntries, tag);
+  if (index == numberOfEntries || entries[index].tag != tag) return NULL;
+  return &entries[index];
+}
+
+bool EMV_TerminalData::fill(uint32_t tag, byte* output, uint8_t length) {
+  EMV_DolStep steps[2];
+  uint8_t count = fillSteps(tag, 0, length, steps);
+  EMV_DolRunSteps(steps, count, image(), output);
+  return find(tag) != NULL;
+}
+
+uint8_t EMV_TerminalData::fillSteps(uint32_t tag, uint16_t destination, uint8_t length, EMV_DolStep* steps) {
+  const EMV_TerminalDataEntry* entry = find(tag);
+  if (entry == NULL) {
+    steps[0] = { EMV_DOL_STEP_ZERO, destination, length };
+    return 1;
+  }
+  const EMV_TagInfo* info = EMV_TagLookup(tag);
+  EMV_TagFormat format = (info == NULL) ? EMV_TAG_FORMAT_B : info->format;
+  uint8_t copyLen = (entry->length < length) ? entry->length : length;
+  uint8_t padLen = length - copyLen;
+  uint16_t valueOffset = entry->value - image();
+  uint8_t count = 0;
+  if (format == EMV_TAG_FORMAT_N) {
+    // right aligned: leading zeros, or the rightmost bytes of the value
+    if (padLen > 0) steps[count++] = { EMV_DOL_STEP_ZERO, destination, padLen };
+    if (copyLen > 0) steps[count++] = { (uint16_t)(valueOffset + entry->length - copyLen), (uint16_t)(destination + padLen), copyLen };
+  } else {
+    // left aligned: trailing padding, or the leftmost bytes of the value
+    if (copyLen > 0) steps[count++] = { valueOffset, destination, copyLen };
+    if (padLen > 0) steps[count++] = { (uint16_t)((format == EMV_TAG_FORMAT_CN) ? EMV_DOL_STEP_FF : EMV_DOL_STEP_ZERO), (uint16_t)(destination + copyLen), padLen };
+  }
+  return count;
+}
+
+void EMV_DolRunSteps(const EMV_DolStep* steps, uint8_t count, const byte* source, byte* output) {
+  for (uint8_t i = 0; i < count; i++) {
+    const EMV_DolStep& step = steps[i];
+    if (step.source < EMV_DOL_STEP_FF) {
+      memcpy(output + step.destination, source + step.source, step.length);
+    } else {
+      memset(output + step.destination, (step.source == EMV_DOL_STEP_FF) ? 0xFF : 0x00, step.length);
+    }
+  }
+}
+
+bool EMV_DolBuild(const byte* dol, uint16_t dolLen, EMV_TerminalData* terminalData, byte* output, uint16_t capacity, uint16_t* outputLen, bool debugPrint) {
+  uint16_t position = 0;
+  uint16_t written = 0;
+  *outputLen = 0;
+  while (position < dolLen) {
+    // a DOL entry is a tag and a length, without a value
+    uint32_t tag;
+    uint16_t length;
+    uint8_t tagLen = EMV_TlvParseTag(dol + position, dolLen - position, &tag);
+    if (tagLen == 0) return false;
+    position += tagLen;
+    uint8_t lengthLen = EMV_TlvParseLength(dol + position, dolLen - position, &length);
+    if (lengthLen == 0) return false;
+    position += lengthLen;
+    if (length > capacity - written || length > 255) return false;
+    bool isKnown = terminalData->fill(tag, output + written, length);
+    if (EMV_LOG_ON(EMV_LOG_LEVEL_DEBUG, EMV_LOG_PDOL, debugPrint)) {
+      Serial.printf("DOL %02X %s length %2d%s:", (unsigned int)tag, EMV_TagName(tag), length, isKnown ? "" : " (no terminal data)");
+      for (uint16_t i = 0; i < length; i++) Serial.printf(" %02X", output[written + i]);
+      Serial.println();
+    }
+    written += length;
+  }
+  *outputLen = written;
+  return true;
+}
@@ -0,0 +1,74 @@
+/**
+ * The terminal data that a card can request with a Data Object List (DOL), e.g. the PDOL
+ * for the GET PROCESSING OPTIONS command.
+ * The values are kept in a table sorted by the full BER tag, a lookup is a binary search.
+ * EMV_DolBuild parses the DOL with the BER tag rules (EMV_TlvParseTag) and writes each value
+ * in exactly the length the card requested, padded or truncated by the format of the tag
+ * (EMV Book 3 section 5.4):
+ * n:  leading zeros / the leftmost bytes are dropped
+ * cn: trailing 'FF' / the rightmost bytes are dropped
+ * b, an, ans: trailing zeros / the rightmost bytes are dropped
+ * A tag that is not in the table is filled with zeros.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_TerminalData_h
+#define EMV_TerminalData_h
+
+#include "Arduino.h"
+
+#define EMV_TERMINAL_DATA_SIZE 24        // number of tags in the table
+#define EMV_TERMINAL_DATA_MAX_LENGTH 16  // bytes per value
+
+// one step of a DOL fill: copies length bytes from the terminal data image to the output,
+// or pads them with 00 / FF
+#define EMV_DOL_STEP_ZERO 0xFFFF  // source of a step that writes 00 bytes
+#define EMV_DOL_STEP_FF 0xFFFE    // source of a step that writes FF bytes
+
+struct EMV_DolStep {
+  uint16_t source;       // offset in EMV_TerminalData::image() or EMV_DOL_STEP_ZERO/FF
+  uint16_t destination;  // offset in the output
+  uint8_t length;
+};
+
+struct EMV_TerminalDataEntry {
+  uint32_t tag;
+  uint8_t length;
+  byte value[EMV_TERMINAL_DATA_MAX_LENGTH];
+};
+
+class EMV_TerminalData {
+
+public:
+  // the table starts with the default values of the library (Terminal Country Code 0978 etc.)
+  EMV_TerminalData();
+  // adds or replaces a value, false if the value is too long or the table is full
+  bool set(uint32_t tag, const byte* value, uint8_t length);
+  // NULL if the tag is not in the table
+  const EMV_TerminalDataEntry* find(uint32_t tag);
+  // writes the value of the tag in exactly length bytes, false if the tag is not in the table
+  // (the output is zeroed then)
+  bool fill(uint32_t tag, byte* output, uint8_t length);
+  // the 1 or 2 steps that write the value of the tag in exactly length bytes at destination
+  uint8_t fillSteps(uint32_t tag, uint16_t destination, uint8_t length, EMV_DolStep* steps);
+  uint8_t size() { return numberOfEntries; }
+  // the table as raw bytes, the source of the steps
+  const byte* image() { return (const byte*)entries; }
+  // changes when a tag is added or a value changes its length, the steps are invalid then
+  uint16_t layoutVersion() { return version; }
+
+private:
+  EMV_TerminalDataEntry entries[EMV_TERMINAL_DATA_SIZE];
+  uint8_t numberOfEntries = 0;
+  uint16_t version = 0;
+};
+
+// executes the steps, source is EMV_TerminalData::image()
+void EMV_DolRunSteps(const EMV_DolStep* steps, uint8_t count, const byte* source, byte* output);
+
+// builds the data for a DOL (the concatenated values, without tag 83), false on a malformed
+// DOL or if the data does not fit into capacity. With debugPrint each DOL entry is printed.
+bool EMV_DolBuild(const byte* dol, uint16_t dolLen, EMV_TerminalData* terminalData, byte* output, uint16_t capacity, uint16_t* outputLen, bool debugPrint = false);
+
+#endif
@@ -0,0 +1,163 @@
+#include "EMV_Tlv.h"
+
+uint8_t EMV_TlvParseTag(const byte* data, uint16_t len, uint32_t* tag) {
+  if (len == 0) return 0;
+  uint32_t value = data[0];
+  uint8_t tagLen = 1;
+  if ((data[0] & 0x1F) == 0x1F) {
+    // subsequent tag bytes follow as long as bit 8 is set
+    byte b;
+    do {
+      if (tagLen >= len || tagLen >= 3) return 0;
+      b = data[tagLen++];
+      value = (value << 8) | b;
+    } while (b & 0x80);
+  }
+  *tag = value;
+  return tagLen;
+}
+
+uint8_t EMV_TlvParseLength(const byte* data, uint16_t len, uint16_t* length) {
+  if (len == 0) return 0;
+  byte b = data[0];
+  if (b < 0x80) {
+    *length = b;
+    return 1;
+  }
+  if (b == 0x81 && len >= 2) {
+    *length = data[1];
+    return 2;
+  }
+  if (b == 0x82 && len >= 3) {
+    *length = (data[1] << 8) | data[2];
+    return 3;
+  }
+  // indefinite length (0x80) and longer length fields are not used by EMV
+  return 0;
+}
+
+// parses the TLV at position, the value has to end before end
+static bool parseTlv(const byte* position, const byte* end, EMV_Tlv* tlv) {
+  uint16_t available = end - position;
+  uint8_t tagLen = EMV_TlvParseTag(position, available, &tlv->tag);
+  if (tagLen == 0) return false;
+  uint8_t lengthLen = EMV_TlvParseLength(position + tagLen, available - tagLen, &tlv->length);
+  if (lengthLen == 0) return false;
+  tlv->headerLen = tagLen + lengthLen;
+  if (tlv->length > available - tlv->headerLen) return false;  // value exceeds the buffer
+  tlv->start = position;
+  tlv->value = position + tlv->headerLen;
+  tlv->isConstructed = (position[0] & 0x20) != 0;
+  return true;
+}
+
+// 00 and FF bytes may be used as padding between TLVs
+static const byte* skipPadding(const byte* position, const byte* end) {
+  while (position < end && (*position == 0x00 || *position == 0xFF)) position++;
+  return position;
+}
+
+EMV_TlvReader::EMV_TlvReader(const byte* data, uint16_t len) {
+  position = data;
+  end = data + len;
+}
+
+bool EMV_TlvReader::next(EMV_Tlv* tlv) {
+  if (isError) return false;
+  position = skipPadding(position, end);
+  if (position >= end) return false;
+  if (!parseTlv(position, end, tlv)) {
+    isError = true;
+    return false;
+  }
+  tlv->depth = 0;
+  position = tlv->value + tlv->length;
+  return true;
+}
+
+EMV_TlvWalker::EMV_TlvWalker(const byte* data, uint16_t len) {
+  position = data;
+  ends[0] = data + len;
+}
+
+bool EMV_TlvWalker::next(EMV_Tlv* tlv) {
+  if (isError) return false;
+  while (true) {
+    position = skipPadding(position, ends[depth]);
+    if (position < ends[depth]) break;
+    if (depth == 0) return false;
+    depth--;  // the constructed TLV is complete
+  }
+  if (!parseTlv(position, ends[depth], tlv)) {
+    isError = true;
+    return false;
+  }
+  tlv->depth = depth;
+  if (tlv->isConstructed && depth + 1 < EMV_TLV_MAX_DEPTH) {
+    // continue with the children
+    depth++;
+    ends[depth] = tlv->value + tlv->length;
+    position = tlv->value;
+  } else {
+    position = tlv->value + tlv->length;
+  }
+  return true;
+}
+
+bool EMV_TlvFind(const byte* data, uint16_t len, uint32_t tag, EMV_Tlv* tlv) {
+  EMV_TlvWalker walker(data, len);
+  while (walker.next(tlv)) {
+    if (tlv->tag == tag) return true;
+  }
+  return false;
+}
+
+EMV_TagIndex::EMV_TagIndex(const uint32_t* wantedTags, uint8_t numberOfWantedTags) {
+  this->wantedTags = wantedTags;
+  this->numberOfWantedTags = numberOfWantedTags;
+}
+
+bool EMV_TagIndex::build(const byte* data, uint16_t len) {
+  this->data = data;
+  numberOfEntries = 0;
+  isOverflow = false;
+  EMV_TlvWalker walker(data, len);
+  EMV_Tlv tlv;
+  while (walker.next(&tlv)) {
+    for (uint8_t i = 0; i < numberOfWantedTags; i++) {
+      if (tlv.tag != wantedTags[i]) continue;
+      if (numberOfEntries < EMV_TAG_INDEX_SIZE) {
+        entries[numberOfEntries].tag = tlv.tag;
+        entries[numberOfEntries].offset = tlv.value - data;
+        entries[numberOfEntries].length = tlv.length;
+        numberOfEntries++;
+      } else {
+        isOverflow = true;
+      }
+      break;
+    }
+  }
+  return !walker.error();
+}
+
+const byte* EMV_TagIndex::find(uint32_t tag, uint16_t* length, uint8_t occurrence) {
+  for (uint8_t i = 0; i < numberOfEntries; i++) {
+    if (entries[i].tag != tag) continue;
+    if (occurrence > 0) {
+      occurrence--;
+      continue;
+    }
+    *length = entries[i].length;
+    return data + entries[i].offset;
+  }
+  *length = 0;
+  return NULL;
+}
+
+uint8_t EMV_TagIndex::count(uint32_t tag) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < numberOfEntries; i++) {
+    if (entries[i].tag == tag) n++;
+  }
+  return n;
+}
@@ -0,0 +1,101 @@
+/**
+ * A non-allocating BER-TLV parser for EMV responses.
+ * The parser works in place on the receive buffer: an EMV_Tlv holds the tag, the length and
+ * pointers to the value inside the buffer, nothing gets copied. It never reads beyond
+ * [data, data + len), a malformed or truncated TLV stops the parser and sets the error flag.
+ * EMV_TlvReader returns the TLVs of one level, EMV_TlvWalker returns all TLVs depth first
+ * (a constructed TLV before its children).
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Tlv_h
+#define EMV_Tlv_h
+
+#include "Arduino.h"
+
+#define EMV_TLV_MAX_DEPTH 8  // nesting depth of constructed TLVs, EMV uses up to 4 (6F/A5/BF0C/61)
+
+struct EMV_Tlv {
+  uint32_t tag;        // up to 3 tag bytes, e.g. 0x5F24
+  uint16_t length;     // length of the value
+  const byte* value;   // points into the parsed buffer
+  const byte* start;   // first byte of the tag
+  uint8_t headerLen;   // tag + length bytes
+  uint8_t depth;       // 0 = top level
+  bool isConstructed;  // the value holds further TLVs
+};
+
+// parses a tag, returns the number of tag bytes or 0 if the tag is malformed/truncated
+uint8_t EMV_TlvParseTag(const byte* data, uint16_t len, uint32_t* tag);
+// parses a length field (1, 0x81 xx or 0x82 xx xx), returns the number of bytes or 0 on error
+uint8_t EMV_TlvParseLength(const byte* data, uint16_t len, uint16_t* length);
+
+class EMV_TlvReader {
+
+public:
+  EMV_TlvReader(const byte* data, uint16_t len);
+  // the next TLV on this level, false at the end or on a malformed TLV
+  bool next(EMV_Tlv* tlv);
+  bool error() { return isError; }
+
+private:
+  const byte* position;
+  const byte* end;
+  bool isError = false;
+};
+
+class EMV_TlvWalker {
+
+public:
+  EMV_TlvWalker(const byte* data, uint16_t len);
+  // the next TLV depth first, false at the end or on a malformed TLV
+  bool next(EMV_Tlv* tlv);
+  bool error() { return isError; }
+
+private:
+  const byte* position;
+  const byte* ends[EMV_TLV_MAX_DEPTH];
+  uint8_t depth = 0;
+  bool isError = false;
+};
+
+// searches the first TLV with this tag (depth first), returns false if it is not found
+bool EMV_TlvFind(const byte* data, uint16_t len, uint32_t tag, EMV_Tlv* tlv);
+
+/////////////////////////////////////////////////////////////////////
+// Tag index: one walk over a response collects all wanted tags
+
+#define EMV_TAG_INDEX_SIZE 16  // found TLVs per response, e.g. one 4F per AID in the PPSE response
+
+struct EMV_TagIndexEntry {
+  uint32_t tag;
+  uint16_t offset;  // offset of the value in the indexed response
+  uint16_t length;  // length of the value
+};
+
+class EMV_TagIndex {
+
+public:
+  // wantedTags has to stay valid as long as the index is in use
+  EMV_TagIndex(const uint32_t* wantedTags, uint8_t numberOfWantedTags);
+  // walks the response once and stores every TLV with a wanted tag, false on a malformed response
+  // (the TLVs found before the error are kept)
+  bool build(const byte* data, uint16_t len);
+  // the value of the n-th TLV with this tag, NULL if there is none
+  const byte* find(uint32_t tag, uint16_t* length, uint8_t occurrence = 0);
+  // the number of TLVs found with this tag
+  uint8_t count(uint32_t tag);
+  // more wanted TLVs were found than fit into the index
+  bool overflow() { return isOverflow; }
+
+private:
+  const uint32_t* wantedTags;
+  uint8_t numberOfWantedTags;
+  const byte* data = NULL;
+  EMV_TagIndexEntry entries[EMV_TAG_INDEX_SIZE];
+  uint8_t numberOfEntries = 0;
+  bool isOverflow = false;
+};
+
+#endif
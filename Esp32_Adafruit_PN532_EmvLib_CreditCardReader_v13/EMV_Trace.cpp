@@ -0,0 +1,352 @@
+#include "EMV_Trace.h"
+
+#ifndef ARDUINO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void putU16(byte* p, uint16_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+}
+
+static void putU32(byte* p, uint32_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+static uint16_t getU16(const byte* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const byte* p) {
+  return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_TraceWriter
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+void EMV_TraceWriter::begin(byte* buffer, uint32_t bufferSize) {
+  this->buffer = buffer;
+  this->bufferSize = bufferSize;
+  used = 0;
+  sessions = 0;
+  sessionOffset = 0;
+  sessionExchanges = 0;
+  isOverflow = bufferSize < EMV_TRACE_FILE_HEADER_LEN;
+  if (isOverflow) return;
+  memset(buffer, 0, EMV_TRACE_FILE_HEADER_LEN);
+  buffer[0] = 'E';
+  buffer[1] = 'M';
+  buffer[2] = 'V';
+  buffer[3] = 'T';
+  buffer[4] = EMV_TRACE_VERSION;
+  used = EMV_TRACE_FILE_HEADER_LEN;
+}
+
+bool EMV_TraceWriter::beginSession() {
+  if (sessionOffset != 0) endSession();
+  if (isOverflow || used + EMV_TRACE_SESSION_HEADER_LEN > bufferSize) {
+    isOverflow = true;
+    return false;
+  }
+  sessionOffset = used;
+  sessionExchanges = 0;
+  memset(&buffer[used], 0, EMV_TRACE_SESSION_HEADER_LEN);
+  used += EMV_TRACE_SESSION_HEADER_LEN;
+  return true;
+}
+
+bool EMV_TraceWriter::addExchange(uint32_t timestamp, const byte* sendData, uint16_t sendLen, const byte* recvData, uint16_t recvLen, byte flags) {
+  if (sessionOffset == 0 && !beginSession()) return false;
+  uint32_t recordLen = EMV_TRACE_EXCHANGE_HEADER_LEN + sendLen + recvLen;
+  if (isOverflow || used + recordLen > bufferSize || sessionExchanges == 0xFFFF) {
+    isOverflow = true;
+    return false;
+  }
+  byte* p = &buffer[used];
+  putU32(p, timestamp);
+  putU16(p + 4, sendLen);
+  putU16(p + 6, recvLen);
+  p[8] = flags;
+  p[9] = 0;
+  memcpy(p + EMV_TRACE_EXCHANGE_HEADER_LEN, sendData, sendLen);
+  memcpy(p + EMV_TRACE_EXCHANGE_HEADER_LEN + sendLen, recvData, recvLen);
+  used += recordLen;
+  sessionExchanges++;
+  return true;
+}
+
+void EMV_TraceWriter::endSession() {
+  if (sessionOffset == 0) return;
+  putU16(&buffer[sessionOffset], sessionExchanges);
+  putU32(&buffer[sessionOffset + 4], used - sessionOffset - EMV_TRACE_SESSION_HEADER_LEN);
+  sessions++;
+  sessionOffset = 0;
+}
+
+bool EMV_TraceWriter::finish() {
+  endSession();
+  if (buffer == NULL || used + sessions * 4 > bufferSize) {
+    isOverflow = true;
+    return false;
+  }
+  // the sessions are walked once to build the index
+  uint32_t indexOffset = used;
+  uint32_t offset = EMV_TRACE_FILE_HEADER_LEN;
+  for (uint32_t i = 0; i < sessions; i++) {
+    putU32(&buffer[used], offset);
+    used += 4;
+    offset += EMV_TRACE_SESSION_HEADER_LEN + getU32(&buffer[offset + 4]);
+  }
+  putU32(&buffer[8], sessions);
+  putU32(&buffer[12], indexOffset);
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_TraceReader
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+bool EMV_TraceReader::begin(const byte* data, uint32_t size) {
+  this->data = data;
+  this->size = size;
+  sessions = 0;
+  position = 0;
+  sessionEnd = 0;
+  if (data == NULL || size < EMV_TRACE_FILE_HEADER_LEN) return false;
+  if (data[0] != 'E' || data[1] != 'M' || data[2] != 'V' || data[3] != 'T') return false;
+  if (data[4] != EMV_TRACE_VERSION) return false;
+  uint32_t count = getU32(&data[8]);
+  indexOffset = getU32(&data[12]);
+  if (indexOffset < EMV_TRACE_FILE_HEADER_LEN || indexOffset > size || (size - indexOffset) / 4 < count) return false;
+  sessions = count;
+  return true;
+}
+
+uint32_t EMV_TraceReader::sessionHeaderOffset(uint32_t session) {
+  if (session >= sessions) return 0;
+  uint32_t offset = getU32(&data[indexOffset + session * 4]);
+  if (offset < EMV_TRACE_FILE_HEADER_LEN || offset + EMV_TRACE_SESSION_HEADER_LEN > indexOffset) return 0;
+  return offset;
+}
+
+uint16_t EMV_TraceReader::exchangeCount(uint32_t session) {
+  uint32_t offset = sessionHeaderOffset(session);
+  if (offset == 0) return 0;
+  return getU16(&data[offset]);
+}
+
+bool EMV_TraceReader::openSession(uint32_t session) {
+  uint32_t offset = sessionHeaderOffset(session);
+  if (offset == 0) return false;
+  uint32_t length = getU32(&data[offset + 4]);
+  position = offset + EMV_TRACE_SESSION_HEADER_LEN;
+  if (length > indexOffset - position) return false;
+  sessionEnd = position + length;
+  return true;
+}
+
+bool EMV_TraceReader::nextExchange(EMV_TraceExchange* exchange) {
+  if (position + EMV_TRACE_EXCHANGE_HEADER_LEN > sessionEnd) return false;
+  const byte* p = &data[position];
+  uint16_t sendLen = getU16(p + 4);
+  uint16_t recvLen = getU16(p + 6);
+  uint32_t recordLen = EMV_TRACE_EXCHANGE_HEADER_LEN + sendLen + recvLen;
+  if (recordLen > sessionEnd - position) return false;  // corrupted trace
+  exchange->timestamp = getU32(p);
+  exchange->sendLen = sendLen;
+  exchange->recvLen = recvLen;
+  exchange->flags = p[8];
+  exchange->sendData = p + EMV_TRACE_EXCHANGE_HEADER_LEN;
+  exchange->recvData = p + EMV_TRACE_EXCHANGE_HEADER_LEN + sendLen;
+  position += recordLen;
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_TraceRecorder
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+EMV_TraceRecorder::EMV_TraceRecorder(EMV_Transport* transport, EMV_TraceWriter* writer) {
+  this->transport = transport;
+  this->writer = writer;
+}
+
+void EMV_TraceRecorder::beginSession() {
+  writer->beginSession();
+  sessionStart = micros();
+}
+
+void EMV_TraceRecorder::endSession() {
+  writer->endSession();
+}
+
+EMV_TransceiveStatus EMV_TraceRecorder::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  uint32_t timestamp = micros() - sessionStart;
+  EMV_TransceiveStatus status = transport->exchange(sendData, sendLen, backData, backSize, backLen);
+  bool success = status == EMV_TRANSCEIVE_OK;
+  writer->addExchange(timestamp, sendData, sendLen, backData, success ? *backLen : 0, success ? EMV_TRACE_FLAG_SUCCESS : 0);
+  return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// EMV_ReplayTransport
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+EMV_ReplayTransport::EMV_ReplayTransport(EMV_TraceReader* reader) {
+  this->reader = reader;
+}
+
+bool EMV_ReplayTransport::selectSession(uint32_t session) {
+  this->session = session;
+  if (!reader->openSession(session)) return false;
+  position = reader->tell();
+  return true;
+}
+
+EMV_TransceiveStatus EMV_ReplayTransport::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  EMV_TraceExchange recorded;
+  *backLen = 0;
+  reader->seek(position);
+  while (reader->nextExchange(&recorded)) {
+    if (recorded.sendLen != sendLen || memcmp(recorded.sendData, sendData, sendLen) != 0) continue;
+    position = reader->tell();
+    if (!(recorded.flags & EMV_TRACE_FLAG_SUCCESS)) return EMV_TRANSCEIVE_ERROR;
+    uint16_t len = recorded.recvLen;
+    if (len > backSize) len = backSize;
+    memcpy(backData, recorded.recvData, len);
+    *backLen = len;
+    return (len < recorded.recvLen) ? EMV_TRANSCEIVE_TOO_LONG : EMV_TRANSCEIVE_OK;
+  }
+  // the recorded card never saw this command
+  mismatchCount++;
+  return EMV_TRANSCEIVE_ERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// Import of the text log format
+//
+/////////////////////////////////////////////////////////////////////////////////////
+
+// parses the hex bytes of one line (" 00 A4 04 00"), returns the number of bytes on the line,
+// the first maxLen are stored
+static uint16_t parseHexLine(const char** text, byte* out, uint16_t maxLen) {
+  const char* p = *text;
+  uint16_t len = 0;
+  int high = -1;
+  while (*p != 0 && *p != '\n') {
+    char c = *p++;
+    int value = -1;
+    if (c >= '0' && c <= '9') value = c - '0';
+    else if (c >= 'a' && c <= 'f') value = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') value = c - 'A' + 10;
+    if (value < 0) {
+      high = -1;
+      continue;
+    }
+    if (high < 0) {
+      high = value;
+    } else {
+      if (len < maxLen) out[len] = (high << 4) | value;
+      if (len < 0xFFFF) len++;
+      high = -1;
+    }
+  }
+  if (*p == '\n') p++;
+  *text = p;
+  return len;
+}
+
+static bool startsWith(const char* text, const char* prefix) {
+  return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+// the line "Send length 20" at text: skips the line, the hex line that follows is parsed into out,
+// true if it has the logged number of bytes and they fit into out
+static bool parseLoggedData(const char** text, byte* out, uint16_t maxLen, uint16_t* len) {
+  const char* p = *text + strlen("Send length");  // as long as "Recv length"
+  while (*p == ' ') p++;
+  bool hasLength = *p >= '0' && *p <= '9';
+  uint32_t loggedLen = 0;
+  while (*p >= '0' && *p <= '9') {
+    if (loggedLen <= 0xFFFF) loggedLen = loggedLen * 10 + (*p - '0');
+    p++;
+  }
+  while (*p != 0 && *p != '\n') p++;
+  if (*p == '\n') p++;
+  *len = parseHexLine(&p, out, maxLen);
+  *text = p;
+  return hasLength && *len == loggedLen && *len <= maxLen;
+}
+
+uint32_t EMV_ImportTextLog(const char* text, EMV_TraceWriter* writer, uint32_t* rejected) {
+  byte sendData[256];
+  byte recvData[EMV_MAX_RESPONSE];
+  uint16_t sendLen = 0;
+  bool haveSend = false;
+  uint32_t exchanges = 0;
+  uint32_t rejectedExchanges = 0;
+  const char* p = text;
+  while (*p != 0) {
+    while (*p == ' ' || *p == '\r') p++;
+    if (startsWith(p, "Found a card!")) {
+      writer->beginSession();
+      haveSend = false;
+    } else if (startsWith(p, "Send length")) {
+      haveSend = parseLoggedData(&p, sendData, sizeof(sendData), &sendLen);
+      if (!haveSend) rejectedExchanges++;
+      continue;
+    } else if (startsWith(p, "Recv length") && haveSend) {
+      uint16_t recvLen;
+      // the log has no timestamps
+      if (!parseLoggedData(&p, recvData, sizeof(recvData), &recvLen)) {
+        rejectedExchanges++;
+      } else if (writer->addExchange(0, sendData, sendLen, recvData, recvLen, EMV_TRACE_FLAG_SUCCESS)) {
+        exchanges++;
+      }
+      haveSend = false;
+      continue;
+    }
+    while (*p != 0 && *p != '\n') p++;
+    if (*p == '\n') p++;
+  }
+  writer->endSession();
+  if (rejected != NULL) *rejected = rejectedExchanges;
+  return exchanges;
+}
+
+#ifndef ARDUINO
+const byte* EMV_MapTraceFile(const char* fileName, uint32_t* size) {
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > 0xFFFFFFFF) {
+    close(fd);
+    return NULL;
+  }
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return NULL;
+  *size = (uint32_t)st.st_size;
+  return (const byte*)data;
+}
+
+void EMV_UnmapTraceFile(const byte* data, uint32_t size) {
+  if (data != NULL) munmap((void*)data, size);
+}
+#endif
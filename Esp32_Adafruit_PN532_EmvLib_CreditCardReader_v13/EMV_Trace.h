@@ -0,0 +1,149 @@
+/**
+ * APDU traces for the ESP32_EMV library.
+ * EMV_TraceRecorder is an EMV_Transport that forwards every command to another transport
+ * and captures the command/response pair with a timestamp. The pairs are stored by an
+ * EMV_TraceWriter in a compact binary trace that can hold many sessions (taps).
+ * EMV_TraceReader reads a trace in place (e.g. a memory mapped file) and EMV_ReplayTransport
+ * answers the commands of the read flow from a recorded session.
+ *
+ * Trace format, all numbers little endian:
+ * File header      16 bytes  'E' 'M' 'V' 'T', version, 3 reserved bytes, u32 sessionCount, u32 indexOffset
+ * Session header    8 bytes  u16 exchangeCount, u16 reserved, u32 length of the exchange records
+ * Exchange record  10 bytes  u32 timestamp (microseconds since session start), u16 sendLen, u16 recvLen,
+ *                            u8 flags (bit 0 = transceive succeeded), u8 reserved
+ *                            followed by sendLen command bytes and recvLen response bytes
+ * Index                      sessionCount x u32 offset of the session header, written by finish()
+ * With the index any session of a trace can be reached without parsing the sessions before it.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Trace_h
+#define EMV_Trace_h
+
+#include "Arduino.h"
+#include "EMV_Transport.h"
+
+#define EMV_TRACE_VERSION 1
+#define EMV_TRACE_FILE_HEADER_LEN 16
+#define EMV_TRACE_SESSION_HEADER_LEN 8
+#define EMV_TRACE_EXCHANGE_HEADER_LEN 10
+#define EMV_TRACE_FLAG_SUCCESS 0x01
+
+struct EMV_TraceExchange {
+  uint32_t timestamp;     // microseconds since the session start
+  const byte* sendData;   // points into the trace
+  uint16_t sendLen;
+  const byte* recvData;   // points into the trace
+  uint16_t recvLen;
+  byte flags;
+};
+
+// Writes a trace into a caller supplied buffer. The buffer can be stored or sent
+// anywhere (file, serial, network) after finish().
+class EMV_TraceWriter {
+
+public:
+  void begin(byte* buffer, uint32_t bufferSize);
+  bool beginSession();
+  bool addExchange(uint32_t timestamp, const byte* sendData, uint16_t sendLen, const byte* recvData, uint16_t recvLen, byte flags);
+  void endSession();
+  // writes the session index, after that the trace is complete
+  bool finish();
+
+  const byte* data() { return buffer; }
+  uint32_t size() { return used; }
+  uint32_t sessionCount() { return sessions; }
+  bool overflow() { return isOverflow; }  // true if an exchange did not fit into the buffer
+
+private:
+  byte* buffer = NULL;
+  uint32_t bufferSize = 0;
+  uint32_t used = 0;
+  uint32_t sessions = 0;
+  uint32_t sessionOffset = 0;  // offset of the open session header, 0 = no open session
+  uint16_t sessionExchanges = 0;
+  bool isOverflow = false;
+};
+
+// Reads a complete trace in place, nothing gets copied
+class EMV_TraceReader {
+
+public:
+  bool begin(const byte* data, uint32_t size);
+  uint32_t sessionCount() { return sessions; }
+  uint16_t exchangeCount(uint32_t session);
+  // positions the reader on the first exchange of a session
+  bool openSession(uint32_t session);
+  bool nextExchange(EMV_TraceExchange* exchange);
+  // the position inside the open session, to come back to an exchange later
+  uint32_t tell() { return position; }
+  void seek(uint32_t position) { this->position = position; }
+
+private:
+  const byte* data = NULL;
+  uint32_t size = 0;
+  uint32_t sessions = 0;
+  uint32_t indexOffset = 0;
+  uint32_t position = 0;
+  uint32_t sessionEnd = 0;
+
+  uint32_t sessionHeaderOffset(uint32_t session);
+};
+
+// Records every exchange of the wrapped transport
+class EMV_TraceRecorder : public EMV_Transport {
+
+public:
+  EMV_TraceRecorder(EMV_Transport* transport, EMV_TraceWriter* writer);
+
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  bool detectCard() override { return transport->detectCard(); }
+  bool checkPresence() override { return transport->checkPresence(); }
+  byte cardUid(byte* uid) override { return transport->cardUid(uid); }
+  byte detectCards(byte maxCards) override { return transport->detectCards(maxCards); }
+  bool selectCard(byte index) override { return transport->selectCard(index); }
+  uint16_t maxResponseLen() override { return transport->maxResponseLen(); }
+
+  // call for every new tap
+  void beginSession();
+  void endSession();
+
+private:
+  EMV_Transport* transport;
+  EMV_TraceWriter* writer;
+  uint32_t sessionStart = 0;
+};
+
+// Answers commands from a recorded session. A command is matched against the recorded
+// commands from the current position on, so a read flow that skips commands (e.g. it sends
+// Le = 0x00 at once) can still be replayed.
+class EMV_ReplayTransport : public EMV_Transport {
+
+public:
+  EMV_ReplayTransport(EMV_TraceReader* reader);
+
+  bool selectSession(uint32_t session);
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+
+  uint32_t mismatchCount = 0;  // commands that were not found in the session
+
+private:
+  EMV_TraceReader* reader;
+  uint32_t session = 0;
+  uint32_t position = 0;  // reader position of the next unused exchange
+};
+
+// Imports the text format of Sample_CreditCard_Reading_Log.md (the "Send length / Recv length"
+// blocks). Every "Found a card!" line starts a new session. Returns the number of imported exchanges.
+// An exchange with a command or response that has not the logged length (a cut or broken log
+// line, a response longer than EMV_MAX_RESPONSE) is not imported and counted in rejected.
+uint32_t EMV_ImportTextLog(const char* text, EMV_TraceWriter* writer, uint32_t* rejected = NULL);
+
+#ifndef ARDUINO
+// Maps a trace file into memory (POSIX hosts), returns NULL on error
+const byte* EMV_MapTraceFile(const char* fileName, uint32_t* size);
+void EMV_UnmapTraceFile(const byte* data, uint32_t size);
+#endif
+
+#endif
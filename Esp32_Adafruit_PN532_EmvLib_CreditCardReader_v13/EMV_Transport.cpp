@@ -0,0 +1,69 @@
+#include "EMV_Transport.h"
+#include "EMV_Tlv.h"
+
+bool EMV_Transport::transceive(byte* sendData, byte sendLen, byte* backData, byte* backLen) {
+  uint16_t len = 0;
+  EMV_TransceiveStatus status = exchange(sendData, sendLen, backData, *backLen, &len);
+  if (status == EMV_TRANSCEIVE_NO_RESPONSE) {
+    *backLen = 255;
+    return true;
+  }
+  *backLen = len;
+  return status == EMV_TRANSCEIVE_OK;
+}
+
+EMV_TransceiveStatus EMV_PN532ResponseStatus(const byte* backData, uint16_t backLen, uint16_t limit) {
+  if (backLen == 0) return EMV_TRANSCEIVE_NO_RESPONSE;
+  if (backLen < limit) return EMV_TRANSCEIVE_OK;
+  uint32_t tag;
+  uint16_t length;
+  uint8_t tagLen = EMV_TlvParseTag(backData, backLen, &tag);
+  uint8_t lengthLen = (tagLen > 0) ? EMV_TlvParseLength(&backData[tagLen], backLen - tagLen, &length) : 0;
+  if (lengthLen > 0 && tagLen + lengthLen + length + 2 == backLen) return EMV_TRANSCEIVE_OK;
+  return EMV_TRANSCEIVE_TOO_LONG;
+}
+
+EMV_PN532Transport::EMV_PN532Transport(Adafruit_PN532* nfc, uint16_t packetBufferSize) {
+  this->nfc = nfc;
+  setPacketBufferSize(packetBufferSize);
+}
+
+void EMV_PN532Transport::setPacketBufferSize(uint16_t packetBufferSize) {
+  if (packetBufferSize > EMV_PN532_PACKBUFFSIZ_MODIFIED) packetBufferSize = EMV_PN532_PACKBUFFSIZ_MODIFIED;
+  if (packetBufferSize < EMV_PN532_FRAME_HEADER + 8) packetBufferSize = EMV_PN532_FRAME_HEADER + 8;
+  this->packetBufferSize = packetBufferSize;
+}
+
+EMV_TransceiveStatus EMV_PN532Transport::exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  *backLen = 0;
+  if (nfc == NULL) return EMV_TRANSCEIVE_ERROR;
+  if (sendLen > packetBufferSize - 2) return EMV_TRANSCEIVE_TOO_LONG;
+  // the library copies at most responseLength bytes
+  byte responseLength = (backSize < maxResponseLen()) ? backSize : maxResponseLen();
+  byte limit = responseLength;
+  if (!nfc->inDataExchange(sendData, sendLen, backData, &responseLength)) return EMV_TRANSCEIVE_ERROR;
+  *backLen = responseLength;
+  return EMV_PN532ResponseStatus(backData, responseLength, limit);
+}
+
+bool EMV_PN532Transport::detectCard() {
+  uidLen = 0;
+  if (nfc == NULL) return false;
+  byte length = 0;
+  if (!nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &length, 0, true)) return false;
+  uidLen = (length <= EMV_MAX_UID) ? length : 0;
+  return true;
+}
+
+byte EMV_PN532Transport::cardUid(byte* uid) {
+  memcpy(uid, this->uid, uidLen);
+  return uidLen;
+}
+
+bool EMV_PN532Transport::checkPresence() {
+  if (nfc == NULL) return false;
+  byte probe[5] = { 0x00, 0xC0, 0x00, 0x00, 0x00 };
+  byte response[8];
+  byte responseLength = sizeof(response);
+  return nfc->inDataExchange(probe, sizeof(probe), response, &responseLength) && responseLength >= 2;
+}
@@ -0,0 +1,105 @@
+/**
+ * Transport layer for the ESP32_EMV library.
+ * The ESP32_EMV class does not talk to the NFC reader directly but sends every
+ * command APDU through an EMV_Transport. This way the same read flow can run
+ * against the PN532 reader or against a simulated card (see EMV_SimCard.h).
+ * All lengths of an exchange are 16 bit and "no response" is a status of its own, so a
+ * response of 255 bytes is not mistaken for a missing one.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef EMV_Transport_h
+#define EMV_Transport_h
+
+#include "Arduino.h"
+#include "Adafruit_PN532.h"
+
+#define EMV_MAX_RESPONSE 258  // 256 bytes of data + status word
+#define EMV_MAX_CARDS 2       // the PN532 activates at most two ISO14443A targets at once
+#define EMV_MAX_UID 10        // a triple size ISO14443A UID
+
+// PN532_PACKBUFFSIZ of Adafruit_PN532.cpp: 255 in the library modified as ESP32_EMV.h describes it,
+// 64 in the stock library. A frame of the PN532 starts with 8 bytes (preamble, start code, length,
+// TFI, command code, status), the rest of the packet buffer holds the response.
+#define EMV_PN532_PACKBUFFSIZ_MODIFIED 255
+#define EMV_PN532_PACKBUFFSIZ_STOCK 64
+#define EMV_PN532_FRAME_HEADER 8
+
+enum EMV_TransceiveStatus : byte {
+  EMV_TRANSCEIVE_OK = 0,           // backLen bytes received, including the status word SW1 SW2
+  EMV_TRANSCEIVE_NO_RESPONSE = 1,  // the card did not answer
+  EMV_TRANSCEIVE_ERROR = 2,        // the reader failed or there is no card in the field
+  EMV_TRANSCEIVE_TOO_LONG = 3      // the command or the response does not fit the frame of the reader or backSize
+};
+
+class EMV_Transport {
+
+public:
+  virtual ~EMV_Transport() {}
+
+  // Exchanges one command APDU with the card in the field.
+  // backSize is the size of backData, on return backLen holds the number of received bytes
+  // (including the status word SW1 SW2).
+  virtual EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) = 0;
+
+  // The interface of the versions before exchange(): on entry backLen holds the size of backData,
+  // on return the number of received bytes. A missing response returns true with backLen = 255.
+  bool transceive(byte* sendData, byte sendLen, byte* backData, byte* backLen);
+
+  // the longest response the reader receives in one exchange
+  virtual uint16_t maxResponseLen() { return EMV_MAX_RESPONSE; }
+
+  // Looks once for a card in the field and activates it, returns false if there is none.
+  // The default is a card that is always present.
+  virtual bool detectCard() { return true; }
+  // Checks that the activated card is still in the field, without a new activation.
+  virtual bool checkPresence() { return true; }
+  // Copies the UID of the activated card (at most EMV_MAX_UID bytes) and returns its length,
+  // 0 = the UID is unknown.
+  virtual byte cardUid(byte* /*uid*/) { return 0; }
+
+  // Looks once for up to maxCards cards in the field (e.g. two cards in a wallet) and activates
+  // them, returns the number of cards. The exchanges go to card 0 until selectCard is called.
+  // The default lists the card of detectCard.
+  virtual byte detectCards(byte maxCards) { return (maxCards > 0 && detectCard()) ? 1 : 0; }
+  // the following exchanges go to card index (0 .. detectCards - 1)
+  virtual bool selectCard(byte index) { return index == 0; }
+};
+
+// inDataExchange of the Adafruit_PN532 library cuts a response silently at the length it is asked
+// for and keeps the frame length of the PN532 private. A response of exactly limit bytes is taken
+// as complete only when it is one TLV followed by the status word (all EMV responses with data
+// are), everything else of this length returns EMV_TRANSCEIVE_TOO_LONG.
+EMV_TransceiveStatus EMV_PN532ResponseStatus(const byte* backData, uint16_t backLen, uint16_t limit);
+
+// Transport for a PN532 reader driven by the Adafruit_PN532 library.
+// packetBufferSize is PN532_PACKBUFFSIZ of the library in use, the default is the modified library
+// (responses up to 247 bytes). With the stock library (EMV_PN532_PACKBUFFSIZ_STOCK) a response is
+// read up to 56 bytes, a longer one ends with EMV_TRANSCEIVE_TOO_LONG instead of being read behind
+// the packet buffer, cards that send their data in parts with 61xx can be read.
+// inListPassiveTarget of the library activates one target and keeps its target number private,
+// so detectCards finds at most one card on the PN532.
+class EMV_PN532Transport : public EMV_Transport {
+
+public:
+  EMV_PN532Transport(Adafruit_PN532* nfc, uint16_t packetBufferSize = EMV_PN532_PACKBUFFSIZ_MODIFIED);
+
+  EMV_TransceiveStatus exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) override;
+  uint16_t maxResponseLen() override { return packetBufferSize - EMV_PN532_FRAME_HEADER; }
+  void setPacketBufferSize(uint16_t packetBufferSize);
+  // one activation (readPassiveTargetID with inlist, the card gets activated for inDataExchange and
+  // the UID is kept), it returns at once only with a low setPassiveActivationRetries value
+  bool detectCard() override;
+  // a GET RESPONSE without pending data, every answer of the card (e.g. 69 85) means present
+  bool checkPresence() override;
+  byte cardUid(byte* uid) override;
+
+private:
+  Adafruit_PN532* nfc;
+  uint16_t packetBufferSize;
+  byte uid[EMV_MAX_UID];
+  byte uidLen = 0;
+};
+
+#endif
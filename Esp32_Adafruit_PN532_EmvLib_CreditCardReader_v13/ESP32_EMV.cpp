@@ -1,6 +1,15 @@
 #include "Arduino.h"
 #include "ESP32_EMV.h"
 #include <Adafruit_PN532.h>
+#include "EMV_Log.h"
+
+// the output of the library, see EMV_Log.h for the compile time switches
+#define COMM_DEBUG EMV_LOG_ON(EMV_LOG_LEVEL_DEBUG, EMV_LOG_COMM, COMM_DEBUG_PRINT)
+#define METHOD_DEBUG EMV_LOG_ON(EMV_LOG_LEVEL_DEBUG, EMV_LOG_METHOD, METHOD_DEBUG_PRINT)
+#define METHOD_INFO EMV_LOG_ON(EMV_LOG_LEVEL_INFO, EMV_LOG_METHOD, METHOD_DEBUG_PRINT)
+#define METHOD_ERROR EMV_LOG_ON(EMV_LOG_LEVEL_ERROR, EMV_LOG_METHOD, true)
+#define TLV_DEBUG EMV_LOG_ON(EMV_LOG_LEVEL_DEBUG, EMV_LOG_TLV, TLV_DEBUG_PRINT)
+#define PDOL_DEBUG EMV_LOG_ON(EMV_LOG_LEVEL_DEBUG, EMV_LOG_PDOL, PDOL_DEBUG_PRINT)
 
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -9,8 +18,12 @@
 //
 /////////////////////////////////////////////////////////////////////////////////////
 
-ESP32_EMV::ESP32_EMV(Adafruit_PN532* nfc) {
-  emvLib = nfc;
+ESP32_EMV::ESP32_EMV(Adafruit_PN532* nfc, uint16_t packetBufferSize) : pn532Transport(nfc, packetBufferSize) {
+  emvLib = &pn532Transport;
+}
+
+ESP32_EMV::ESP32_EMV(EMV_Transport* transport) : pn532Transport(NULL) {
+  emvLib = transport;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -19,22 +32,52 @@ ESP32_EMV::ESP32_EMV(Adafruit_PN532* nfc) {
 //
 /////////////////////////////////////////////////////////////////////////////////////
 
+bool ESP32_EMV::DetectCard() {
+  return emvLib->detectCard();
+}
+
+byte ESP32_EMV::DetectCards(byte maxCards) {
+  return emvLib->detectCards(maxCards);
+}
+
+bool ESP32_EMV::SelectCard(byte index) {
+  return emvLib->selectCard(index);
+}
+
+void ESP32_EMV::setDebugPrint(bool debugPrint) {
+  COMM_DEBUG_PRINT = debugPrint;
+  METHOD_DEBUG_PRINT = debugPrint;
+  TLV_DEBUG_PRINT = debugPrint;
+  PDOL_DEBUG_PRINT = debugPrint;
+}
+
+bool ESP32_EMV::CheckPresence() {
+  return emvLib->checkPresence();
+}
+
+byte ESP32_EMV::CardUid(byte* uid) {
+  return emvLib->cardUid(uid);
+}
+
 ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectPpse(byte* backReadData, uint16_t* backReadLen) {
   //uint16_t selectPpseLen = 14;
   // byte[] PPSE = "2PAY.SYS.DDF01".getBytes(StandardCharsets.UTF_8); // PPSE
   //byte selectPpse[14] = { 0x32, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31 };
   uint16_t backLen = 255;
-  byte backData[backLen];
+
+  // a new card, the Le learned in the last session does not apply
+  lePolicy.beginSession();
+  card.clear();
+  if (apduRing != NULL) apduRing->beginTap();
 
   EMV_StatusCode statusCode;
-  statusCode = SelectApdu(SELECT_PPSE_COMMAND, sizeof(SELECT_PPSE_COMMAND), 0x01, backData, &backLen);
+  statusCode = SelectApdu(SELECT_PPSE_COMMAND, sizeof(SELECT_PPSE_COMMAND), 0x01, backReadData, &backLen);
 
   if (statusCode != EMV_STATUS_OK) {
     *backReadLen = backLen;
     return (EMV_StatusCode)statusCode;
   }
 
-  memcpy(backReadData, backData, backLen);
   *backReadLen = backLen;
   return EMV_STATUS_OK;
 }
@@ -42,142 +85,107 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectPpse(byte* backReadData, uint16_t* ba
 // SerarchIndex: 0 = no search, 1 = search for tag 4Fh = AID, 2 = search for tag 9F38h = PDOL
 ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectApdu(byte* sendData, byte sendLen, byte searchIndex, byte* backReadData, uint16_t* backReadLen) {
 
-  if (METHOD_DEBUG_PRINT) {
+  if (METHOD_DEBUG) {
     Serial.printf("SelectApdu searchIndex %02x\n", searchIndex);
   }
 
-  //byte backData[256];
-  byte backData[255];
+  // a new application, the data of the last one does not apply
+  if (searchIndex == 0x02) card.clearApplication();
+
+  EMV_ScratchScope scope(&scratch);
+  byte* backData = scratch.alloc(255);
+  if (backData == NULL) return EMV_STATUS_ERROR;
   uint16_t backLen = 255;
-  byte leByte = 0xF8;  // don't ask for the full length in the first run
+  // the selected AID (or the PPSE name) is the key for the learned Le
+  lePolicy.setKey(sendData, sendLen);
+  // the PPSE name is not an AID
+  metrics.setAid((searchIndex == 0x01) ? NULL : sendData, sendLen);
+  byte leByte = lePolicy.firstLe();
+  bool isFirstLe = true;
 
   EMV_StatusCode statusCode;
   statusCode = SelectApdu_Le(sendData, sendLen, leByte, backData, &backLen);
 
-  if (statusCode != EMV_STATUS_OK) return statusCode;
+  if (statusCode != EMV_STATUS_OK && statusCode != EMV_STATUS_NO_RESPONSE) return statusCode;
 
   if (backLen == 2) {
-    if (METHOD_DEBUG_PRINT) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
-    if (backData[backLen - 2] == 0x67 && backData[backLen - 1] == 0x00) {
-      if (METHOD_DEBUG_PRINT) {
-        // this means the card is asking for a 'zero' Le
+    if (METHOD_DEBUG) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
+    if (EMV_ClassifyResponse(backData, backLen) == EMV_SW_WRONG_LENGTH) {
+      leByte = lePolicy.fallbackLe(leByte);
+      metrics.recordLeFallback();
+      isFirstLe = false;
+      if (METHOD_DEBUG) {
+        // this means the card is asking for another Le
         Serial.println("------------------------");
-        Serial.println("Card is asking for Le = 0x00");
+        Serial.printf("Card is asking for Le = 0x%02x\n", leByte);
       }
 
-      leByte = 0x00;
       backLen = 255;
       statusCode = SelectApdu_Le(sendData, sendLen, leByte, backData, &backLen);
     }
   }
 
-  if (backLen == 255) {
+  if (statusCode == EMV_STATUS_NO_RESPONSE) {
     uint8_t retries = 0;
     bool tryNewSend = true;
     while (tryNewSend) {
-      if (METHOD_DEBUG_PRINT) {
+      if (METHOD_DEBUG) {
         Serial.println("------------------------");
         Serial.printf("Retry No %d\n", retries + 1);
       }
       backLen = 255;
+      metrics.recordRetry();
       statusCode = SelectApdu_Le(sendData, sendLen, leByte, backData, &backLen);
-      if (backLen < 255) tryNewSend = false;
+      if (statusCode != EMV_STATUS_NO_RESPONSE) tryNewSend = false;
       retries++;
       if (retries == NUMBER_OF_RETRIES) tryNewSend = false;
     }
   }
 
-  // if something gone wrong the backLen seems to be 255
-  if (backLen < 255) {
+  // the card did not answer, even after the retries
+  if (statusCode != EMV_STATUS_NO_RESPONSE) {
 
     if (statusCode != EMV_STATUS_OK)
       return (EMV_StatusCode)statusCode;
 
-    // BER-TLV decoder
-    uint8_t buffer[255];
-    //TLVS tlvs;
-    TLVNode *tlvNode, *childNode;
-    size_t data_size;
-    memcpy(buffer, backData, backLen);
-    tlvs.decodeTLVs(buffer, sizeof(buffer));
-
-    int tlvsErrorValue = tlvs.errorValue();
-    //Serial.printf("tlvsErrorValue %d\n", tlvsErrorValue);
-    /*
-    int tlvNodeErrorCodes = tlvNode->errorCodes();
-    Serial.printf("tlvNodeErrorCodes %d\n", tlvNodeErrorCodes);
-    int tlvChildNodeErrorCodes = childNode->errorCodes();
-    Serial.printf("tlvChildNodeErrorCodes %d\n", tlvChildNodeErrorCodes);
-    */
-
-    // Dump the decoded TLV structure
-    tlvNode = tlvs.firstTLV();
-
-    if (METHOD_DEBUG_PRINT) {
-      Serial.print("TLV Node ");
-      Serial.println(tlvNode->getTag(), HEX);
+    if (!IsSuccess(backData, backLen)) {
+      // e.g. 6A 82 = the application is not on the card
+      if (backLen > 2) memcpy(backReadData, backData, backLen);
+      *backReadLen = backLen;
+      return EMV_STATUS_ERROR;
     }
-    for (childNode = tlvNode->firstChild(); childNode; childNode = tlvNode->nextChild(childNode)) {
-      if (METHOD_DEBUG_PRINT) {
-        Serial.print("Child Node ");
-        Serial.println(childNode->getTag(), HEX);
-      }
-    }
-    TLVS::printTLV(tlvNode);
+    lePolicy.learn(leByte, isFirstLe);
+
+    if (TLV_DEBUG) EMV_PrintTlv(backData, backLen - 2);
+
+    // one pass over the response collects all tags we are interested in
+    static const uint32_t SELECT_TAGS[] = { EMV_TAG_AID, EMV_TAG_PDOL };
+    EMV_TagIndex tagIndex(SELECT_TAGS, sizeof(SELECT_TAGS) / sizeof(SELECT_TAGS[0]));
+    tagIndex.build(backData, backLen - 2);
 
     if (searchIndex == 0x01) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("Search for tag 4F (AIDs on card)\n");
-      numberOfAids = 0;
-      // find a tag
-      TLVNode* tlvNodeSearch;
-      uint16_t tag4F = 0x4F;
-      tlvNodeSearch = tlvs.findTLV(tag4F);
-
-      // don't proceed if result is NULL
-
-      if (tlvNodeSearch != NULL) {
-
-        const uint8_t* tag4FValue = tlvNodeSearch->getValue();
-        uint32_t tag4FValueLength = tlvNodeSearch->getValueLength();
-
-        if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag4FValueLength);
-        //printHex((byte) tag4FValue, sizeof(tag4FValue));
-        //for (uint8_t i = 0; i < sizeof(tag4FValue); i++) {
-        for (uint8_t i = 0; i < tag4FValueLength; i++) {
-          if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag4FValue[i]);
-          aids[numberOfAids][i] = tag4FValue[i];
-        }
-        aidsLen[numberOfAids] = tag4FValueLength;
-        numberOfAids++;
-
-        while (tlvNodeSearch = tlvs.findNextTLV(tlvNodeSearch)) {
-          if (tlvNodeSearch == NULL) {
-            if (METHOD_DEBUG_PRINT) Serial.println("tlvNodeSearch = tlvs.findNextTLV() == NULL");
-          } else {
-            if (METHOD_DEBUG_PRINT) Serial.println("tlvNodeSearch = tlvs.findNextTLV() NOT NULL");
-            const uint8_t* tag4FValueN;
-            tag4FValueN = tlvNodeSearch->getValue();
-            tag4FValueLength = tlvNodeSearch->getValueLength();
-            if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag4FValueLength);
-            for (uint8_t i = 0; i < tag4FValueLength; i++) {
-              if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag4FValueN[i]);
-              aids[numberOfAids][i] = tag4FValueN[i];
-            }
-            aidsLen[numberOfAids] = tag4FValueLength;
-            numberOfAids++;
-            if (METHOD_DEBUG_PRINT) Serial.println("***");
-          }
+      if (METHOD_DEBUG) Serial.printf("Search for tag 4F (AIDs on card)\n");
+      card.numberOfAids = 0;
+      uint8_t numberOfTags4F = tagIndex.count(EMV_TAG_AID);
+      for (uint8_t n = 0; n < numberOfTags4F && card.numberOfAids < EMV_CARD_MAX_AIDS; n++) {
+        uint16_t tag4FValueLength;
+        const byte* tag4FValue = tagIndex.find(EMV_TAG_AID, &tag4FValueLength, n);
+        if (METHOD_DEBUG) Serial.printf("Tag 4F length %d\n", tag4FValueLength);
+        static_assert(EMV_TAG_INFO(EMV_TAG_AID).maxLength <= EMV_CARD_MAX_AID, "aids too short");
+        if (!EMV_TagLengthValid(EMV_TAG_AID, tag4FValueLength)) continue;
+        if (METHOD_DEBUG) {
+          printHex((byte*)tag4FValue, tag4FValueLength);
+          Serial.println();
         }
-        if (METHOD_DEBUG_PRINT) Serial.printf("Found %d AIDs on the card\n", numberOfAids);
-      }  // if tlvNodeSearch != NULL
+        memcpy(card.aids[card.numberOfAids], tag4FValue, tag4FValueLength);
+        card.aidsLen[card.numberOfAids] = tag4FValueLength;
+        card.numberOfAids++;
+      }
+      if (METHOD_DEBUG) Serial.printf("Found %d AIDs on the card\n", card.numberOfAids);
     } else if (searchIndex == 0x02) {
       // search for tag 9F38 = PDOL
-      if (METHOD_DEBUG_PRINT) Serial.printf("Search for tag 9F38 (PDOLs)\n");
-      TLVNode* tlvNodeSearch;
-      uint16_t tag9F38 = 0x9F38;
-      tlvNodeSearch = tlvs.findTLV(tag9F38);
+      if (METHOD_DEBUG) Serial.printf("Search for tag 9F38 (PDOLs)\n");
 
-      // don't proceed if result is NULL
       // Tag: 9F38 Length: 6
       //      9F 02 06 9F 1D 02
 
@@ -187,23 +195,19 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectApdu(byte* sendData, byte sendLen, by
       // Tag: 9F38 Length: 18
       //      9F 66 04 9F 02 06 9F 03 06 9F 1A 02 95 05 5F 2A 02 9A 03 9C 01 9F 37 04
 
-
-      if (tlvNodeSearch != NULL) {
-
-        const uint8_t* tag9F3AValue = tlvNodeSearch->getValue();
-        uint32_t tag9F3AValueLength = tlvNodeSearch->getValueLength();
-
-        if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag9F3AValueLength);
-        //printHex((byte) tag4FValue, sizeof(tag4FValue));
-        //for (uint8_t i = 0; i < sizeof(tag4FValue); i++) {
-        for (uint8_t i = 0; i < tag9F3AValueLength; i++) {
-          if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag9F3AValue[i]);
-          pdol[i] = tag9F3AValue[i];
+      uint16_t tag9F38ValueLength;
+      const byte* tag9F38Value = tagIndex.find(EMV_TAG_PDOL, &tag9F38ValueLength);
+      if (tag9F38Value != NULL && tag9F38ValueLength > EMV_CARD_MAX_PDOL) {
+        if (METHOD_DEBUG) Serial.printf("Tag 9F38 length %d is too long, the PDOL is ignored\n", tag9F38ValueLength);
+      } else if (tag9F38Value != NULL) {
+        if (METHOD_DEBUG) {
+          Serial.printf("Tag 9F38 length %d\n", tag9F38ValueLength);
+          printHex((byte*)tag9F38Value, tag9F38ValueLength);
+          Serial.println();
         }
-        pdolLen = tag9F3AValueLength;
-        if (METHOD_DEBUG_PRINT) Serial.println("*PDOL*");
-      } else {
-        pdolLen = 255;
+        memcpy(card.pdol, tag9F38Value, tag9F38ValueLength);
+        card.pdolLen = tag9F38ValueLength;
+        if (METHOD_DEBUG) Serial.println("*PDOL*");
       }
     }
 
@@ -214,18 +218,20 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectApdu(byte* sendData, byte sendLen, by
     return EMV_STATUS_OK;
   }
   *backReadLen = backLen;
-  return EMV_STATUS_ERROR;
+  return EMV_STATUS_NO_RESPONSE;
 }
 
 // This is the native code for SelectApdu. To be flexible this method allows to use alternative Le values (usually 0x00h)
 ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectApdu_Le(byte* sendData, byte sendLen, byte leByte, byte* backReadData, uint16_t* backReadLen) {
-  if (METHOD_DEBUG_PRINT) {
+  if (METHOD_DEBUG) {
     Serial.printf("SelectApdu leByte %02x sendLen %d data:\n", leByte, sendLen);
     printHex(sendData, sendLen);
     Serial.println();
   }
 
-  byte* sendData2 = new byte[sendLen + 6];
+  EMV_ScratchScope scope(&scratch);
+  byte* sendData2 = scratch.alloc(sendLen + 6);
+  if (sendData2 == NULL) return EMV_STATUS_ERROR;
 
   sendData2[0] = 0x00;           // CLA
   sendData2[1] = 0xA4;           // INS
@@ -235,42 +241,46 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::SelectApdu_Le(byte* sendData, byte sendLen,
   memcpy(&sendData2[5], sendData, sendLen);
   sendData2[sendLen + 5] = leByte;  // Le (0x00h)
 
-  byte backData[255];
+  // the response is received directly into the buffer of the caller
   byte backLen = 255;
 
   EMV_StatusCode statusCode;
 
-  statusCode = EMV_BasicTransceive(sendData2, sendLen + 6, backData, &backLen);
-  memcpy(backReadData, backData, backLen);
+  statusCode = EMV_Transceive(sendData2, sendLen + 6, backReadData, &backLen);
   *backReadLen = backLen;
   return statusCode;
 }
 
 ESP32_EMV::EMV_StatusCode ESP32_EMV::SendPdol(byte* backReadData, uint16_t* backReadLen) {
-  // the data is in pdol and pdolLen
+  // the data is in card.pdol and card.pdolLen
   EMV_StatusCode statusCode;
-  byte backData[255];
+  EMV_ScratchScope scope(&scratch);
+  byte* backData = scratch.alloc(255);
+  if (backData == NULL) return EMV_STATUS_ERROR;
   uint16_t backLen = 255;
   byte leByte;
-  if (pdolLen > 254) {
-    if (METHOD_DEBUG_PRINT) Serial.println("SendPdol is empty");
+  bool isFirstLe = true;
+  if (card.pdolLen == 0) {
+    if (METHOD_DEBUG) Serial.println("SendPdol is empty");
     // this is the MasterCard way, no PDOL is present and a zeroed PDOL is send
     // 80 A8 00 00 02 83 00 00
     backLen = 255;
     byte pdolEmpty[2];
     pdolEmpty[0] = 0x83;
     pdolEmpty[1] = 0x00;
-    leByte = 0xF8;
+    leByte = lePolicy.firstLe();
     //leByte = 0xDF;
     statusCode = SendPdol_Le(pdolEmpty, sizeof(pdolEmpty), leByte, backData, &backLen);
 
     if (backLen == 2) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
-      if (backData[backLen - 2] == 0x67 && backData[backLen - 1] == 0x00) {
-        // this means the card is asking for a 'zero' Le
-        if (METHOD_DEBUG_PRINT) Serial.println("Card is asking for Le = 0x00");
+      if (METHOD_DEBUG) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
+      if (EMV_ClassifyResponse(backData, backLen) == EMV_SW_WRONG_LENGTH) {
+        // this means the card is asking for another Le
         backLen = 255;
-        leByte = 0x00;
+        leByte = lePolicy.fallbackLe(leByte);
+        metrics.recordLeFallback();
+        isFirstLe = false;
+        if (METHOD_DEBUG) Serial.printf("Card is asking for Le = 0x%02x\n", leByte);
         //hexCharacterStringToBytes(pdolEmpty, pdolEmptyStringLe00);
         statusCode = SendPdol_Le(pdolEmpty, sizeof(pdolEmpty), leByte, backData, &backLen);
       }
@@ -284,258 +294,157 @@ Recv length 22
  77 12 82 02 19 80 94 0C 08 01 01 00 10 01 01 01 20 01 02 00 90 00
 */
   } else {
-    if (METHOD_DEBUG_PRINT) Serial.printf("SendPdol is requested with length %d\n", pdolLen);
-
-    // get the entries
-    uint8_t pde = 0;  // pdol entry position
-    uint8_t sumPdeResponse = 0;
-    byte sendDataTemp[250];
-    sendDataTemp[0] = 0x83;
-    //sendDataTemp[1] = length of following data , is filled after all data is known
-    uint8_t sendDataTempIndex = 2;
-    while (pde < pdolLen) {
-      bool isOneBytePdolTag = CheckOneBytePdol(pdol[pde]);
-      byte byte1 = pdol[pde];
-      if (isOneBytePdolTag) {
-        // the next byte is the length
-        pde++;
-        uint8_t respLen = pdol[pde];
-        // get the data from the look up and paste it in the sendDataTemp array
-        byte resp[respLen];
-        byte respLen1;
-        bool suc1 = LookUpPdolOneByte(byte1, respLen, resp, &respLen1);
-        for (uint8_t i = 0; i < respLen1; i++) {
-          sendDataTemp[sendDataTempIndex] = resp[i];
-          sendDataTempIndex++;
-        }
-        sumPdeResponse += respLen;
-        pde++;
-      } else {
-        // two tag bytes, then the length
-        //byte byte1 = pdol[pde]; // already catched up
-        pde++;
-        byte byte2 = pdol[pde];
-        pde++;
-        uint8_t respLen = pdol[pde];
-        // get the data from the look up and paste it in the sendDataTemp array
-        byte resp[respLen];
-        byte respLen1;
-        bool suc2 = LookUpPdolTwoByte(byte1, byte2, respLen, resp, &respLen1);
-        for (uint8_t i = 0; i < respLen1; i++) {
-          sendDataTemp[sendDataTempIndex] = resp[i];
-          sendDataTempIndex++;
-        }
-        sumPdeResponse += respLen;
-        pde++;
+    if (METHOD_DEBUG) Serial.printf("SendPdol is requested with length %d\n", card.pdolLen);
+
+    // the values are written behind tag 83 and its length (1 byte, 81 xx from 128 bytes on),
+    // 249 bytes + 6 bytes of the APDU fit into the 255 bytes of a PN532 frame
+    const uint16_t sendDataTempSize = 249;
+    byte* sendDataTemp = scratch.alloc(sendDataTempSize);
+    if (sendDataTemp == NULL) return EMV_STATUS_ERROR;
+    uint16_t sumPdeResponse;
+    // cards of the same product send the same PDOL, the compiled fill plan is cached
+    const EMV_DolPlan* plan = pdolPlans.get(card.pdol, card.pdolLen, &terminalData);
+    if (plan != NULL && plan->outputLen <= sendDataTempSize - 3) {
+      EMV_DolExecute(plan, &sendDataTemp[3]);
+      sumPdeResponse = plan->outputLen;
+      if (PDOL_DEBUG) {
+        Serial.printf("PDOL fill plan with %d steps, cache hits %lu misses %lu, data:", plan->numberOfSteps,
+                      (unsigned long)pdolPlans.hits, (unsigned long)pdolPlans.misses);
+        printHex(&sendDataTemp[3], sumPdeResponse);
+        Serial.println();
       }
+    } else if (!EMV_DolBuild(card.pdol, card.pdolLen, &terminalData, &sendDataTemp[3], sendDataTempSize - 3, &sumPdeResponse, PDOL_DEBUG)) {
+      if (METHOD_DEBUG) Serial.println("SendPdol the PDOL is malformed or too long");
+      return EMV_STATUS_ERROR;
+    }
+    if (METHOD_DEBUG) Serial.printf("Sum requested response bytes: %d\n", sumPdeResponse);
+    byte* pdolData;
+    if (sumPdeResponse < 128) {
+      pdolData = &sendDataTemp[1];
+    } else {
+      pdolData = &sendDataTemp[0];
+      sendDataTemp[1] = 0x81;
     }
-    sendDataTemp[1] = sumPdeResponse;  // length of following data
-    if (METHOD_DEBUG_PRINT) Serial.printf("Sum requested response bytes: %d\n", sumPdeResponse);
+    pdolData[0] = 0x83;
+    sendDataTemp[2] = sumPdeResponse;  // length of following data
+    byte pdolDataLen = &sendDataTemp[3] + sumPdeResponse - pdolData;
 
     backLen = 255;
-    leByte = 0xF8;
-    statusCode = SendPdol_Le(sendDataTemp, sumPdeResponse + 2, leByte, backData, &backLen);
+    leByte = lePolicy.firstLe();
+    statusCode = SendPdol_Le(pdolData, pdolDataLen, leByte, backData, &backLen);
 
     if (backLen == 2) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
-      if (backData[backLen - 2] == 0x67 && backData[backLen - 1] == 0x00) {
-        // this means the card is asking for a 'zero' Le
-        if (METHOD_DEBUG_PRINT) Serial.println("Card is asking for Le = 0x00");
+      if (METHOD_DEBUG) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
+      if (EMV_ClassifyResponse(backData, backLen) == EMV_SW_WRONG_LENGTH) {
+        // this means the card is asking for another Le
         backLen = 255;
-        leByte = 0x00;
-        statusCode = SendPdol_Le(sendDataTemp, sumPdeResponse + 2, leByte, backData, &backLen);
+        leByte = lePolicy.fallbackLe(leByte);
+        metrics.recordLeFallback();
+        isFirstLe = false;
+        if (METHOD_DEBUG) Serial.printf("Card is asking for Le = 0x%02x\n", leByte);
+        statusCode = SendPdol_Le(pdolData, pdolDataLen, leByte, backData, &backLen);
       }
     }
   }
 
-  if (METHOD_DEBUG_PRINT) Serial.printf("SendPdol statusCode %02x\n", statusCode);
+  if (METHOD_DEBUG) Serial.printf("SendPdol statusCode %02x\n", statusCode);
   if (statusCode != EMV_STATUS_OK) {
-    Serial.println("SendPdol statusCode ERROR - no more decoding");
+    if (METHOD_ERROR) Serial.println("SendPdol statusCode ERROR - no more decoding");
     return EMV_STATUS_ERROR;
   }
-
-  // BER-TLV decoder
-  uint8_t buffer[255];
-  //TLVS tlvs;
-  TLVNode *tlvNode, *childNode;
-  size_t data_size;
-  memcpy(buffer, backData, backLen);
-  tlvs.decodeTLVs(buffer, sizeof(buffer));
-
-  int tlvsErrorValue = tlvs.errorValue();
-  //Serial.printf("tlvsErrorValue %d\n", tlvsErrorValue);
-  /*
-    int tlvNodeErrorCodes = tlvNode->errorCodes();
-    Serial.printf("tlvNodeErrorCodes %d\n", tlvNodeErrorCodes);
-    int tlvChildNodeErrorCodes = childNode->errorCodes();
-    Serial.printf("tlvChildNodeErrorCodes %d\n", tlvChildNodeErrorCodes);
-    */
-
-  // Dump the decoded TLV structure
-  tlvNode = tlvs.firstTLV();
-  if (METHOD_DEBUG_PRINT) {
-    Serial.print("TLV Node ");
-    Serial.println(tlvNode->getTag(), HEX);
-  }
-  for (childNode = tlvNode->firstChild(); childNode; childNode = tlvNode->nextChild(childNode)) {
-    if (METHOD_DEBUG_PRINT) {
-      Serial.print("Child Node ");
-      Serial.println(childNode->getTag(), HEX);
-    }
+  if (!IsSuccess(backData, backLen)) {
+    if (METHOD_DEBUG) Serial.println("SendPdol was not accepted by the card - no more decoding");
+    return EMV_STATUS_ERROR;
   }
-  TLVS::printTLV(tlvNode);
-
-  // search for tag 57 Track 2 Equivalent Data
-  if (METHOD_DEBUG_PRINT) Serial.printf("Search for tag 57 (Track 2 Equivalent Data)\n");
-  // find a tag
-  // TLVNode* findTLV(uint16_t tag);
-  // TLVNode* findNextTLV(TLVNode* node);
-  tag57CompleteLen = 255;
-  TLVNode* tlvNodeSearch;
-  uint16_t tag57 = 0x57;
-  tlvNodeSearch = tlvs.findTLV(tag57);
+  lePolicy.learn(leByte, isFirstLe);
 
-  // don't proceed if result is NULL
+  if (TLV_DEBUG) EMV_PrintTlv(backData, backLen - 2);
 
-  if (tlvNodeSearch != NULL) {
+  // one pass over the response collects all tags we are interested in, with captureOnly the
+  // first GPO_AFL_TAGS only, the track 2 is not found then
+  static const uint32_t GPO_TAGS[] = { EMV_TAG_AFL, EMV_TAG_RESPONSE_FORMAT_1, EMV_TAG_TRACK2_EQUIVALENT_DATA, EMV_TAG_TRACK2_DATA };
+  const uint8_t GPO_AFL_TAGS = 2;
+  EMV_TagIndex tagIndex(GPO_TAGS, captureOnly ? GPO_AFL_TAGS : sizeof(GPO_TAGS) / sizeof(GPO_TAGS[0]));
+  tagIndex.build(backData, backLen - 2);
 
-    const uint8_t* tag57Value = tlvNodeSearch->getValue();
-    uint32_t tag57ValueLength = tlvNodeSearch->getValueLength();
+  // search for tag 57 Track 2 Equivalent Data, MasterCard may send tag 9F6B Track 2 Data instead
+  if (METHOD_DEBUG) Serial.printf("Search for tag 57 (Track 2 Equivalent Data)\n");
+  card.track2Len = 0;
+  card.panCharLen = 0;
+  card.panChar[0] = 0;
+  card.expDateCharLen = 0;
+  card.expDateChar[0] = 0;
+  uint16_t tag57ValueLength;
+  const byte* tag57Value = tagIndex.find(EMV_TAG_TRACK2_EQUIVALENT_DATA, &tag57ValueLength);
+  if (tag57Value == NULL) tag57Value = tagIndex.find(EMV_TAG_TRACK2_DATA, &tag57ValueLength);
 
-    if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag57ValueLength);
-    //printHex((byte) tag4FValue, sizeof(tag4FValue));
-    //for (uint8_t i = 0; i < sizeof(tag4FValue); i++) {
-    for (uint8_t i = 0; i < tag57ValueLength; i++) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag57Value[i]);
-      tag57Complete[i] = tag57Value[i];
-    }
-    tag57CompleteLen = tag57ValueLength;
-
-    // get the pan and exp date
-    t57PanLen = 0;
-    t57ExpDateLen = 0;
-    bool isPanDelimiterFound = false;
-    byte posByte;
-    uint8_t posIndex = 0;
-    //char panChar[30];
-    memset(panChar, 0, 20);
-    //uint8_t panCharLen = 0;
-    char bChar[2];
-    //char expDateChar[10];
-    //uint8_t expDateCharLen = 0;
-    while (!isPanDelimiterFound) {
-      posByte = tag57Complete[posIndex];
-      byte upperByte = (tag57Complete[posIndex] & 0xF0) >> 4;
-      byte lowerByte = (tag57Complete[posIndex] & 0x0F);
-      if (METHOD_DEBUG_PRINT) Serial.printf("posIndex %d byte %02x upperByte %02x lowerByte %02x\n", posIndex, tag57Complete[posIndex], upperByte, lowerByte);
-      if (upperByte != 0xd) {
-        sprintf(bChar, "%x", upperByte);
-        if (posIndex == 0) {
-          strcpy(panChar, bChar);
-        } else {
-          strcat(panChar, bChar);
-        }
-        panCharLen++;
-        if (lowerByte != 0xd) {
-          sprintf(bChar, "%x", lowerByte);
-          strcat(panChar, bChar);
-          panCharLen++;
-        }
-      }
-      if ((upperByte == 0xd) || (lowerByte == 0xd)) {
-        if (upperByte == 0xd) {
-          // the lower byte contains the first expiring year
-          sprintf(bChar, "%x", lowerByte);
-          strcpy(expDateChar, bChar);
-          expDateCharLen++;
-        }
-        isPanDelimiterFound = true;
-      }
-      posIndex++;
+  // don't proceed if result is NULL
+
+  if (tag57Value != NULL && tag57ValueLength <= EMV_CARD_MAX_TRACK2) {
+
+    if (METHOD_DEBUG) {
+      Serial.printf("Tag 57 length %d\n", tag57ValueLength);
+      printHex((byte*)tag57Value, tag57ValueLength);
+      Serial.println();
     }
+    memcpy(card.track2, tag57Value, tag57ValueLength);
+    card.track2Len = tag57ValueLength;
 
-    // now we copy 1..4 expiring date characters
-    while (expDateCharLen < 4) {
-      posByte = tag57Complete[posIndex];
-      byte upperByte = (tag57Complete[posIndex] & 0xF0) >> 4;
-      byte lowerByte = (tag57Complete[posIndex] & 0x0F);
-      if (METHOD_DEBUG_PRINT) Serial.printf("posIndex %d byte %02x upperByte %02x lowerByte %02x\n", posIndex, tag57Complete[posIndex], upperByte, lowerByte);
-      sprintf(bChar, "%x", upperByte);
-      if (expDateCharLen == 0) {
-        strcpy(expDateChar, bChar);
-      } else {
-        strcat(expDateChar, bChar);
-      }
-      expDateCharLen++;
-      if (expDateCharLen < 4) {
-        sprintf(bChar, "%x", lowerByte);
-        strcat(expDateChar, bChar);
-        expDateCharLen++;
-      }
-      posIndex++;
+    // get the pan and exp date, the PAN digits are followed by the separator 'D' and YYMM
+    EMV_Track2 track2;
+    EMV_BcdStatus track2Status = EMV_DecodeTrack2(card.track2, card.track2Len, &track2);
+    if (METHOD_DEBUG) Serial.printf("Track 2: %s\n", EMV_BcdStatusText(track2Status));
+    if (track2.panLen > 0) {
+      memcpy(card.panChar, track2.pan, track2.panLen + 1);
+      card.panCharLen = track2.panLen;
+      memcpy(card.expDateChar, track2.expDate, EMV_CARD_MAX_EXP_DATE_DIGITS + 1);
+      card.expDateCharLen = EMV_CARD_MAX_EXP_DATE_DIGITS;
     }
-    if (METHOD_DEBUG_PRINT) {
-      Serial.printf("Pan length %d: %s\n", panCharLen, panChar);
-      Serial.printf("ExpDate length %d: %s\n", expDateCharLen, expDateChar);
+    if (METHOD_DEBUG) {
+      Serial.printf("Pan length %d: %s\n", card.panCharLen, card.panChar);
+      Serial.printf("ExpDate length %d: %s\n", card.expDateCharLen, card.expDateChar);
     }
   } else {
-    if (METHOD_DEBUG_PRINT) Serial.println("No tag57 found");
+    if (METHOD_DEBUG) Serial.println("No tag57 found");
   }
 
   // search for tag 94h = AFL = Application File Locator
-  if (METHOD_DEBUG_PRINT) Serial.printf("Search for tag 94 (AFL Application File Locator)\n");
+  if (METHOD_DEBUG) Serial.printf("Search for tag 94 (AFL Application File Locator)\n");
   bool tag94Found = false;
-  t94AflLen = 0;
-  uint16_t tag94 = 0x94;
-  tlvNodeSearch = tlvs.findTLV(tag94);
-  if (tlvNodeSearch != NULL) {
+  card.aflLen = 0;
+  uint16_t tag94ValueLength;
+  const byte* tag94Value = tagIndex.find(EMV_TAG_AFL, &tag94ValueLength);
+  if (tag94Value != NULL) {
     tag94Found = true;
-    const uint8_t* tag94Value = tlvNodeSearch->getValue();
-    uint32_t tag94ValueLength = tlvNodeSearch->getValueLength();
-
-    if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag94ValueLength);
-    //printHex((byte) tag4FValue, sizeof(tag4FValue));
-    //for (uint8_t i = 0; i < sizeof(tag4FValue); i++) {
-    for (uint8_t i = 0; i < tag94ValueLength; i++) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag94Value[i]);
-      t94Afl[i] = tag94Value[i];
+    if (METHOD_DEBUG) {
+      Serial.printf("Tag 94 length %d\n", tag94ValueLength);
+      printHex((byte*)tag94Value, tag94ValueLength);
+      Serial.println();
     }
-    if (METHOD_DEBUG_PRINT) Serial.println();
-    t94AflLen = tag94ValueLength;
+    // more than EMV_CARD_MAX_AFL / 4 entries: the records of the first entries are read
+    card.aflLen = (tag94ValueLength < EMV_CARD_MAX_AFL) ? tag94ValueLength : EMV_CARD_MAX_AFL;
+    memcpy(card.afl, tag94Value, card.aflLen);
   } else {
-    if (METHOD_DEBUG_PRINT) Serial.println("No tag94 (AFL) found");
+    if (METHOD_DEBUG) Serial.println("No tag94 (AFL) found");
   }
 
   // now search for 'Response Message Template Format 1' that is in use e.g. for American Express Cards
   // search for tag 80h = Response Message Template Format 1
   if (!tag94Found) {
-    if (METHOD_DEBUG_PRINT) Serial.printf("Search for tag 80h (Response Message Template Format 1)\n");
-    uint8_t t80Len = 0;
-    uint16_t tag80 = 0x80;
-    byte t80[250];
-    tlvNodeSearch = tlvs.findTLV(tag80);
-    if (tlvNodeSearch != NULL) {
-      if (METHOD_DEBUG_PRINT) Serial.println("Found Tag 80");
-      const uint8_t* tag80Value = tlvNodeSearch->getValue();
-      uint32_t tag80ValueLength = tlvNodeSearch->getValueLength();
-
-      if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag80ValueLength);
-      //printHex((byte) tag4FValue, sizeof(tag4FValue));
-      //for (uint8_t i = 0; i < sizeof(tag4FValue); i++) {
-      for (uint8_t i = 0; i < tag80ValueLength; i++) {
-        if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag80Value[i]);
-        t80[i] = tag80Value[i];
-      }
-      if (METHOD_DEBUG_PRINT) Serial.println();
-      t80Len = tag80ValueLength;
-
-      // I'm reusing the wrong variable
-      for (uint8_t i = 0; i < t80Len - 2; i++) {
-        t94Afl[i] = t80[i + 2];
+    if (METHOD_DEBUG) Serial.printf("Search for tag 80h (Response Message Template Format 1)\n");
+    uint16_t tag80ValueLength;
+    const byte* tag80Value = tagIndex.find(EMV_TAG_RESPONSE_FORMAT_1, &tag80ValueLength);
+    // the value starts with the 2 bytes AIP followed by the AFL
+    if (tag80Value != NULL && tag80ValueLength >= 2) {
+      if (METHOD_DEBUG) {
+        Serial.printf("Found Tag 80 length %d\n", tag80ValueLength);
+        printHex((byte*)tag80Value, tag80ValueLength);
+        Serial.println();
       }
-      t94AflLen = t80Len - 2;
+      card.aflLen = (tag80ValueLength - 2 < EMV_CARD_MAX_AFL) ? tag80ValueLength - 2 : EMV_CARD_MAX_AFL;
+      memcpy(card.afl, tag80Value + 2, card.aflLen);
     } else {
-      if (METHOD_DEBUG_PRINT) Serial.println("No tag80 (Response Message Template Format 1) found");
+      if (METHOD_DEBUG) Serial.println("No tag80 (Response Message Template Format 1) found");
     }
   }
 
@@ -544,13 +453,15 @@ Recv length 22
 
 // This is the native code for SendPdol that allows for a flexible Le byte
 ESP32_EMV::EMV_StatusCode ESP32_EMV::SendPdol_Le(byte* sendData, byte sendLen, byte leByte, byte* backReadData, uint16_t* backReadLen) {
-  if (METHOD_DEBUG_PRINT) {
+  if (METHOD_DEBUG) {
     Serial.printf("SendPdol leByte %02x sendLen %d data:\n", leByte, sendLen);
     printHex(sendData, sendLen);
     Serial.println();
   }
 
-  byte sendData2[sendLen + 6];
+  EMV_ScratchScope scope(&scratch);
+  byte* sendData2 = scratch.alloc(sendLen + 6);
+  if (sendData2 == NULL) return EMV_STATUS_ERROR;
   sendData2[0] = 0x80;           // CLA
   sendData2[1] = 0xA8;           // INS
   sendData2[2] = 0x00;           // P1
@@ -559,251 +470,18 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::SendPdol_Le(byte* sendData, byte sendLen, b
   memcpy(&sendData2[5], sendData, sendLen);
   sendData2[sendLen + 5] = leByte;  // Le
 
-  byte backData[255];
+  // the response is received directly into the buffer of the caller
   byte backLen = 255;
 
   EMV_StatusCode statusCode;
 
-  statusCode = EMV_BasicTransceive(sendData2, sendLen + 6, backData, &backLen);
-  memcpy(backReadData, backData, backLen);
+  statusCode = EMV_Transceive(sendData2, sendLen + 6, backReadData, &backLen);
   *backReadLen = backLen;
   return statusCode;
 }
 
-bool ESP32_EMV::LookUpPdolOneByte(byte byte1, byte length, byte* resData, byte* resLength) {
-  if (byte1 == 0x95) {
-    uint8_t rLen = 5;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 1 Byte byte1 %02x byte2 -- length %2d respLen %d resData", byte1, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if (byte1 == 0x9a) {
-    uint8_t rLen = 3;
-    byte temp[rLen];
-    //temp[0] = 0x23;
-    temp[0] = 0x25;
-    temp[1] = 0x03;
-    temp[2] = 0x01;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 1 Byte byte1 %02x byte2 -- length %2d respLen %d resData", byte1, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if (byte1 == 0x9c) {
-    uint8_t rLen = 1;
-    byte temp[rLen];
-    temp[0] = 0x00;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 1 Byte byte1 %02x byte2 -- length %2d respLen %d resData", byte1, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else {
-    byte temp[length];
-    memset(temp, 0, length);
-    memcpy(resData, temp, length);
-    *resLength = length;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 1 Byte byte1 %02x byte2 -- length %2d respLen %d resData", byte1, length, length);
-      printHex(resData, length);
-      Serial.println();
-    }
-    return false;
-  }
-}
-
-bool ESP32_EMV::LookUpPdolTwoByte(byte byte1, byte byte2, byte length, byte* resData, byte* resLength) {
-  if ((byte1 == 0x9f) && (byte2 == 0x66)) {
-    uint8_t rLen = 4;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    temp[0] = 0x27;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x02)) {
-    uint8_t rLen = 6;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    temp[4] = 0x10;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x03)) {
-    uint8_t rLen = 6;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x1a)) {
-    uint8_t rLen = 2;
-    byte temp[rLen];
-    temp[0] = 0x09;
-    temp[1] = 0x78;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, length);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x5f) && (byte2 == 0x2a)) {
-    uint8_t rLen = 2;
-    byte temp[rLen];
-    temp[0] = 0x09;
-    temp[1] = 0x78;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x37)) {
-    uint8_t rLen = 4;
-    byte temp[rLen];
-    temp[0] = 0x38;
-    temp[1] = 0x39;
-    temp[2] = 0x30;
-    temp[3] = 0x31;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x35)) {
-    uint8_t rLen = 1;
-    byte temp[rLen];
-    temp[0] = 0x22;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x45)) {
-    uint8_t rLen = 2;
-    byte temp[rLen];
-    temp[0] = 0x00;
-    temp[1] = 0x00;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x4c)) {
-    uint8_t rLen = 8;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x34)) {
-    uint8_t rLen = 3;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x21)) {
-    uint8_t rLen = 3;
-    byte temp[rLen];
-    temp[0] = 0x11;
-    temp[1] = 0x10;
-    temp[2] = 0x09;
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else if ((byte1 == 0x9f) && (byte2 == 0x7c)) {
-    uint8_t rLen = 14;
-    byte temp[rLen];
-    memset(temp, 0, rLen);
-    memcpy(resData, temp, rLen);
-    *resLength = rLen;
-    if (PDOL_DEBUG_PRINT) {
-      Serial.printf("LookUp 2 Byte byte1 %02x byte2 %02x length %2d respLen %d resData", byte1, byte2, length, rLen);
-      printHex(resData, rLen);
-      Serial.println();
-    }
-    return true;
-  } else {
-    byte temp[length];
-    memset(temp, 0, length);
-    memcpy(resData, temp, length);
-    *resLength = length;
-    if (PDOL_DEBUG_PRINT) Serial.printf("LookUp 2 Byte byte1 %02x byte2 -- length %2d respLen %d resData", byte1, length, length);
-    return false;
-  }
-}
-
-// returns true if data byte is in the list of one byte commands
-bool ESP32_EMV::CheckOneBytePdol(byte data) {
-  // checks a list against the byte https://paymentcardtools.com/emv-misc/dols
-  if (data == 0x95) {
-    return true;
-  } else if (data == 0x9a) {
-    return true;
-  } else if (data == 0x9c) {
-    return true;
-  }
-  return false;
-}
-
 ESP32_EMV::EMV_StatusCode ESP32_EMV::ReadRecord(byte* aflEntry, byte* appData, uint16_t* backReadLen) {
-  if (METHOD_DEBUG_PRINT) {
+  if (METHOD_DEBUG) {
     Serial.print("ReadRecord");
     printHex(aflEntry, 4);
     Serial.println();
@@ -821,133 +499,119 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::ReadRecord(byte* aflEntry, byte* appData, u
   //sendData[4] = 0x00;          // Le
   sendData[4] = 0xF8;  // Le // works fine for MC Openbank first 3 files
 */
-  byte backData[255];
-  byte backLen = 255;
-  byte leByte = 0xF8;
+  EMV_ScratchScope scope(&scratch);
+  // the record is parsed complete, appData (size in *backReadLen) gets as much of it as fits
+  uint16_t appDataSize = *backReadLen;
+  byte* backData = scratch.alloc(EMV_MAX_RESPONSE);
+  if (backData == NULL) return EMV_STATUS_ERROR;
+  uint16_t backLen = EMV_MAX_RESPONSE;
   EMV_StatusCode statusCode;
 
   //statusCode = EMV_BasicTransceive(sendData, sizeof(sendData), backData, &backLen);
-  statusCode = ReadRecord_Le(aflEntry, leByte, backData, &backLen);
-
-  if (backLen == 2) {
-    if (METHOD_DEBUG_PRINT) Serial.printf("statusCode %d backLen %d\n", statusCode, backLen);
-    if (backData[backLen - 2] == 0x67 && backData[backLen - 1] == 0x00) {
-      // this means the card is asking for a 'zero' Le
-      Serial.println("Card is asking for Le = 0x00");
-      backLen = 255;
-      leByte = 0x00;
-      statusCode = ReadRecord_Le(aflEntry, leByte, backData, &backLen);
-    }
-  }
+  statusCode = ExchangeRecord(aflEntry, backData, &backLen);
 
-  if (METHOD_DEBUG_PRINT) Serial.printf("*** ReadRecord backLen %d\n", backLen);
-  if (backLen == 0) {
-    if (METHOD_DEBUG_PRINT) Serial.println("Received no valid response, aborting");
+  if (METHOD_DEBUG) Serial.printf("*** ReadRecord backLen %d\n", backLen);
+  if (backLen == 0 || statusCode == EMV_STATUS_NO_RESPONSE) {
+    if (METHOD_DEBUG) Serial.println("Received no valid response, aborting");
     *backReadLen = 255;
-    memcpy(appData, backData, backLen);
     return EMV_STATUS_NO_RESPONSE;
   }
-
-  // BER-TLV decoder
-  uint8_t buffer[255];
-  //TLVS tlvs;
-  TLVNode *tlvNode, *childNode;
-  size_t data_size;
-  memcpy(buffer, backData, backLen);
-  tlvs.decodeTLVs(buffer, sizeof(buffer));
-
-  int tlvsErrorValue = tlvs.errorValue();
-  //Serial.printf("tlvsErrorValue %d\n", tlvsErrorValue);
-  /*
-    int tlvNodeErrorCodes = tlvNode->errorCodes();
-    Serial.printf("tlvNodeErrorCodes %d\n", tlvNodeErrorCodes);
-    int tlvChildNodeErrorCodes = childNode->errorCodes();
-    Serial.printf("tlvChildNodeErrorCodes %d\n", tlvChildNodeErrorCodes);
-    */
-
-  // Dump the decoded TLV structure
-  tlvNode = tlvs.firstTLV();
-  if (METHOD_DEBUG_PRINT) {
-    Serial.print("TLV Node ");
-    Serial.println(tlvNode->getTag(), HEX);
+  *backReadLen = (backLen < appDataSize) ? backLen : appDataSize;
+  memcpy(appData, backData, *backReadLen);
+  if (statusCode != EMV_STATUS_OK || !IsSuccess(backData, backLen)) {
+    // e.g. 6A 83 = record not found, nothing to decode
+    return (statusCode != EMV_STATUS_OK) ? statusCode : EMV_STATUS_ERROR;
   }
-  for (childNode = tlvNode->firstChild(); childNode; childNode = tlvNode->nextChild(childNode)) {
-    if (METHOD_DEBUG_PRINT) {
-      Serial.print("Child Node ");
-      Serial.println(childNode->getTag(), HEX);
+
+  if (!captureOnly) ParseRecord(backData, backLen - 2);
+  return EMV_STATUS_OK;
+}
+
+// receives the record directly into the capture area, nothing gets decoded or printed
+ESP32_EMV::EMV_StatusCode ESP32_EMV::CaptureRecord(byte* aflEntry, uint8_t aidIndex, EMV_RecordCapture* capture) {
+  byte* backData = capture->reserve();
+  if (backData == NULL) return EMV_STATUS_ERROR;
+  uint16_t backLen = EMV_RECORD_CAPTURE_MAX_RESPONSE;
+  EMV_StatusCode statusCode = ExchangeRecord(aflEntry, backData, &backLen);
+  if (backLen == 0 || statusCode == EMV_STATUS_NO_RESPONSE) return EMV_STATUS_NO_RESPONSE;
+  if (statusCode != EMV_STATUS_OK || !IsSuccess(backData, backLen)) {
+    return (statusCode != EMV_STATUS_OK) ? statusCode : EMV_STATUS_ERROR;
+  }
+  if (!capture->commit(aflEntry[0] >> 3, aflEntry[1], aidIndex, backLen - 2)) return EMV_STATUS_ERROR;
+  return EMV_STATUS_OK;
+}
+
+// sends the READ RECORD with the Le of the Le policy and repeats it once if the card asks for another Le
+ESP32_EMV::EMV_StatusCode ESP32_EMV::ExchangeRecord(byte* aflEntry, byte* backData, uint16_t* backLen) {
+  uint16_t maxLen = *backLen;
+  byte leByte = lePolicy.firstLe();
+  bool isFirstLe = true;
+  EMV_StatusCode statusCode;
+
+  statusCode = ReadRecord_Le(aflEntry, leByte, backData, backLen);
+
+  if (*backLen == 2) {
+    if (METHOD_DEBUG) Serial.printf("statusCode %d backLen %d\n", statusCode, *backLen);
+    if (EMV_ClassifyResponse(backData, *backLen) == EMV_SW_WRONG_LENGTH) {
+      // this means the card is asking for another Le
+      *backLen = maxLen;
+      leByte = lePolicy.fallbackLe(leByte);
+      metrics.recordLeFallback();
+      isFirstLe = false;
+      if (METHOD_DEBUG) Serial.printf("Card is asking for Le = 0x%02x\n", leByte);
+      statusCode = ReadRecord_Le(aflEntry, leByte, backData, backLen);
     }
   }
-  TLVS::printTLV(tlvNode);
-
-  // find Tag5A (PAN) and Tag5F24 (Exp.Date)
-  /*
-  byte t5aPan[20];
-  byte t5aPanLen = 0;
-  byte t5f24ExpDate[10];
-  byte t5f24ExpDateLen = 0; // 0 = not found
-*/
-
-  // search for tag 57 Track 2 Equivalent Data
-  // find a tag
-  // TLVNode* findTLV(uint16_t tag);
-  // TLVNode* findNextTLV(TLVNode* node);
-  t5aPanLen = 0;
-  t5f24ExpDateLen = 0;
+  if (statusCode == EMV_STATUS_OK && IsSuccess(backData, *backLen)) lePolicy.learn(leByte, isFirstLe);
+  return statusCode;
+}
 
-  TLVNode* tlvNodeSearch;
-  uint16_t tag5a = 0x5A;
-  tlvNodeSearch = tlvs.findTLV(tag5a);
+// decodes a record (without the status word): Tag5A (PAN) and Tag5F24 (Exp.Date)
+void ESP32_EMV::ParseRecord(const byte* record, uint16_t recordLen) {
+  if (TLV_DEBUG) EMV_PrintTlv(record, recordLen);
 
-  // don't proceed if result is NULL
+  // find Tag5A (PAN) and Tag5F24 (Exp.Date) in one pass over the record
+  static const uint32_t RECORD_TAGS[] = { EMV_TAG_PAN, EMV_TAG_EXPIRATION_DATE };
+  EMV_TagIndex tagIndex(RECORD_TAGS, sizeof(RECORD_TAGS) / sizeof(RECORD_TAGS[0]));
+  tagIndex.build(record, recordLen);
 
-  if (tlvNodeSearch != NULL) {
+  uint16_t tag5aValueLength;
+  const byte* tag5aValue = tagIndex.find(EMV_TAG_PAN, &tag5aValueLength);
 
-    const uint8_t* tag5aValue = tlvNodeSearch->getValue();
-    uint32_t tag5aValueLength = tlvNodeSearch->getValueLength();
+  // don't proceed if result is NULL
 
-    if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag5aValueLength);
-    //printHex((byte) tag4FValue, sizeof(tag4FValue));
-    for (uint8_t i = 0; i < tag5aValueLength; i++) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag5aValue[i]);
-      t5aPan[i] = tag5aValue[i];
+  static_assert(EMV_TAG_INFO(EMV_TAG_PAN).maxLength <= EMV_CARD_MAX_PAN, "card.pan too short");
+  if (tag5aValue != NULL && EMV_TagLengthValid(EMV_TAG_PAN, tag5aValueLength)) {
+    memcpy(card.pan, tag5aValue, tag5aValueLength);
+    card.panLen = tag5aValueLength;
+    if (METHOD_DEBUG) {
+      Serial.printf("PAN found length %d\n", card.panLen);
+      printHex(card.pan, card.panLen);
+      Serial.println();
     }
-    t5aPanLen = tag5aValueLength;
-    if (METHOD_DEBUG_PRINT) Serial.printf("PAN found length %d\n", t5aPanLen);
-    printHex(t5aPan, t5aPanLen);
-    Serial.println();
   }
 
   // search for tag5f24 exp. date
-  uint16_t tag5f24 = 0x5f24;
-  tlvNodeSearch = tlvs.findTLV(tag5f24);
+  uint16_t tag5f24ValueLength;
+  const byte* tag5f24Value = tagIndex.find(EMV_TAG_EXPIRATION_DATE, &tag5f24ValueLength);
 
   // don't proceed if result is NULL
 
-  if (tlvNodeSearch != NULL) {
-
-    const uint8_t* tag5f24Value = tlvNodeSearch->getValue();
-    uint32_t tag5f24ValueLength = tlvNodeSearch->getValueLength();
-
-    if (METHOD_DEBUG_PRINT) Serial.printf("tlvNode->getValue length %d\n", tag5f24ValueLength);
-    for (uint8_t i = 0; i < tag5f24ValueLength; i++) {
-      if (METHOD_DEBUG_PRINT) Serial.printf("%02x ", tag5f24Value[i]);
-      t5f24ExpDate[i] = tag5f24Value[i];
-    }
-    t5f24ExpDateLen = tag5f24ValueLength;
-    if (METHOD_DEBUG_PRINT) {
-      Serial.printf("Expire Date found length %d\n", t5f24ExpDateLen);
-      printHex(t5f24ExpDate, t5f24ExpDateLen);
+  static_assert(EMV_TAG_INFO(EMV_TAG_EXPIRATION_DATE).maxLength <= EMV_CARD_MAX_EXP_DATE, "card.expDate too short");
+  if (tag5f24Value != NULL && EMV_TagLengthValid(EMV_TAG_EXPIRATION_DATE, tag5f24ValueLength)) {
+    memcpy(card.expDate, tag5f24Value, tag5f24ValueLength);
+    card.expDateLen = tag5f24ValueLength;
+    if (METHOD_DEBUG) {
+      Serial.printf("Expire Date found length %d\n", card.expDateLen);
+      printHex(card.expDate, card.expDateLen);
       Serial.println();
     }
   }
-
-  *backReadLen = backLen;
-  memcpy(appData, backData, backLen);
-  return EMV_STATUS_OK;
 }
 
-ESP32_EMV::EMV_StatusCode ESP32_EMV::ReadRecord_Le(byte* aflEntry, byte leByte, byte* backReadData, byte* backReadLen) {
-  if (METHOD_DEBUG_PRINT) {
+// on entry backReadLen holds the size of backReadData
+ESP32_EMV::EMV_StatusCode ESP32_EMV::ReadRecord_Le(byte* aflEntry, byte leByte, byte* backReadData, uint16_t* backReadLen) {
+  if (METHOD_DEBUG) {
     Serial.print("ReadRecord_Le");
     printHex(aflEntry, 4);
     Serial.println();
@@ -963,14 +627,8 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::ReadRecord_Le(byte* aflEntry, byte leByte,
   sendData[2] = aflEntry[1]; // P1
   sendData[3] = P2;          // P2
   sendData[4] = leByte;      // Le
-  byte backData[255];
-  byte backLen = 255;
-  EMV_StatusCode statusCode;
-
-  statusCode = EMV_BasicTransceive(sendData, sizeof(sendData), backData, &backLen);
-  memcpy(backReadData, backData, backLen);
-  *backReadLen = backLen;
-  return statusCode;
+  // the response is received directly into the buffer of the caller
+  return TransceiveLong(sendData, sizeof(sendData), backReadData, *backReadLen, backReadLen);
 }
 
 // This is a very simplyfied table with my most used Credit Card issuers. It returns true if
@@ -989,23 +647,23 @@ ESP32_EMV::EMV_StatusCode ESP32_EMV::LookUpAid(byte* sendData, byte sendLen, uin
   if (sendData[3] != 0x00) return EMV_STATUS_ERROR;
   if (sendData[4] == 0x03) {
     *aidNameIndex = 1;
-    Serial.println("VisaC");
+    if (METHOD_INFO) Serial.println("VisaC");
     return EMV_STATUS_OK;
   } else if (sendData[4] == 0x04) {
     *aidNameIndex = 2;
-    Serial.println("MasterC");
+    if (METHOD_INFO) Serial.println("MasterC");
     return EMV_STATUS_OK;
   } else if (sendData[4] == 0x25) {
     *aidNameIndex = 3;
-    Serial.println("AmexCo");
+    if (METHOD_INFO) Serial.println("AmexCo");
     return EMV_STATUS_OK;
   } else if (sendData[4] == 0x59) {
     *aidNameIndex = 4;
-    Serial.println("giroC");
+    if (METHOD_INFO) Serial.println("giroC");
     return EMV_STATUS_OK;
   } else {
     *aidNameIndex = 0;
-    Serial.println("UNKNOWN");
+    if (METHOD_INFO) Serial.println("UNKNOWN");
     return EMV_STATUS_ERROR;
   }
 }
@@ -1127,16 +785,13 @@ int ESP32_EMV::convertUint8_t4_2IntLsb(byte* input) {
 }
 
 void ESP32_EMV::convertIntTo3BytesLsb(int input, byte* output) {
-  byte* out = new byte[3];
   if (input > 16777215) {
     memset(output, 0, 3);
-    //memcpy(output, out, 3);
     return;
   }
-  out[0] = input & 0xff;
-  out[1] = (input >> 8) & 0xff;
-  out[2] = (input >> 16) & 0xff;
-  memcpy(output, out, 3);
+  output[0] = input & 0xff;
+  output[1] = (input >> 8) & 0xff;
+  output[2] = (input >> 16) & 0xff;
 }
 
 byte ESP32_EMV::upperPartByte(byte data) {
@@ -1153,34 +808,113 @@ byte ESP32_EMV::lowerPartByte(byte data) {
 //
 /////////////////////////////////////////////////////////////////////////////////////
 
-ESP32_EMV::EMV_StatusCode ESP32_EMV::EMV_BasicTransceive(byte* sendData, byte sendLen, byte* backData, byte* backLen) {
-  ESP32_EMV::EMV_StatusCode result;
-  bool success;
-  EMV_StatusCode statusCode;
-  byte bLen = 255;
-  if (COMM_DEBUG_PRINT) {
+// one exchange with the card, all output, the APDU ring and the metrics are done here
+ESP32_EMV::EMV_StatusCode ESP32_EMV::EMV_Exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  if (COMM_DEBUG) {
     Serial.printf("Send length %d\n", sendLen);
     printHex(sendData, sendLen);
     Serial.println("");
   }
-  success = emvLib->inDataExchange(sendData, sendLen, backData, &bLen);
-  if (COMM_DEBUG_PRINT) {
-    Serial.printf("Recv length %d\n", bLen);
-    printHex(backData, bLen);
+  if (apduRing != NULL) apduRing->add(EMV_APDU_RING_COMMAND, 0, sendData, sendLen);
+  uint32_t startMicros = micros();
+  EMV_TransceiveStatus status = emvLib->exchange(sendData, sendLen, backData, backSize, backLen);
+  bool success = status == EMV_TRANSCEIVE_OK || status == EMV_TRANSCEIVE_NO_RESPONSE;
+  metrics.recordExchange(sendData, sendLen, *backLen, micros() - startMicros, success, status == EMV_TRANSCEIVE_NO_RESPONSE);
+  if (apduRing != NULL) apduRing->add(EMV_APDU_RING_RESPONSE, (status == EMV_TRANSCEIVE_OK) ? EMV_TRACE_FLAG_SUCCESS : 0, backData, *backLen);
+  if (COMM_DEBUG) {
+    Serial.printf("Recv length %d\n", *backLen);
+    printHex(backData, *backLen);
     Serial.println("");
   }
-  if (success) {
-    if (bLen == 255) {
-      *backLen = bLen;
-      return EMV_STATUS_NO_RESPONSE;
-    } else {
-      *backLen = bLen;
-      return EMV_STATUS_OK;
-    }
-  } else {
-    *backLen = 0;
-    return EMV_STATUS_ERROR;
+  switch (status) {
+    case EMV_TRANSCEIVE_OK: lastExchangeStatus = EMV_STATUS_OK; break;
+    case EMV_TRANSCEIVE_NO_RESPONSE: lastExchangeStatus = EMV_STATUS_NO_RESPONSE; break;
+    case EMV_TRANSCEIVE_TOO_LONG:
+      if (METHOD_DEBUG) Serial.println("Response is too long for the receive buffer or the reader");
+      lastExchangeStatus = EMV_STATUS_TOO_LONG;
+      break;
+    default: lastExchangeStatus = EMV_STATUS_ERROR; break;
   }
+  return lastExchangeStatus;
+}
+
+// the byte interface of EMV_Exchange, a missing response is returned with backLen 255 as in the versions before
+ESP32_EMV::EMV_StatusCode ESP32_EMV::EMV_BasicTransceive(byte* sendData, byte sendLen, byte* backData, byte* backLen) {
+  uint16_t len = 0;
+  EMV_StatusCode statusCode = EMV_Exchange(sendData, sendLen, backData, *backLen, &len);
+  *backLen = (statusCode == EMV_STATUS_NO_RESPONSE) ? 255 : len;
+  return statusCode;
+}
+
+// Sends a command APDU and evaluates the status word of the response, all lengths are 16 bit:
+// 6Cxx = wrong Le: the command is sent once again with the exact Le xx
+// 61xx = more data: the remaining data is collected with GET RESPONSE and received directly behind
+//        the data in backData. Every GET RESPONSE asks for one byte less than the reader receives in
+//        one exchange (EMV_Transport::maxResponseLen), so a part never fills the frame and can't be
+//        taken for a cut response, and a long response needs the fewest exchanges. A part without
+//        data ends the read with EMV_STATUS_ERROR, a broken card can't keep the loop running.
+// Other status words are returned to the caller, the response ends with the status word.
+ESP32_EMV::EMV_StatusCode ESP32_EMV::TransceiveLong(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen) {
+  EMV_StatusCode statusCode = EMV_Exchange(sendData, sendLen, backData, backSize, backLen);
+  if (statusCode != EMV_STATUS_OK) return statusCode;
+
+  EMV_SwClass swClass = EMV_ClassifyResponse(backData, *backLen);
+  if (swClass == EMV_SW_WRONG_LE && sendLen >= 5) {
+    // the Le is the last byte of the command
+    byte leByte = sendData[sendLen - 1];
+    sendData[sendLen - 1] = backData[*backLen - 1];
+    if (METHOD_DEBUG) Serial.printf("Card is asking for the exact Le = 0x%02x\n", sendData[sendLen - 1]);
+    metrics.recordLeFallback();
+    statusCode = EMV_Exchange(sendData, sendLen, backData, backSize, backLen);
+    sendData[sendLen - 1] = leByte;
+    if (statusCode != EMV_STATUS_OK) return statusCode;
+    swClass = EMV_ClassifyResponse(backData, *backLen);
+  }
+
+  uint16_t maxPartLen = emvLib->maxResponseLen() - 3;
+  while (swClass == EMV_SW_MORE_DATA) {
+    // the status word gets overwritten by the next part of the data
+    uint16_t dataLen = *backLen - 2;
+    uint16_t pendingLen = (backData[*backLen - 1] == 0x00) ? 256 : backData[*backLen - 1];
+    uint16_t partSize = backSize - dataLen;
+    if (partSize <= 3) {
+      if (METHOD_DEBUG) Serial.println("Response is too long for the receive buffer");
+      return EMV_STATUS_TOO_LONG;
+    }
+    uint16_t partLe = pendingLen;
+    if (partLe > maxPartLen) partLe = maxPartLen;
+    if (partLe > partSize - 3) partLe = partSize - 3;
+    byte getResponse[5] = { 0x00, 0xC0, 0x00, 0x00, (byte)partLe };  // GET RESPONSE, Le 0x00 = 256 bytes
+    if (METHOD_DEBUG) Serial.printf("Card has %d more bytes, GET RESPONSE with Le %d\n", pendingLen, partLe);
+    uint16_t partLen = 0;
+    statusCode = EMV_Exchange(getResponse, sizeof(getResponse), &backData[dataLen], partSize, &partLen);
+    *backLen = dataLen + partLen;
+    if (statusCode != EMV_STATUS_OK) return statusCode;
+    swClass = EMV_ClassifyResponse(&backData[dataLen], partLen);
+    if (swClass == EMV_SW_MORE_DATA && partLen <= 2) {
+      if (METHOD_DEBUG) Serial.println("GET RESPONSE returned no data");
+      return EMV_STATUS_ERROR;
+    }
+  }
+
+  if (METHOD_DEBUG && swClass != EMV_SW_SUCCESS && *backLen >= 2) {
+    Serial.printf("SW %02X%02X %s\n", backData[*backLen - 2], backData[*backLen - 1], EMV_StatusWordText(backData[*backLen - 2], backData[*backLen - 1]));
+  }
+  return EMV_STATUS_OK;
+}
+
+// the byte interface of TransceiveLong, on entry backLen holds the size of backData
+ESP32_EMV::EMV_StatusCode ESP32_EMV::EMV_Transceive(byte* sendData, byte sendLen, byte* backData, byte* backLen) {
+  uint16_t len = 0;
+  EMV_StatusCode statusCode = TransceiveLong(sendData, sendLen, backData, *backLen, &len);
+  *backLen = len;
+  return statusCode;
+}
+
+// true if the status word at the end of the response reports a processed command (90 00, 62xx, 63xx)
+bool ESP32_EMV::IsSuccess(byte* backData, uint16_t backLen) {
+  EMV_SwClass swClass = EMV_ClassifyResponse(backData, backLen);
+  return swClass == EMV_SW_SUCCESS || swClass == EMV_SW_WARNING;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -14,6 +14,10 @@
  * In line 78 change one parameter
  * old: #define PN532_PACKBUFFSIZ 64 ///< Packet buffer size in bytes
  * new: #define PN532_PACKBUFFSIZ 255 ///< Packet buffer size in bytes
+ * Without the change construct the library with ESP32_EMV(&nfc, EMV_PN532_PACKBUFFSIZ_STOCK):
+ * EMV_PN532Transport then receives at most 56 bytes per frame, longer responses end with
+ * EMV_STATUS_TOO_LONG. Cards that answer with 61xx are read in parts that fit the frame with
+ * GET RESPONSE (see TransceiveLong).
  *
  * Author: Michael Fehr (AndroidCrypto)
 */
@@ -82,9 +86,19 @@ all PINs are on the left side of the dev board
 
 #include "Arduino.h"
 #include "Adafruit_PN532.h"
-
-// For reading EMV Cards - a BER-TLV encoder/decoder
-#include "tlv.h" // https://github.com/jmwanderer/tlv.arduino Arduino Library Manager Version 0.2.1
+#include "EMV_Transport.h"
+#include "EMV_LePolicy.h"
+#include "EMV_StatusWord.h"
+#include "EMV_Tlv.h"
+#include "EMV_Tags.h"
+#include "EMV_TerminalData.h"
+#include "EMV_DolPlan.h"
+#include "EMV_RecordCapture.h"
+#include "EMV_CardData.h"
+#include "EMV_Scratch.h"
+#include "EMV_ApduRing.h"
+#include "EMV_Metrics.h"
+#include "EMV_Bcd.h"
 
 class ESP32_EMV {
 
@@ -94,7 +108,9 @@ public:
   // Contructors
   /////////////////////////////////////////////////////////////////////////////////////
 
-  ESP32_EMV(Adafruit_PN532* nfc);
+  // packetBufferSize = PN532_PACKBUFFSIZ of the Adafruit_PN532 library, EMV_PN532_PACKBUFFSIZ_STOCK for the unmodified library
+  ESP32_EMV(Adafruit_PN532* nfc, uint16_t packetBufferSize = EMV_PN532_PACKBUFFSIZ_MODIFIED);
+  ESP32_EMV(EMV_Transport* transport); // e.g. a simulated card, see EMV_SimCard.h
 
   // Credit Card Data
   const uint8_t EMV_LIBRARY_VERSION = 13;
@@ -102,54 +118,36 @@ public:
   bool METHOD_DEBUG_PRINT = true; // if true some results are printed from inside a method
   bool TLV_DEBUG_PRINT = true; // if false the response is analyzed but not printed
   bool PDOL_DEBUG_PRINT = true; // true the response of PDOL lookup is printed
+  void setDebugPrint(bool debugPrint); // sets the four switches above, e.g. false for benchmarks and background reads
 
   // // byte[] PPSE = "2PAY.SYS.DDF01".getBytes(StandardCharsets.UTF_8); // PPSE
   byte SELECT_PPSE_COMMAND[14] = { 0x32, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31 };
 
-  // BER-TLV decoder
-  uint8_t buffer[255];
-  TLVS tlvs;
-  TLVNode *tlvNode, *childNode;
-  size_t data_size;
-
-  // 10 aids of max 16 bytes length, filled by SelectApdu SearchIndex 1 = after selectPpse
-  uint8_t numberOfAids = 0;
-  uint8_t aids[10][16];
-  uint8_t aidsLen[10];
-  // tag 9f38 = PDOL, filled by SelectApdu SearchIndex 2 = after select AID
-  uint8_t pdolLen = 255;
-  uint8_t pdol[255]; // filled by SelectApdu SerarchIndex 2
-  const uint8_t NUMBER_OF_RETRIES = 3;
+  // the data read from the card, see EMV_CardData.h
+  EMV_CardData card = {};
 
-  // tag 57 is 'old' Track 2 Equivalent Data including cc data
-  uint8_t tag57Complete[255];
-  uint8_t tag57CompleteLen = 255;
+  // the values SendPdol uses to fill the PDOL, e.g. terminalData.set(0x9A, date, 3) for the transaction date
+  EMV_TerminalData terminalData;
+  // the compiled fill plans of the last PDOLs
+  EMV_DolPlanCache pdolPlans;
+  const uint8_t NUMBER_OF_RETRIES = 3;
 
-  // Tag57 is Track 2 Equivalent Data
-  // Tag: 57 Length: 10
-  //         43 96 00 33 08 75 86 20 D2 60 32 21 96 61 17 12
-  byte t57Pan[20];
-  byte t57PanLen = 0;
-  byte t57ExpDate[10];
-  byte t57ExpDateLen = 0; // 0 = not found
+  // learns the Le each card/AID accepts, see EMV_LePolicy.h
+  EMV_LePolicy lePolicy;
 
-  // Tag5A / Tag5F24
-  byte t5aPan[20];
-  byte t5aPanLen = 0;
-  byte t5f24ExpDate[10];
-  byte t5f24ExpDateLen = 0; // 0 = not found
+  // the command and response buffers of the exchanges, scratch.highWater is the most a read needed
+  EMV_ScratchArena scratch;
 
-  char panChar[30];
-  uint8_t panCharLen = 0;
-  char expDateChar[10];
-  uint8_t expDateCharLen = 0;
+  // if set every command and response is appended in binary form, see EMV_ApduRing.h
+  EMV_ApduRing* apduRing = NULL;
 
-  // tag 94h = AFL = Application File Locator
-  byte t94Afl[255];
-  byte t94AflLen = 0;
+  // counters and latency histograms of all exchanges, see EMV_Metrics.h
+  EMV_Metrics metrics;
 
-  uint8_t afl[255];
-  uint8_t aflLen = 255;
+  // if true the read flow decodes only what the next command needs (AIDs, PDOL, AFL): SendPdol
+  // skips the track 2 and ReadRecord skips ParseRecord, e.g. when EMV_ParseStage decodes the
+  // responses (see EMV_Pipeline.h). card.track2, card.pan and card.expDate stay empty.
+  bool captureOnly = false;
 
   //bool COMM_DEBUG_PRINT = true;             // if true the send and received data is printed
   //bool AUTHENTICATION_DEBUG_PRINT = false;  // if true the complete authentication workflow is printed
@@ -159,8 +157,13 @@ public:
     EMV_STATUS_ERROR = 1,         // Not specified error
     EMV_STATUS_NO_RESPONSE = 2,   // EMV card returns 255 bytes
     //EMV_STATUS_LE_LENGTH_00 = 3   // EMV card returns no data but wants the command replied with an Le length of '0x00h'
+    EMV_STATUS_TOO_LONG = 4,      // the response does not fit into the receive buffer or the frame of the reader
   };
 
+  // the status of the last exchange with the card, EMV_STATUS_OK if the card answered, even with a
+  // status word that rejects the command (e.g. 6A 83); tells a lost card from a rejected command
+  EMV_StatusCode lastExchangeStatus = EMV_STATUS_OK;
+
   // Limitations on PN532 readers
   const uint8_t MAX_BUFFER_SIZE = 255;  // the internal buffer is 128 - 3 for status bytes
 
@@ -171,18 +174,26 @@ public:
   //
   /////////////////////////////////////////////////////////////////////////////////////
 
+  bool DetectCard(); // looks once for a card in the field, see EMV_Transport::detectCard
+  byte DetectCards(byte maxCards); // looks once for up to maxCards cards, see EMV_Transport::detectCards
+  bool SelectCard(byte index); // the next commands go to this card of DetectCards, a read starts with SelectPpse
+  bool CheckPresence(); // true if the activated card is still in the field, see EMV_Transport::checkPresence
+  byte CardUid(byte* uid); // the UID of the activated card (EMV_MAX_UID bytes), returns the length, 0 = unknown
   EMV_StatusCode SelectPpse(byte* backReadData, uint16_t* backReadLen);
   EMV_StatusCode SelectApdu(byte* sendData, byte sendLen, byte searchIndex, byte* backReadData, uint16_t* backReadLen);
   EMV_StatusCode SelectApdu_Le(byte* sendData, byte sendLen, byte leByte, byte* backReadData, uint16_t* backReadLen);
   EMV_StatusCode SendPdol(byte* backReadData, uint16_t* backReadLen);
   EMV_StatusCode SendPdol_Le(byte* sendData, byte sendLen, byte leByte, byte* backReadData, uint16_t* backReadLen);
-  bool CheckOneBytePdol(byte data);
-  bool LookUpPdolOneByte(byte byte1, byte length, byte* resData, byte* resLength);
-  bool LookUpPdolTwoByte(byte byte1, byte byte2, byte length, byte* resData, byte* resLength);
   EMV_StatusCode LookUpAid(byte* sendData, byte sendLen, uint8_t* aidNameIndex);
 
   EMV_StatusCode ReadRecord(byte* aflEntry, byte* appData, uint16_t* backReadLen);
-  EMV_StatusCode ReadRecord_Le(byte* aflEntry, byte leByte, byte* appData, byte* backReadLen);
+  EMV_StatusCode ReadRecord_Le(byte* aflEntry, byte leByte, byte* appData, uint16_t* backReadLen);
+  // 16 bit exchange, 6Cxx is resent with the exact Le, 61xx parts are collected with GET RESPONSE
+  // behind the data in backData (size backSize), responses up to EMV_MAX_RESPONSE bytes
+  EMV_StatusCode TransceiveLong(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen);
+  // capture first: CaptureRecord only stores the record during the read, ParseRecord decodes it afterwards
+  EMV_StatusCode CaptureRecord(byte* aflEntry, uint8_t aidIndex, EMV_RecordCapture* capture);
+  void ParseRecord(const byte* record, uint16_t recordLen);
 
   // helper methods
   void printHex(byte* buffer, uint16_t bufferSize);
@@ -202,7 +213,8 @@ public:
 
 private:
 
-  Adafruit_PN532* emvLib;
+  EMV_PN532Transport pn532Transport;
+  EMV_Transport* emvLib;
 
 
 protected:
@@ -213,7 +225,11 @@ protected:
   //
   /////////////////////////////////////////////////////////////////////////////////////
 
+  EMV_StatusCode EMV_Exchange(byte* sendData, uint16_t sendLen, byte* backData, uint16_t backSize, uint16_t* backLen);
   EMV_StatusCode EMV_BasicTransceive(byte* sendData, byte sendLen, byte* backData, byte* backLen);
+  EMV_StatusCode EMV_Transceive(byte* sendData, byte sendLen, byte* backData, byte* backLen);
+  EMV_StatusCode ExchangeRecord(byte* aflEntry, byte* backData, uint16_t* backLen);
+  bool IsSuccess(byte* backData, uint16_t backLen);
 
   
 };
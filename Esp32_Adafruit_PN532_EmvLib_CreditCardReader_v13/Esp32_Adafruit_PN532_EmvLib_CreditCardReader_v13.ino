@@ -16,6 +16,31 @@
 const char *PROGRAM_VERSION = "ESP32 Adafruit_PN532 EMV Library Credit Card Reader V13";
 
 #define RUN_EMV01_CREDIT_CARD
+// uncomment to only capture the records while the card is in the field and to parse them after the read
+//#define E01_CAPTURE_RECORDS
+// uncomment to read the card with the non-blocking EMV_Session instead of E01, the loop() is never blocked
+//#define RUN_EMV04_NON_BLOCKING_SESSION
+// uncomment to read the card with the I/O on this core and the parsing and output on core 0
+//#define RUN_EMV05_DUAL_CORE_PIPELINE
+// uncomment to read all cards of one activation (e.g. two cards in a wallet) instead of E01
+//#define RUN_EMV07_TWO_CARD_READ
+// uncomment to read a card once when it arrives and to wait for its removal instead of reading it every few seconds
+//#define RUN_EMV08_PRESENCE_MONITOR
+// uncomment to measure the read flow against simulated cards when the sketch starts
+//#define RUN_EMV02_READ_FLOW_BENCHMARK
+// uncomment to compare the tlv.h decoder with the in place TLV parser when the sketch starts
+//#define RUN_EMV03_TLV_PARSER_BENCHMARK
+// uncomment to check that a complete read against simulated cards allocates no heap memory when the sketch starts
+//#define RUN_EMV06_ALLOCATION_CHECK
+// uncomment to compare the read of two simulated cards in one activation with two separate taps when the sketch starts
+//#define RUN_EMV07_TWO_CARD_BENCHMARK
+// uncomment to check the BCD / track 2 codec and to compare it with the sprintf decoder when the sketch starts
+//#define RUN_EMV09_BCD_CODEC_BENCHMARK
+// uncomment to replay a recorded read of a simulated card (on a PC also the sample log) through EMV_Session when the sketch starts
+//#define RUN_EMV10_TRACE_REPLAY
+
+// uncomment to run the read flow against a simulated card (see EMV_SimCard.h) instead of a card on the PN532 reader
+//#define USE_SIMULATED_CARD
 
 #include <Wire.h>
 #include <SPI.h>
@@ -62,8 +87,20 @@ const uint32_t tftHeight = 320;
 Adafruit_PN532 nfc(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS);
 
 #include "ESP32_EMV.h"
-
+#include "EMV_Log.h"
+
+#ifdef USE_SIMULATED_CARD
+#include "EMV_SimCard.h"
+EMV_SimCard simCard(&EMV_SIM_PROFILE_VISA);
+ESP32_EMV emv(&simCard);
+#else
+// for the unmodified Adafruit_PN532 library (see ESP32_EMV.h): ESP32_EMV emv(&nfc, EMV_PN532_PACKBUFFSIZ_STOCK);
 ESP32_EMV emv(&nfc);
+#endif
+
+// the last commands and responses of emv, the examples dump it after an error
+#include "EMV_ApduRing.h"
+EMV_ApduRing apduRing;
 
 void printHex(byte *buffer, uint16_t bufferSize);
 
@@ -75,6 +112,33 @@ uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0 };  // Buffer to store the returned UID
 uint8_t uidLength;                        // Length of the UID (4 or 7 bytes depending on ISO14443A card type)
 
 #include "E01_CreditCardReader.h"
+#ifdef RUN_EMV02_READ_FLOW_BENCHMARK
+#include "E02_ReadFlowBenchmark.h"
+#endif
+#ifdef RUN_EMV03_TLV_PARSER_BENCHMARK
+#include "E03_TlvParserBenchmark.h"
+#endif
+#ifdef RUN_EMV06_ALLOCATION_CHECK
+#include "E06_AllocationCheck.h"
+#endif
+#ifdef RUN_EMV04_NON_BLOCKING_SESSION
+#include "E04_NonBlockingSession.h"
+#endif
+#if defined(RUN_EMV07_TWO_CARD_READ) || defined(RUN_EMV07_TWO_CARD_BENCHMARK)
+#include "E07_TwoCardRead.h"
+#endif
+#ifdef RUN_EMV08_PRESENCE_MONITOR
+#include "E08_PresenceMonitor.h"
+#endif
+#ifdef RUN_EMV05_DUAL_CORE_PIPELINE
+#include "E05_DualCorePipeline.h"
+#endif
+#ifdef RUN_EMV09_BCD_CODEC_BENCHMARK
+#include "E09_BcdCodecBenchmark.h"
+#endif
+#ifdef RUN_EMV10_TRACE_REPLAY
+#include "E10_TraceReplay.h"
+#endif
 
 void setup(void) {
   Serial.begin(115200);
@@ -82,6 +146,26 @@ void setup(void) {
   delay(500);
   Serial.println(PROGRAM_VERSION);
 
+#ifdef RUN_EMV02_READ_FLOW_BENCHMARK
+  run_E02_Read_Flow_Benchmark();
+#endif
+#ifdef RUN_EMV03_TLV_PARSER_BENCHMARK
+  run_E03_Tlv_Parser_Benchmark();
+#endif
+#ifdef RUN_EMV06_ALLOCATION_CHECK
+  run_E06_Allocation_Check();
+#endif
+#ifdef RUN_EMV07_TWO_CARD_BENCHMARK
+  run_E07_Two_Card_Benchmark();
+#endif
+#ifdef RUN_EMV09_BCD_CODEC_BENCHMARK
+  run_E09_Bcd_Codec_Benchmark();
+#endif
+#ifdef RUN_EMV10_TRACE_REPLAY
+  run_E10_Trace_Replay();
+#endif
+
+#ifndef USE_SIMULATED_CARD
   nfc.begin();
   uint32_t versiondata = nfc.getFirmwareVersion();
   if (!versiondata) {
@@ -101,16 +185,70 @@ void setup(void) {
   // Set the max number of retry attempts to read from a card
   // This prevents us from waiting forever for a card, which is
   // the default behaviour of the PN532.
+#if defined(RUN_EMV04_NON_BLOCKING_SESSION) || defined(RUN_EMV05_DUAL_CORE_PIPELINE) || defined(RUN_EMV08_PRESENCE_MONITOR)
+  // one activation attempt per poll, the session does not wait for a card
+  nfc.setPassiveActivationRetries(0x01);
+#else
   nfc.setPassiveActivationRetries(0xFF);
+#endif
+#endif
 
   Serial.printf("ESP32_EMV library version: %d\n", emv.EMV_LIBRARY_VERSION);
+  Serial.printf("ESP32_EMV object %d bytes, card data (EMV_CardData) %d bytes\n", (int)sizeof(ESP32_EMV), (int)sizeof(EMV_CardData));
+  // build once with EMV_LOG_LEVEL 0 to see what the debug output costs in flash, see EMV_Log.h
+  Serial.printf("Log level %d categories 0x%02x\n", EMV_LOG_LEVEL, EMV_LOG_CATEGORIES);
+#ifdef ARDUINO
+  Serial.printf("Sketch size %lu bytes\n", (unsigned long)ESP.getSketchSize());
+#endif
+
+  emv.apduRing = &apduRing;
+
+#if defined(RUN_EMV04_NON_BLOCKING_SESSION) && defined(USE_SIMULATED_CARD)
+  setup_E04_Non_Blocking_Session();
+#endif
+#ifdef RUN_EMV05_DUAL_CORE_PIPELINE
+  setup_E05_Dual_Core_Pipeline();
+#endif
+#ifdef RUN_EMV08_PRESENCE_MONITOR
+  setup_E08_Presence_Monitor();
+#endif
 
   Serial.println("Waiting for an ISO14443A card");
 }
 
 void loop(void) {
 
+#ifdef RUN_EMV04_NON_BLOCKING_SESSION
+  // one step per loop, other work can be done here
+  run_E04_Non_Blocking_Session();
+  return;
+#endif
+
+#ifdef RUN_EMV05_DUAL_CORE_PIPELINE
+  // one step of the I/O stage per loop, the parse stage runs on core 0
+  run_E05_Dual_Core_Pipeline();
+  return;
+#endif
+
+#ifdef RUN_EMV08_PRESENCE_MONITOR
+  // at most one check of the field per loop, the card is read once when it arrives
+  run_E08_Presence_Monitor();
+  return;
+#endif
+
+#ifdef RUN_EMV07_TWO_CARD_READ
+  // one activation, every card in the field is read
+  run_E07_Two_Card_Read();
+  delay(1000);
+  return;
+#endif
+
+#ifdef USE_SIMULATED_CARD
+  simCard.reset();
+  success = true;
+#else
   success = nfc.inListPassiveTarget();
+#endif
 
   if (success) {
     Serial.println("Found a card!");
@@ -0,0 +1,35 @@
+/**
+ * The Adafruit_PN532 calls of the sketch and of EMV_PN532Transport, for a build on Linux (see
+ * Makefile). There is no reader: the firmware version is reported, but no card is ever found and
+ * every exchange fails. Build with USE_SIMULATED_CARD to run the read flow on the host.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef Adafruit_PN532_h
+#define Adafruit_PN532_h
+
+#include "Arduino.h"
+
+#define PN532_MIFARE_ISO14443A (0x00)
+
+class Adafruit_PN532 {
+
+public:
+  Adafruit_PN532(uint8_t clk, uint8_t miso, uint8_t mosi, uint8_t ss) {}
+  bool begin() { return true; }
+  uint32_t getFirmwareVersion() { return 0x32010607; }  // PN532 firmware 1.6
+  bool setPassiveActivationRetries(uint8_t maxRetries) { return true; }
+  bool inListPassiveTarget() { return false; }
+  bool readPassiveTargetID(uint8_t cardbaudrate, uint8_t* uid, uint8_t* uidLength, uint16_t timeout = 0, bool inlist = false) {
+    *uidLength = 0;
+    return false;
+  }
+  bool inDataExchange(uint8_t* send, uint8_t sendLength, uint8_t* response, uint8_t* responseLength) {
+    *responseLength = 0;
+    return false;
+  }
+  bool sendCommandCheckAck(uint8_t* cmd, uint8_t cmdlen, uint16_t timeout = 100) { return false; }
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * The part of the Arduino core the sketch and the library use, for a build on Linux (see Makefile).
+ * Serial writes to stdout, micros() and millis() count from a monotonic clock, delay() returns
+ * at once so the examples run at full speed. ARDUINO is not defined, the ESP32 parts of the
+ * library (FreeRTOS, heap_caps) are left out.
+ *
+ * Author: Michael Fehr (AndroidCrypto)
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+
+class HostSerial {
+
+public:
+  void begin(unsigned long) {}
+  operator bool() { return true; }
+
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list arguments;
+    va_start(arguments, format);
+    int len = vprintf(format, arguments);
+    va_end(arguments);
+    return len;
+  }
+  void print(const char* text) { fputs(text, stdout); }
+  void print(char c) { putchar(c); }
+  void print(long value, int base = DEC) { printf((base == HEX) ? "%lX" : "%ld", value); }
+  void print(unsigned long value, int base = DEC) { printf((base == HEX) ? "%lX" : "%lu", value); }
+  void print(int value, int base = DEC) { print((long)value, base); }
+  void print(unsigned int value, int base = DEC) { print((unsigned long)value, base); }
+  void print(uint8_t value, int base = DEC) { print((unsigned long)value, base); }
+  void print(uint16_t value, int base = DEC) { print((unsigned long)value, base); }
+  void println() { putchar('\n'); }
+  template<typename T> void println(T value) {
+    print(value);
+    println();
+  }
+  template<typename T> void println(T value, int base) {
+    print(value, base);
+    println();
+  }
+  size_t write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+  size_t write(uint8_t c) { return (putchar(c) == EOF) ? 0 : 1; }
+};
+
+extern HostSerial Serial;
+
+inline unsigned long micros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+inline unsigned long millis() { return micros() / 1000; }
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int us) {
+  unsigned long start = micros();
+  while (micros() - start < us) {}
+}
+inline void yield() {}
+
+#endif
@@ -0,0 +1 @@
+// the host build talks to no hardware, see Adafruit_PN532.h
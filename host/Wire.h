@@ -0,0 +1 @@
+// the PN532 is connected by SPI, the host build needs no I2C
@@ -0,0 +1,15 @@
+// Runs the sketch on Linux: setup() once, then loop() as often as the first argument says (default 1).
+// The examples are selected with the defines of the sketch, see Makefile.
+
+#include "Arduino.h"
+
+HostSerial Serial;
+
+#include "../Esp32_Adafruit_PN532_EmvLib_CreditCardReader_v13/Esp32_Adafruit_PN532_EmvLib_CreditCardReader_v13.ino"
+
+int main(int argc, char** argv) {
+  setup();
+  long loops = (argc > 1) ? atol(argv[1]) : 1;
+  for (long i = 0; i < loops; i++) loop();
+  return 0;
+}